@@ -0,0 +1,275 @@
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tp/circuits.h"
+#include "misc.h"
+
+// Runs every party of a benchmark as threads of a single process, connected
+// in memory, and prints one JSON object per run:
+//
+//   {"n": 9, "t": 4, "k": 3, "size": 1000, "depth": 10, "net": "none",
+//    "phases": {"fi_prep": us, ...},
+//    "parties": [{"id": 0, "cpu_us": us, "bytes_sent": b,
+//                 "phases": {"fi_prep": {"wall_us": us, "bytes_sent": b}, ...},
+//                 "network": {...}},
+//                ...]}
+//
+// The wall time of a phase is the time from when a party starts it until it is
+// done, and the one of a run is the largest over all parties. With a network
+// profile, time is virtual: it includes the emulated latency and bandwidth, but
+// not the time spent waiting for it. "network" holds the traffic to each peer,
+// as written by scl::NetworkStats::WriteJson.
+
+struct PhaseResult {
+  std::string name;
+  std::chrono::microseconds wall;
+  std::size_t bytes_sent;
+};
+
+// What one party spent in each phase
+class PartyMeter {
+ public:
+  PartyMeter(std::shared_ptr<scl::Network> network,
+             std::shared_ptr<scl::VirtualClock> clock)
+      : mNetwork(network), mClock(clock){};
+
+  void Begin(const std::string& name) {
+    mNetwork->SetPhase(name);
+    mName = name;
+    mStart = mClock->Now();
+  };
+
+  void End() {
+    const auto wall = std::chrono::duration_cast<std::chrono::microseconds>(
+        mClock->Now() - mStart);
+    mPhases.push_back({mName, wall, BytesSent(mName)});
+  };
+
+  std::size_t BytesSent(const std::string& phase) const {
+    const auto* stats = mNetwork->Stats();
+    std::size_t sent = 0;
+    for (unsigned i = 0; i < stats->Size(); ++i)
+      sent += stats->Get(phase, i).bytes_sent;
+    return sent;
+  };
+
+  std::size_t BytesSent() const {
+    std::size_t sent = 0;
+    for (const auto& phase : mNetwork->Stats()->Phases())
+      sent += BytesSent(phase);
+    return sent;
+  };
+
+  // Charge the CPU time of the calling thread to the party
+  void AddThreadCpuTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    mCpu += ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  };
+
+  long CpuTime() const { return mCpu.load(); };
+
+  const std::vector<PhaseResult>& Phases() const { return mPhases; };
+
+ private:
+  std::shared_ptr<scl::Network> mNetwork;
+  std::shared_ptr<scl::VirtualClock> mClock;
+  std::string mName;
+  scl::VirtualClock::Clock::time_point mStart;
+  std::vector<PhaseResult> mPhases;
+  std::atomic<long> mCpu{0};
+};
+
+// Start a helper thread of a party
+template <typename F>
+std::thread Spawn(PartyMeter& meter, F f) {
+  return std::thread([&meter, f]() {
+    f();
+    meter.AddThreadCpuTime();
+  });
+}
+
+struct RunConfig {
+  std::size_t n;
+  std::size_t t;
+  std::size_t k;
+  std::size_t size;
+  std::size_t depth;
+  std::string net;
+};
+
+// The same steps as ours.x
+void RunParty(const RunConfig& run, std::size_t id,
+              std::shared_ptr<scl::Network> network, PartyMeter& meter) {
+  tp::CircuitConfig circuit_config;
+  circuit_config.n_parties = run.n;
+  circuit_config.inp_gates = std::vector<std::size_t>(run.n, 0);
+  circuit_config.inp_gates[0] = 2;
+  circuit_config.out_gates = std::vector<std::size_t>(run.n, 0);
+  circuit_config.out_gates[0] = 2;
+  circuit_config.width = run.size / run.depth;
+  circuit_config.depth = run.depth;
+  circuit_config.batch_size = run.k;
+
+  auto circuit = tp::Circuit::FromConfig(circuit_config);
+  circuit.SetNetwork(network, id);
+  circuit.GenCorrelator();
+  circuit.SetThreshold(run.t);
+
+  meter.Begin("fi_prep");
+  auto fi_send = Spawn(meter, [&circuit]() { circuit.FIPrepSend(); });
+  circuit.FIPrepRecv();
+  fi_send.join();
+  auto prod_send = Spawn(meter, [&circuit]() { circuit.GenProdPartiesSendP1(); });
+  auto prod_p1 =
+      Spawn(meter, [&circuit]() { circuit.GenProdP1ReceivesAndSends(); });
+  circuit.GenProdPartiesReceive();
+  prod_send.join();
+  prod_p1.join();
+  meter.End();
+
+  circuit.MapCorrToCircuit();
+
+  meter.Begin("fd_prep");
+  circuit.PrepMultPartiesSendP1();
+  circuit.PrepMultP1ReceivesAndSends();
+  circuit.PrepIOPartiesSendOwner();
+  circuit.PrepMultPartiesReceive();
+  circuit.PrepIOOwnerReceives();
+  meter.End();
+
+  std::vector<tp::FF> result;
+  if (id == 0) {
+    std::vector<tp::FF> inputs{tp::FF(0432432), tp::FF(54982)};
+    circuit.SetClearInputsFlat(inputs);
+    result = circuit.GetClearOutputsFlat();
+    circuit.SetInputs(inputs);
+  }
+
+  meter.Begin("online");
+  circuit.InputOwnerSendsP1();
+  circuit.InputP1Receives();
+  for (std::size_t layer = 0; layer < run.depth; layer++) {
+    circuit.MultP1Sends(layer);
+    circuit.MultPartiesReceive(layer);
+    circuit.MultPartiesSend(layer);
+    circuit.MultP1Receives(layer);
+  }
+  circuit.OutputP1SendsMu();
+  circuit.OutputOwnerReceivesMu();
+  meter.End();
+
+  if (id == 0 && circuit.GetOutputs() != result)
+    throw std::logic_error("wrong output");
+
+  meter.AddThreadCpuTime();
+}
+
+void Run(const RunConfig& run) {
+  auto networks = scl::Network::CreateFullInMemory(run.n);
+
+  std::vector<std::unique_ptr<PartyMeter>> meters;
+  std::vector<std::shared_ptr<scl::Network>> instrumented;
+  for (std::size_t i = 0; i < run.n; ++i) {
+    auto clock = std::make_shared<scl::VirtualClock>();
+    if (run.net != "none") {
+      networks[i] = scl::Network::CreateEmulated(
+          networks[i], i, scl::LinkConditions::FromProfile(run.net), clock);
+    }
+    instrumented.push_back(std::make_shared<scl::Network>(
+        scl::Network::CreateInstrumented(networks[i], i)));
+    meters.push_back(std::make_unique<PartyMeter>(instrumented[i], clock));
+  }
+
+  std::vector<std::thread> parties;
+  std::vector<std::exception_ptr> errors(run.n);
+  for (std::size_t i = 0; i < run.n; ++i) {
+    parties.emplace_back([&, i]() {
+      try {
+        RunParty(run, i, instrumented[i], *meters[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto& p : parties) p.join();
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+  for (auto& network : networks) network.Close();
+
+  std::ostringstream out;
+  out << "{\"n\": " << run.n << ", \"t\": " << run.t << ", \"k\": " << run.k
+      << ", \"size\": " << run.size << ", \"depth\": " << run.depth
+      << ", \"net\": \"" << run.net << "\", \"phases\": {";
+  const auto& names = meters[0]->Phases();
+  for (std::size_t p = 0; p < names.size(); ++p) {
+    std::chrono::microseconds wall(0);
+    for (const auto& m : meters) wall = std::max(wall, m->Phases()[p].wall);
+    out << (p ? ", " : "") << "\"" << names[p].name << "\": " << wall.count();
+  }
+  out << "}, \"parties\": [";
+  for (std::size_t i = 0; i < run.n; ++i) {
+    const auto& m = *meters[i];
+    out << (i ? ", " : "") << "{\"id\": " << i << ", \"cpu_us\": " << m.CpuTime()
+        << ", \"bytes_sent\": " << m.BytesSent() << ", \"phases\": {";
+    for (std::size_t p = 0; p < m.Phases().size(); ++p) {
+      const auto& phase = m.Phases()[p];
+      out << (p ? ", " : "") << "\"" << phase.name
+          << "\": {\"wall_us\": " << phase.wall.count()
+          << ", \"bytes_sent\": " << phase.bytes_sent << "}";
+    }
+    out << "}, \"network\": ";
+    instrumented[i]->Stats()->WriteJson(out, i);
+    out << "}";
+  }
+  out << "]}";
+  std::cout << out.str() << std::endl;
+}
+
+std::vector<std::size_t> ParseList(const std::string& list) {
+  std::vector<std::size_t> values;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) values.push_back(std::stoul(item));
+  return values;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cout << "usage: " << argv[0] << " [Ns] [sizes] [depths] [net]\n";
+    std::cout << "Ns, sizes and depths are comma separated lists, and every combination is run\n";
+    std::cout << "with t = (N-1)/2 and the largest k it allows\n";
+    std::cout << "net is none (default), lan, wan or <delay ms>,<rate Mbit> to emulate a network\n";
+    return 0;
+  }
+
+  const auto ns = ParseList(argv[1]);
+  const auto sizes = ParseList(argv[2]);
+  const auto depths = ParseList(argv[3]);
+  const std::string net = argc > 4 ? argv[4] : "none";
+  if (net != "none") scl::LinkConditions::FromProfile(net);
+
+  for (auto n : ns) {
+    if (n < 4) throw std::invalid_argument("N must be at least 4");
+    for (auto size : sizes) {
+      for (auto depth : depths) {
+        // Like gen_data.sh, skip circuits that are deeper than they are large
+        if (depth == 0 || depth > size) continue;
+        const std::size_t t = (n - 1) / 2;
+        const std::size_t k = (n - t + 1) / 2;
+        Run({n, t, k, size, depth, net});
+      }
+    }
+  }
+}
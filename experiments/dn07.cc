@@ -27,7 +27,8 @@ inline std::size_t ValidateId(const std::size_t id, const std::size_t n) {
 
 int main(int argc, char** argv) {
   if (argc < 5) {
-    std::cout << "usage: " << argv[0] << " [N] [id] [size] [depth]\n";
+    std::cout << "usage: " << argv[0] << " [N] [id] [size] [depth] [net] [king]\n";
+    std::cout << "net and king are as for ours.x\n";
     return 0;
   }
 
@@ -36,6 +37,10 @@ int main(int argc, char** argv) {
   std::size_t id = ValidateId(std::stoul(argv[2]), n);
   std::size_t size = std::stoul(argv[3]);
   std::size_t depth = std::stoul(argv[4]);
+  std::string net = argc > 5 ? argv[5] : "tcp";
+  std::string king = argc > 6 ? argv[6] : "p1";
+  if ( king != "p1" && king != "rotate" )
+    throw std::invalid_argument("king must be p1 or rotate");
   std::size_t width = size/depth;
 
   DELIM;
@@ -53,7 +58,7 @@ int main(int argc, char** argv) {
 
   std::cout << "Connecting ..."
             << "\n";
-  auto network = scl::Network::Create(config);
+  auto network = Connect(config, net);
 
   std::cout << "Done!\n";
 
@@ -77,6 +82,7 @@ int main(int argc, char** argv) {
 
   circuit.GenCorrelator();
   circuit.SetThreshold(t);
+  circuit.SetKingPolicy(king == "rotate" ? tp::KingPolicy::kRotating : tp::KingPolicy::kParty0);
 
   //////////////////////////////////////////
 
@@ -89,6 +95,7 @@ int main(int argc, char** argv) {
   DELIM;
   std::cout << "DN07: Running preprocessing\n";
 
+  network.SetPhase("dn07_prep");
   START_TIMER(dn07_prep);
   // This has to be done BEFORE setting the inputs below
   if (THREAD) {
@@ -106,6 +113,7 @@ int main(int argc, char** argv) {
   DELIM;
   std::cout << "DN07: Running FD\n";
 
+  network.SetPhase("dn07_fd");
   START_TIMER(dn07_fd);
   dn07.FDMapPrepToGates();
   dn07.FDMultPartiesSendP1();
@@ -125,12 +133,14 @@ int main(int argc, char** argv) {
   std::cout << "DN07: Running online\n";
   START_TIMER(dn07_online);
   // Input protocol (inputs are already set from above)
+  network.SetPhase("dn07_online_input");
 
   dn07.InputPartiesSendOwners(); 
   dn07.InputOwnersReceiveAndSendParties(); 
   dn07.InputPartiesReceive(); 
 
   // Multiplications 
+  network.SetPhase("dn07_online_mult");
     
        for (std::size_t layer = 0; layer < circuit_config.depth; layer++) {
 	 if (THREAD) {
@@ -148,6 +158,7 @@ int main(int argc, char** argv) {
 	 }
        }
   // Output protocol
+  network.SetPhase("dn07_online_output");
   dn07.OutputPartiesSendOwners(); 
   dn07.OutputOwnersReceive(); 
 
@@ -162,5 +173,6 @@ int main(int argc, char** argv) {
   // technically not necessary as channels are destroyed when their dtor is
   // called.
   network.Close();
+  PrintStats(network, id);
 
 }
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include "scl.h"
+#include "scl/math/kernels.h"
+#include "misc.h"
+
+#define DELIM std::cout << "========================================\n"
+
+using FF = scl::FF<61>;
+using Kernels = scl::details::Mersenne61Kernels;
+using u64 = std::uint64_t;
+
+// Runs f reps times and prints the time per element in ns
+template <typename F>
+void Time(const std::string& name, std::size_t elements, std::size_t reps, F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (std::size_t r = 0; r < reps; r++) f();
+  auto stop = std::chrono::high_resolution_clock::now();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+  std::cout << name << ": " << (double)ns / (double)(elements * reps) << " ns/elt\n";
+}
+
+// Keeps results alive so that the loops are not optimized away
+volatile u64 sink;
+
+void BenchKernels(const Kernels& kernels, std::vector<u64> a, const std::vector<u64>& b,
+		  std::size_t reps) {
+  std::size_t n = a.size();
+  std::string name(kernels.mName);
+  Time(name + " mul", n, reps, [&]() { kernels.Multiply(a.data(), b.data(), n); });
+  Time(name + " mac", n, reps, [&]() { kernels.MultiplyAccumulate(a.data(), b[0], b.data(), n); });
+  Time(name + " dot", n, reps, [&]() { sink = kernels.Dot(a.data(), b.data(), n); });
+  Time(name + " add", n, reps, [&]() { kernels.Add(a.data(), b.data(), n); });
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cout << "usage: " << argv[0] << " [length] [reps]\n";
+    return 0;
+  }
+
+  std::size_t n = std::stoul(argv[1]);
+  std::size_t reps = std::stoul(argv[2]);
+
+  scl::PRG prg;
+  auto fa = scl::Vec<FF>::Random(n, prg);
+  auto fb = scl::Vec<FF>::Random(n, prg);
+  std::vector<u64> a(n);
+  std::vector<u64> b(n);
+  for (std::size_t i = 0; i < n; i++) {
+    a[i] = *scl::details::RawValues(&fa[i]);
+    b[i] = *scl::details::RawValues(&fb[i]);
+  }
+
+  DELIM;
+  std::cout << "Mersenne61 kernels, length " << n << ", " << reps << " reps. Best: "
+	    << Kernels::Best().mName << "\n";
+  DELIM;
+
+  // Baseline: element-wise FF operations, as Vec/Mat did before
+  {
+    std::vector<FF> x(fa.begin(), fa.end());
+    std::vector<FF> y(fb.begin(), fb.end());
+    Time("FF mul", n, reps, [&]() { for (std::size_t i = 0; i < n; i++) x[i] *= y[i]; });
+    Time("FF mac", n, reps, [&]() { for (std::size_t i = 0; i < n; i++) x[i] += y[0] * y[i]; });
+    Time("FF dot", n, reps, [&]() {
+      FF acc;
+      for (std::size_t i = 0; i < n; i++) acc += x[i] * y[i];
+      sink = *scl::details::RawValues(&acc);
+    });
+  }
+
+  BenchKernels(Kernels::Scalar(), a, b, reps);
+  if (Kernels::AVX2()) BenchKernels(*Kernels::AVX2(), a, b, reps);
+  if (Kernels::AVX512IFMA()) BenchKernels(*Kernels::AVX512IFMA(), a, b, reps);
+
+  Time("lazy dot", n, reps, [&]() { sink = scl::details::Mersenne61LazyDot(a.data(), b.data(), n); });
+
+  // Randomness extraction: a (t+1) x n Vandermonde matrix times the
+  // n shares of a block, for every block
+  DELIM;
+  {
+    std::size_t parties = 33;
+    std::size_t t = 16;
+    auto vandermonde = scl::Mat<FF>::Random(t + 1, parties, prg);
+    auto shares = scl::Vec<FF>::Random(parties, prg);
+    std::size_t blocks = n / parties;
+    Time("extraction per-product reduction", blocks * parties * (t + 1), reps, [&]() {
+      for (std::size_t b = 0; b < blocks; b++) {
+	for (std::size_t i = 0; i < t + 1; i++) {
+	  FF shr;
+	  for (std::size_t j = 0; j < parties; j++) shr += vandermonde(i, j) * shares[j];
+	  sink = *scl::details::RawValues(&shr);
+	}
+      }
+    });
+    Time("extraction lazy reduction", blocks * parties * (t + 1), reps, [&]() {
+      for (std::size_t b = 0; b < blocks; b++) {
+	auto shrs = vandermonde.Multiply(shares);
+	sink = *scl::details::RawValues(&shrs[0]);
+      }
+    });
+  }
+
+  // The P1 sharing product of a layer: (n x k) times (k x W/k)
+  DELIM;
+  std::size_t parties = 33;
+  std::size_t k = 9;
+  auto share_matrix = scl::Mat<FF>::Random(parties, k, prg);
+  auto secrets = scl::Mat<FF>::Random(k, n / k, prg);
+  START_TIMER(mat_multiply);
+  for (std::size_t r = 0; r < reps; r++) {
+    auto shares = share_matrix.Multiply(secrets);
+    sink = *scl::details::RawValues(&shares(0, 0));
+  }
+  STOP_TIMER(mat_multiply);
+}
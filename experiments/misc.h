@@ -1,3 +1,9 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "scl/net/network.h"
+
 #define QUOTE(x) #x
 
 #define START_TIMER(name) \
@@ -8,3 +14,40 @@
   auto duration##name = std::chrono::duration_cast<std::chrono::microseconds>( \
       stop##name - start##name);                                               \
   std::cout << QUOTE(name) << ": " << duration##name.count() << " us\n"
+
+// Connect to the other parties. net is tcp or shm, optionally followed by
+// :lan, :wan or :<delay ms>,<rate Mbit> to emulate those network conditions.
+// tcp<m>, e.g. tcp4, stripes large messages across m sockets to each peer
+inline scl::Network Connect(const scl::NetworkConfig& config,
+                            const std::string& net) {
+  const auto colon = net.find(':');
+  const auto transport = net.substr(0, colon);
+
+  scl::TcpOptions options;
+  const bool tcp = transport.rfind("tcp", 0) == 0;
+  if (tcp && transport.size() > 3) {
+    const auto streams = transport.substr(3);
+    if (streams.find_first_not_of("0123456789") != std::string::npos)
+      throw std::invalid_argument("unknown network: " + transport);
+    options.streams = std::stoul(streams);
+  } else if (!tcp && transport != "shm") {
+    throw std::invalid_argument("unknown network: " + transport);
+  }
+
+  auto network = transport == "shm"
+                     ? scl::Network::CreateSharedMemory(config)
+                     : scl::Network::CreateThreadedSenders(config, options);
+  if (colon != std::string::npos) {
+    network = scl::Network::CreateEmulated(
+        network, config.Id(),
+        scl::LinkConditions::FromProfile(net.substr(colon + 1)));
+  }
+  return scl::Network::CreateInstrumented(network, config.Id());
+}
+
+// Print the traffic of each phase to each peer as one line of JSON
+inline void PrintStats(scl::Network& network, std::size_t id) {
+  std::cout << "stats: ";
+  network.Stats()->WriteJson(std::cout, id);
+  std::cout << "\n";
+}
@@ -13,12 +13,22 @@
 #define PRINT(x) if (DEBUG) std::cout << x << "\n";
 
 inline std::size_t ValidateN(const std::size_t n) {
-  assert(n > 3
-	 && (((n-1) % 4) == 0)
-	 );
+  assert(n > 3);
   return n;			
 }
 
+inline std::size_t ValidateT(const std::size_t t, const std::size_t n) {
+  if ( 2*t >= n )
+    throw std::invalid_argument("It must hold that t < n/2");
+  return t;
+}
+
+inline std::size_t ValidateK(const std::size_t k, const std::size_t t, const std::size_t n) {
+  if ( k == 0 || t + 2*(k - 1) + 1 > n )
+    throw std::invalid_argument("It must hold that n >= t + 2(k-1) + 1");
+  return k;
+}
+
 inline std::size_t ValidateId(const std::size_t id, const std::size_t n) {
       if ( id >= n )
 	throw std::invalid_argument("ID cannot be larger than number of parties");
@@ -27,22 +37,55 @@ inline std::size_t ValidateId(const std::size_t id, const std::size_t n) {
 
 int main(int argc, char** argv) {
   if (argc < 5) {
-    std::cout << "usage: " << argv[0] << " [N] [id] [size] [depth]\n";
+    std::cout << "usage: " << argv[0] << " [N] [id] [size] [depth] [t] [k] [prss] [net] [threads] [king] [chunk] [store] [evals]\n";
+    std::cout << "t defaults to (N-1)/2, and k to the largest packing factor t allows\n";
+    std::cout << "prss lists the F.I. correlations generated with PRSS instead of dealt:\n";
+    std::cout << "u (unpacked sharings), z (zero sharings), p (zero sharings for products)\n";
+    std::cout << "net is tcp (default) or shm, which connects co-located parties through shared memory,\n";
+    std::cout << "optionally followed by :lan, :wan or :<delay ms>,<rate Mbit> to emulate a network\n";
+    std::cout << "threads is the number of threads the kings compute with (default 1)\n";
+    std::cout << "king is p1 (default), where party 0 reconstructs every batch, or rotate,\n";
+    std::cout << "where batch b is reconstructed by party b mod N\n";
+    std::cout << "chunk is the number of mult batches the preprocessing is streamed in, or 0 (default)\n";
+    std::cout << "to run each phase of the preprocessing over the whole circuit at once\n";
+    std::cout << "store is save:<prefix>, which writes the preprocessing of party id to <prefix>.<id>,\n";
+    std::cout << "or load:<prefix>, which reads it from there instead of running the preprocessing,\n";
+    std::cout << "or - (default) to keep the preprocessing in memory\n";
+    std::cout << "evals is the number of evaluations to run with the F.I. preprocessing produced in the\n";
+    std::cout << "background over a second network, or 0 (default) for a single evaluation as above\n";
     return 0;
   }
 
   std::size_t n = ValidateN(std::stoul(argv[1]));
-  std::size_t t = (n - 1) / 2;
+  std::size_t t = ValidateT(argc > 5 ? std::stoul(argv[5]) : (n - 1) / 2, n);
+  std::size_t batch_size = ValidateK(argc > 6 ? std::stoul(argv[6]) : (n - t + 1) / 2, t, n);
+  std::string prss = argc > 7 ? argv[7] : "";
+  std::string net = argc > 8 ? argv[8] : "tcp";
+  std::size_t threads = argc > 9 ? std::stoul(argv[9]) : 1;
+  std::string king = argc > 10 ? argv[10] : "p1";
+  if ( king != "p1" && king != "rotate" )
+    throw std::invalid_argument("king must be p1 or rotate");
+  auto king_policy = king == "rotate" ? tp::KingPolicy::kRotating : tp::KingPolicy::kParty0;
+  std::size_t chunk = argc > 11 ? std::stoul(argv[11]) : 0;
+  std::string store = argc > 12 && std::string(argv[12]) != "-" ? argv[12] : "";
+  if ( !store.empty() && store.rfind("save:", 0) != 0 && store.rfind("load:", 0) != 0 )
+    throw std::invalid_argument("store must be save:<prefix> or load:<prefix>");
+  bool load = store.rfind("load:", 0) == 0;
+  std::size_t evals = argc > 13 ? std::stoul(argv[13]) : 0;
+  bool prep = !load && evals == 0;
   std::size_t id = ValidateId(std::stoul(argv[2]), n);
   std::size_t size = std::stoul(argv[3]);
   std::size_t depth = std::stoul(argv[4]);
   std::size_t width = size/depth;
 
   DELIM;
-  std::cout << "Running benchmark with N " << n << ", size " <<
-    size << ", width " << width << " and depth " << depth << "\n";
+  std::cout << "Running benchmark with N " << n << ", t " << t << ", k " <<
+    batch_size << ", size " << size << ", width " << width << " and depth " <<
+    depth << "\n";
   DELIM;
 
+  std::string store_path = store.empty() ? "" : store.substr(5) + "." + std::to_string(id);
+
   auto config = scl::NetworkConfig::Localhost(id, n);
   // std::cout << "Config:"
   //           << "\n";
@@ -53,12 +96,11 @@ int main(int argc, char** argv) {
 
   std::cout << "Connecting ..."
             << "\n";
-  auto network = scl::Network::Create(config);
+  auto network = Connect(config, net);
 
   std::cout << "Done!\n";
 
-  std::size_t batch_size = (t + 2)/2;
-  std::size_t n_parties = t + 2*(batch_size - 1) + 1;
+  std::size_t n_parties = n;
   // std::size_t n_clients = n_parties;
 
   tp::CircuitConfig circuit_config;
@@ -74,62 +116,153 @@ int main(int argc, char** argv) {
   auto circuit = tp::Circuit::FromConfig(circuit_config);
 
   circuit.SetNetwork(std::make_shared<scl::Network>(network), id);
+  circuit.SetKingPolicy(king_policy);
+  if ( id == 0 || king_policy == tp::KingPolicy::kRotating ) circuit.SetThreads(threads);
 
   circuit.GenCorrelator();
   circuit.SetThreshold(t);
 
-  DELIM;
-  std::cout << "Running function-independent preprocessing\n";
-  
-  START_TIMER(fi_prep);
-  PRINT("fi_prep SEND");
-  if (THREAD) {
-    std::thread t_FIPrepSend( &tp::Circuit::FIPrepSend, &circuit );
-    PRINT("fi_prep RECV");
-    circuit.FIPrepRecv();
-    t_FIPrepSend.join();
-  } else {
-    circuit.FIPrepSend();
-    PRINT("fi_prep RECV");
-    circuit.FIPrepRecv();
+  auto generation = [&prss](char c) {
+    return prss.find(c) == std::string::npos ? tp::Generation::kDealt : tp::Generation::kPRSS;
+  };
+  tp::FIPrepConfig fi_config;
+  fi_config.unpacked_shr = generation('u');
+  fi_config.zero = generation('z');
+  fi_config.zero_for_prod = generation('p');
+  circuit.SetFIPrepConfig(fi_config);
+
+  if ( load ) {
+    DELIM;
+    std::cout << "Loading the preprocessing from " << store_path << "\n";
+    START_TIMER(load_prep);
+    circuit.LoadPrep(store_path);
+    STOP_TIMER(load_prep);
   }
 
-  PRINT("fi_prod");
-  if (THREAD) {
-    std::thread t_GenProdPartiesSendP1( &tp::Circuit::GenProdPartiesSendP1, &circuit ); 
-    std::thread t_GenProdP1ReceivesAndSends( &tp::Circuit::GenProdP1ReceivesAndSends, &circuit ); 
-    circuit.GenProdPartiesReceive();
-    t_GenProdPartiesSendP1.join();
-    t_GenProdP1ReceivesAndSends.join();
-  } else {
-    circuit.GenProdPartiesSendP1();
-    circuit.GenProdP1ReceivesAndSends();
-    circuit.GenProdPartiesReceive();
+  if ( !load && !prss.empty() ) {
+    DELIM;
+    std::cout << "Running PRSS setup\n";
+    network.SetPhase("prss_setup");
+    START_TIMER(prss_setup);
+    std::thread t_PRSSSetupSend( &tp::Circuit::PRSSSetupSend, &circuit );
+    circuit.PRSSSetupRecv();
+    t_PRSSSetupSend.join();
+    STOP_TIMER(prss_setup);
   }
 
-  STOP_TIMER(fi_prep);
+  if ( prep && chunk == 0 ) {
+    DELIM;
+    std::cout << "Running function-independent preprocessing\n";
+  
+    network.SetPhase("fi_prep");
+    START_TIMER(fi_prep);
+    PRINT("fi_prep SEND");
+    if (THREAD) {
+      std::thread t_FIPrepSend( &tp::Circuit::FIPrepSend, &circuit );
+      PRINT("fi_prep RECV");
+      circuit.FIPrepRecv();
+      t_FIPrepSend.join();
+    } else {
+      circuit.FIPrepSend();
+      PRINT("fi_prep RECV");
+      circuit.FIPrepRecv();
+    }
 
-  circuit.MapCorrToCircuit(); 
+    PRINT("fi_prod");
+    // With rotating kings every party is a king, and the steps share
+    // channels, so they run in order
+    if (THREAD && king_policy == tp::KingPolicy::kParty0) {
+      std::thread t_GenProdPartiesSendP1( &tp::Circuit::GenProdPartiesSendP1, &circuit ); 
+      std::thread t_GenProdP1ReceivesAndSends( &tp::Circuit::GenProdP1ReceivesAndSends, &circuit ); 
+      circuit.GenProdPartiesReceive();
+      t_GenProdPartiesSendP1.join();
+      t_GenProdP1ReceivesAndSends.join();
+    } else {
+      circuit.GenProdPartiesSendP1();
+      circuit.GenProdP1ReceivesAndSends();
+      circuit.GenProdPartiesReceive();
+    }
 
-  DELIM;
-  std::cout << "Running function-dependent preprocessing\n";
+    STOP_TIMER(fi_prep);
+
+    circuit.MapCorrToCircuit(); 
+
+    DELIM;
+    std::cout << "Running function-dependent preprocessing\n";
   
-  START_TIMER(fd_prep);
-  // INPUT+OUTPUT+MULT.
-  PRINT("fd_prep SEND");
-  // std::thread t_PrepMultPartiesSendP1( &tp::Circuit::PrepMultPartiesSendP1, &circuit ); 
-  // std::thread t_PrepMultP1ReceivesAndSends( &tp::Circuit::PrepMultP1ReceivesAndSends, &circuit ); 
-  // t_PrepMultPartiesSendP1.join();
-  // t_PrepMultP1ReceivesAndSends.join();
-  circuit.PrepMultPartiesSendP1(); 
-  circuit.PrepMultP1ReceivesAndSends(); 
-  circuit.PrepIOPartiesSendOwner(); 
-
-  PRINT("fd_prep RECV");
-  circuit.PrepMultPartiesReceive(); 
-  circuit.PrepIOOwnerReceives(); 
-
-  STOP_TIMER(fd_prep);
+    network.SetPhase("fd_prep");
+    START_TIMER(fd_prep);
+    // INPUT+OUTPUT+MULT.
+    PRINT("fd_prep SEND");
+    // std::thread t_PrepMultPartiesSendP1( &tp::Circuit::PrepMultPartiesSendP1, &circuit ); 
+    // std::thread t_PrepMultP1ReceivesAndSends( &tp::Circuit::PrepMultP1ReceivesAndSends, &circuit ); 
+    // t_PrepMultPartiesSendP1.join();
+    // t_PrepMultP1ReceivesAndSends.join();
+    circuit.PrepMultPartiesSendP1(); 
+    circuit.PrepMultP1ReceivesAndSends(); 
+    circuit.PrepIOPartiesSendOwner(); 
+
+    PRINT("fd_prep RECV");
+    circuit.PrepMultPartiesReceive(); 
+    circuit.PrepIOOwnerReceives(); 
+
+    STOP_TIMER(fd_prep);
+  } else if ( prep ) {
+    // F.I. and F.D. preprocessing streamed over chunks of batches
+    DELIM;
+    std::cout << "Running pipelined preprocessing in chunks of " << chunk << " batches\n";
+    network.SetPhase("prep");
+    START_TIMER(prep);
+    circuit.PipelinedPrep(chunk);
+    STOP_TIMER(prep);
+  }
+
+  if ( !store.empty() && prep ) {
+    START_TIMER(save_prep);
+    circuit.SavePrep(store_path);
+    STOP_TIMER(save_prep);
+  }
+
+  if ( evals > 0 ) {
+    // The pool connects the parties on the ports after those of the
+    // network of the circuit
+    auto pool_config = scl::NetworkConfig::Localhost(id, n, DEFAULT_PORT_OFFSET + n);
+    auto pool_network = Connect(pool_config, net);
+    circuit.StartPrepPool(std::make_shared<scl::Network>(pool_network), 2);
+
+    for (std::size_t eval = 0; eval < evals; eval++) {
+      DELIM;
+      std::cout << "Running evaluation " << eval << " on preprocessing from the pool\n";
+      std::vector<tp::FF> result;
+      if (id == 0) {
+	// The gates cache their clear values, so these are computed
+	// on a fresh circuit
+	std::vector<tp::FF> inputs{tp::FF(0432432 + eval), tp::FF(54982 + eval)};
+	auto clear = tp::Circuit::FromConfig(circuit_config);
+	clear.SetClearInputsFlat(inputs);
+	result = clear.GetClearOutputsFlat();
+	circuit.SetInputs(inputs);
+      }
+
+      network.SetPhase("pool_fd_prep");
+      START_TIMER(pool_fd_prep);
+      circuit.PrepFromPool();
+      STOP_TIMER(pool_fd_prep);
+
+      network.SetPhase("pool_online");
+      START_TIMER(pool_online);
+      circuit.RunProtocol();
+      STOP_TIMER(pool_online);
+
+      if (id == 0) assert( circuit.GetOutputs() == result );
+    }
+
+    circuit.StopPrepPool();
+    pool_network.Close();
+    network.Close();
+    PrintStats(network, id);
+    return 0;
+  }
 
   std::vector<tp::FF> result;
   if (id == 0){
@@ -144,10 +277,12 @@ int main(int argc, char** argv) {
   START_TIMER(online);
   // INPUT
   PRINT("Input");
+  network.SetPhase("online_input");
   circuit.InputOwnerSendsP1(); 
   circuit.InputP1Receives(); 
 
   // MULT
+  network.SetPhase("online_mult");
   for (std::size_t layer = 0; layer < circuit_config.depth; layer++) {
     // PRINT("Mult layer " << layer);
     circuit.MultP1Sends(layer); 
@@ -158,6 +293,7 @@ int main(int argc, char** argv) {
 
   // OUTPUT
   PRINT("Output");
+  network.SetPhase("online_output");
   circuit.OutputP1SendsMu(); 
   circuit.OutputOwnerReceivesMu(); 
   STOP_TIMER(online);
@@ -172,5 +308,6 @@ int main(int argc, char** argv) {
   // technically not necessary as channels are destroyed when their dtor is
   // called.
   network.Close();
+  PrintStats(network, id);
 
 }
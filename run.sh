@@ -3,10 +3,12 @@ n=$1
 s=$2
 d=$3
 tag=$4
+net=${5:-${NET:-tcp}}
 
 usage () {
     echo $@
-    echo "usage: $0 [N] [size] [depth] [tag]"
+    echo "usage: $0 [N] [size] [depth] [tag] [net]"
+    echo "net (or \$NET) is passed on to ours.x and dn07.x, e.g. tcp:wan"
     exit 0
 }
 
@@ -14,7 +16,11 @@ if ! [[ $n =~ ^[0-9]+$ ]]; then
     usage "not a number:" $n
 fi
 
-echo "running: n=$n i s=$s d=$d"
+echo "running: n=$n i s=$s d=$d net=$net"
+
+# ours.x takes net after t, k and prss, so spell out their defaults
+t=$((($n - 1) / 2))
+k=$((($n - $t + 1) / 2))
 
 logext="experiment"
 
@@ -22,10 +28,10 @@ logdir="logs/logs_${logext}_${n}_${s}_${d}_${tag}"
 
 mkdir -p $logdir
 
-( ./build/ours.x $n 0 $s $d | tee "${logdir}/party_0.log" ) &
+( ./build/ours.x $n 0 $s $d $t $k "" $net | tee "${logdir}/party_0.log" ) &
 
 for i in $(seq 1 $(($n - 1))); do
-    ( ./build/ours.x $n $i $s $d &>"${logdir}/party_${i}.log" ) &
+    ( ./build/ours.x $n $i $s $d $t $k "" $net &>"${logdir}/party_${i}.log" ) &
     pid=$!
 done
 echo
@@ -37,10 +43,10 @@ sleep 2
 echo "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<"
 echo "Starting DN07"
 
-( ./build/dn07.x $n 0 $s $d | tee -a "${logdir}/party_0.log" ) &
+( ./build/dn07.x $n 0 $s $d $net | tee -a "${logdir}/party_0.log" ) &
 
 for i in $(seq 1 $(($n - 1))); do
-    ( ./build/dn07.x $n $i $s $d &>>"${logdir}/party_${i}.log" ) &
+    ( ./build/dn07.x $n $i $s $d $net &>>"${logdir}/party_${i}.log" ) &
 done
 echo
 
@@ -0,0 +1,207 @@
+/**
+ * @file kernels.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_MATH_KERNELS_H
+#define _SCL_MATH_KERNELS_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "scl/math/ff.h"
+
+namespace scl {
+namespace details {
+
+/**
+ * @brief Batch arithmetic over contiguous arrays of Mersenne61 values.
+ *
+ * @details Each instance is a table of kernels for one instruction set.
+ * Inputs and outputs are fully reduced, i.e., in [0, p). Use Best() to
+ * get the fastest kernels supported by the CPU running the program; the
+ * choice is made once, on first use.
+ */
+struct Mersenne61Kernels {
+  //! @brief dst[i] = dst[i] + src[i]
+  void (*Add)(std::uint64_t* dst, const std::uint64_t* src, std::size_t n);
+
+  //! @brief dst[i] = dst[i] * src[i]
+  void (*Multiply)(std::uint64_t* dst, const std::uint64_t* src,
+                   std::size_t n);
+
+  //! @brief dst[i] = dst[i] + scalar * src[i]
+  void (*MultiplyAccumulate)(std::uint64_t* dst, std::uint64_t scalar,
+                             const std::uint64_t* src, std::size_t n);
+
+  //! @brief Returns sum_i a[i] * b[i]
+  std::uint64_t (*Dot)(const std::uint64_t* a, const std::uint64_t* b,
+                       std::size_t n);
+
+  //! @brief Name of the instruction set, for reporting.
+  const char* mName;
+
+  /**
+   * @brief Portable kernels. Always available.
+   */
+  static const Mersenne61Kernels& Scalar();
+
+  /**
+   * @brief AVX2 kernels, or nullptr if the CPU does not support them.
+   */
+  static const Mersenne61Kernels* AVX2();
+
+  /**
+   * @brief AVX-512 IFMA kernels, or nullptr if the CPU does not support
+   * them.
+   */
+  static const Mersenne61Kernels* AVX512IFMA();
+
+  /**
+   * @brief The fastest kernels supported by this CPU.
+   */
+  static const Mersenne61Kernels& Best();
+};
+
+/**
+ * @brief dst[i] += src[i] for i < n.
+ */
+template <typename T>
+void AddMany(T* dst, const T* src, std::size_t n) {
+  for (std::size_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+/**
+ * @brief dst[i] *= src[i] for i < n.
+ */
+template <typename T>
+void MultiplyMany(T* dst, const T* src, std::size_t n) {
+  for (std::size_t i = 0; i < n; i++) dst[i] *= src[i];
+}
+
+/**
+ * @brief dst[i] += scalar * src[i] for i < n.
+ */
+template <typename T>
+void MultiplyAccumulateMany(T* dst, const T& scalar, const T* src,
+                            std::size_t n) {
+  for (std::size_t i = 0; i < n; i++) dst[i] += scalar * src[i];
+}
+
+/**
+ * @brief Returns the sum of a[i] * b[i] for i < n.
+ */
+template <typename T>
+T DotMany(const T* a, const T* b, std::size_t n) {
+  T result;
+  for (std::size_t i = 0; i < n; i++) result += a[i] * b[i];
+  return result;
+}
+
+/**
+ * @brief out[r] = sum_c mat[r * cols + c] * x[c] for r < rows, i.e., the
+ * product of a row-major rows x cols matrix with x.
+ */
+template <typename T>
+void MatVecMany(T* out, const T* mat, const T* x, std::size_t rows,
+                std::size_t cols) {
+  for (std::size_t r = 0; r < rows; r++) {
+    out[r] = DotMany(mat + r * cols, x, cols);
+  }
+}
+
+/**
+ * @brief Dot product of Mersenne61 values with lazy reduction.
+ *
+ * @details Products are accumulated unreduced in a 128-bit accumulator,
+ * which is reduced once every 63 terms and once at the end, instead of
+ * after every product and every addition. This is the fastest option for
+ * the short dot products of a matrix-vector product.
+ */
+std::uint64_t Mersenne61LazyDot(const std::uint64_t* a,
+                                const std::uint64_t* b, std::size_t n);
+
+/**
+ * @brief Finite field elements backed by Mersenne61.
+ */
+template <unsigned Bits>
+using Mersenne61FF = FF<Bits, FiniteField<NamedField::Mersenne61>>;
+
+/**
+ * @brief View an array of Mersenne61 elements as their raw values.
+ */
+template <unsigned Bits>
+std::uint64_t* RawValues(Mersenne61FF<Bits>* ptr) {
+  static_assert(sizeof(Mersenne61FF<Bits>) == sizeof(std::uint64_t));
+  static_assert(std::is_standard_layout_v<Mersenne61FF<Bits>>);
+  return reinterpret_cast<std::uint64_t*>(ptr);
+}
+
+template <unsigned Bits>
+const std::uint64_t* RawValues(const Mersenne61FF<Bits>* ptr) {
+  static_assert(sizeof(Mersenne61FF<Bits>) == sizeof(std::uint64_t));
+  static_assert(std::is_standard_layout_v<Mersenne61FF<Bits>>);
+  return reinterpret_cast<const std::uint64_t*>(ptr);
+}
+
+template <unsigned Bits>
+void AddMany(Mersenne61FF<Bits>* dst, const Mersenne61FF<Bits>* src,
+             std::size_t n) {
+  Mersenne61Kernels::Best().Add(RawValues(dst), RawValues(src), n);
+}
+
+template <unsigned Bits>
+void MultiplyMany(Mersenne61FF<Bits>* dst, const Mersenne61FF<Bits>* src,
+                  std::size_t n) {
+  Mersenne61Kernels::Best().Multiply(RawValues(dst), RawValues(src), n);
+}
+
+template <unsigned Bits>
+void MultiplyAccumulateMany(Mersenne61FF<Bits>* dst,
+                            const Mersenne61FF<Bits>& scalar,
+                            const Mersenne61FF<Bits>* src, std::size_t n) {
+  Mersenne61Kernels::Best().MultiplyAccumulate(
+      RawValues(dst), *RawValues(&scalar), RawValues(src), n);
+}
+
+template <unsigned Bits>
+Mersenne61FF<Bits> DotMany(const Mersenne61FF<Bits>* a,
+                           const Mersenne61FF<Bits>* b, std::size_t n) {
+  Mersenne61FF<Bits> result;
+  *RawValues(&result) =
+      Mersenne61Kernels::Best().Dot(RawValues(a), RawValues(b), n);
+  return result;
+}
+
+template <unsigned Bits>
+void MatVecMany(Mersenne61FF<Bits>* out, const Mersenne61FF<Bits>* mat,
+                const Mersenne61FF<Bits>* x, std::size_t rows,
+                std::size_t cols) {
+  auto raw_out = RawValues(out);
+  auto raw_mat = RawValues(mat);
+  auto raw_x = RawValues(x);
+  for (std::size_t r = 0; r < rows; r++) {
+    raw_out[r] = Mersenne61LazyDot(raw_mat + r * cols, raw_x, cols);
+  }
+}
+
+}  // namespace details
+}  // namespace scl
+
+#endif  // _SCL_MATH_KERNELS_H
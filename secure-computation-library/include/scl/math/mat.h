@@ -22,6 +22,7 @@
 #ifndef _SCL_MATH_MAT_H
 #define _SCL_MATH_MAT_H
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <iomanip>
@@ -31,6 +32,7 @@
 #include <string>
 #include <vector>
 
+#include "scl/math/kernels.h"
 #include "scl/prg.h"
 
 namespace scl {
@@ -170,10 +172,7 @@ class Mat {
    */
   Mat& AddInPlace(const Mat& other) {
     EnsureCompatible(other);
-    auto n = mValues.size();
-    for (std::size_t i = 0; i < n; ++i) {
-      mValues[i] += other.mValues[i];
-    }
+    details::AddMany(mValues.data(), other.mValues.data(), mValues.size());
     return *this;
   };
 
@@ -227,10 +226,7 @@ class Mat {
    */
   Mat& MultiplyEntryWiseInPlace(const Mat& other) {
     EnsureCompatible(other);
-    auto n = mValues.size();
-    for (std::size_t i = 0; i < n; i++) {
-      mValues[i] *= other.mValues[i];
-    }
+    details::MultiplyMany(mValues.data(), other.mValues.data(), mValues.size());
     return *this;
   };
 
@@ -243,6 +239,15 @@ class Mat {
    */
   Mat Multiply(const Mat& other) const;
 
+  /**
+   * @brief Performs a matrix-vector multiplication.
+   * @param vector the vector
+   * @return the product of this and \p vector.
+   * @throws std::illegal_argument if the dimensions of the inputs are
+   *         incompatible.
+   */
+  Vec<T> Multiply(const Vec<T>& vector) const;
+
   /**
    * @brief Multiply this matrix with a scalar
    * @param scalar the scalar
@@ -336,6 +341,16 @@ class Mat {
    */
   std::size_t ByteSize() const { return Rows() * Cols() * T::ByteSize(); }
 
+  /**
+   * @brief The entries of this matrix in row-major order.
+   */
+  T* Data() { return mValues.data(); };
+
+  /**
+   * @brief The entries of this matrix in row-major order.
+   */
+  const T* Data() const { return mValues.data(); };
+
  private:
   Mat(std::size_t r, std::size_t c, std::vector<T> v)
       : mRows(r), mCols(c), mValues(v){};
@@ -400,11 +415,27 @@ Mat<T> Mat<T>::Multiply(const Mat<T>& other) const {
   const auto p = Cols();
   const auto m = other.Cols();
 
+  // Blocked over the columns of other and the inner dimension, so that
+  // a kBlockInner x kBlockCols panel of other stays in cache while every
+  // row of this is multiplied into it. This matters for wide products,
+  // e.g., sharing all the batches of a layer at once.
+  constexpr std::size_t kBlockCols = 512;
+  constexpr std::size_t kBlockInner = 64;
+
   Mat result(n, m);
-  for (std::size_t i = 0; i < n; i++) {
-    for (std::size_t k = 0; k < p; k++) {
-      for (std::size_t j = 0; j < m; j++) {
-        result(i, j) += operator()(i, k) * other(k, j);
+  const T* a = mValues.data();
+  const T* b = other.mValues.data();
+  T* c = result.mValues.data();
+  for (std::size_t jj = 0; jj < m; jj += kBlockCols) {
+    const auto j_end = std::min(jj + kBlockCols, m);
+    for (std::size_t kk = 0; kk < p; kk += kBlockInner) {
+      const auto k_end = std::min(kk + kBlockInner, p);
+      for (std::size_t i = 0; i < n; i++) {
+        T* c_row = c + i * m;
+        for (std::size_t k = kk; k < k_end; k++) {
+          details::MultiplyAccumulateMany(c_row + jj, a[i * p + k],
+                                          b + k * m + jj, j_end - jj);
+        }
       }
     }
   }
@@ -28,6 +28,7 @@
 #include <type_traits>
 #include <vector>
 
+#include "scl/math/kernels.h"
 #include "scl/math/mat.h"
 #include "scl/prg.h"
 
@@ -170,9 +171,7 @@ class Vec {
    */
   Vec& AddInPlace(const Vec& other) {
     EnsureCompatible(other);
-    for (std::size_t i = 0; i < Size(); i++) {
-      mValues[i] += other.mValues[i];
-    }
+    details::AddMany(mValues.data(), other.mValues.data(), Size());
     return *this;
   };
 
@@ -210,9 +209,7 @@ class Vec {
    */
   Vec& MultiplyEntryWiseInPlace(const Vec& other) {
     EnsureCompatible(other);
-    for (std::size_t i = 0; i < Size(); i++) {
-      mValues[i] *= other.mValues[i];
-    }
+    details::MultiplyMany(mValues.data(), other.mValues.data(), Size());
     return *this;
   };
 
@@ -223,10 +220,7 @@ class Vec {
    */
   T Dot(const Vec& other) const {
     EnsureCompatible(other);
-    T result;
-    for (std::size_t i = 0; i < Size(); i++)
-      result += mValues[i] * other.mValues[i];
-    return result;
+    return details::DotMany(mValues.data(), other.mValues.data(), Size());
   };
 
   /**
@@ -378,6 +372,8 @@ class Vec {
   };
 
   std::vector<T> mValues;
+
+  friend class Mat<T>;
 };
 
 template <typename T>
@@ -421,13 +417,8 @@ Vec<T> Vec<T>::Random(std::size_t n, PRG& prg) {
 template <typename T>
 Vec<T> Vec<T>::Add(const Vec<T>& other) const {
   EnsureCompatible(other);
-  std::vector<T> r;
-  auto n = Size();
-  r.reserve(n);
-  for (std::size_t i = 0; i < n; i++) {
-    r.emplace_back(mValues[i] + other.mValues[i]);
-  }
-  return Vec(r);
+  Vec r(mValues);
+  return r.AddInPlace(other);
 }
 
 template <typename T>
@@ -445,13 +436,18 @@ Vec<T> Vec<T>::Subtract(const Vec<T>& other) const {
 template <typename T>
 Vec<T> Vec<T>::MultiplyEntryWise(const Vec<T>& other) const {
   EnsureCompatible(other);
-  std::vector<T> r;
-  auto n = Size();
-  r.reserve(n);
-  for (std::size_t i = 0; i < n; i++) {
-    r.emplace_back(mValues[i] * other.mValues[i]);
-  }
-  return Vec(r);
+  Vec r(mValues);
+  return r.MultiplyEntryWiseInPlace(other);
+}
+
+template <typename T>
+Vec<T> Mat<T>::Multiply(const Vec<T>& vector) const {
+  if (Cols() != vector.Size())
+    throw std::invalid_argument("invalid matrix dimensions for multiply");
+  Vec<T> result(Rows());
+  details::MatVecMany(result.mValues.data(), mValues.data(),
+                      vector.mValues.data(), Rows(), Cols());
+  return result;
 }
 
 template <typename T>
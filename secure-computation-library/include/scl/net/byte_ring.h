@@ -0,0 +1,98 @@
+/**
+ * @file byte_ring.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_BYTE_RING_H
+#define _SCL_NET_BYTE_RING_H
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "scl/net/futex.h"
+
+namespace scl {
+namespace details {
+
+/**
+ * @brief A bounded single-producer single-consumer byte ring.
+ *
+ * The producer copies bytes in with Write, which blocks while the ring is full.
+ * The consumer gets everything written so far as at most two contiguous
+ * regions, which can be handed to writev(2) in one go, and then releases what
+ * it used with Consume.
+ */
+class ByteRing {
+ public:
+  /**
+   * @brief Create a ring.
+   * @param capacity the number of bytes the ring can hold
+   */
+  ByteRing(std::size_t capacity);
+
+  /**
+   * @brief Write n bytes, blocking while the ring is full.
+   *
+   * Throws std::runtime_error if the ring is closed while waiting for space.
+   */
+  void Write(const unsigned char* src, std::size_t n);
+
+  /**
+   * @brief Wait for data, and point iov at all the data in the ring.
+   * @return the number of regions used, or 0 if the ring is closed and empty
+   */
+  int Readable(struct iovec (&iov)[2]);
+
+  /**
+   * @brief Release the first n readable bytes.
+   */
+  void Consume(std::size_t n);
+
+  /**
+   * @brief Close the ring.
+   *
+   * The consumer can still read what was written before, and a producer
+   * waiting for space is woken up.
+   */
+  void Close();
+
+  /**
+   * @brief Whether the ring is closed.
+   */
+  bool Closed() const { return mClosed.load(); };
+
+ private:
+  std::size_t mCapacity;
+  std::unique_ptr<unsigned char[]> mData;
+  std::atomic<bool> mClosed;
+
+  alignas(64) std::atomic<std::uint64_t> mHead;
+  alignas(64) std::atomic<std::uint64_t> mTail;
+  alignas(64) FutexSignal mDataSignal;
+  alignas(64) FutexSignal mSpaceSignal;
+};
+
+}  // namespace details
+}  // namespace scl
+
+#endif /* _SCL_NET_BYTE_RING_H */
@@ -22,11 +22,18 @@
 #ifndef _SCL_NET_CHANNEL_H
 #define _SCL_NET_CHANNEL_H
 
+#include <sys/uio.h>
+
 #include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
 
+#include "scl/math/ff.h"
 #include "scl/math/mat.h"
 #include "scl/math/vec.h"
 #include "scl/net/config.h"
@@ -60,6 +67,28 @@ using IsCopyable =
 
 }  // namespace
 
+namespace details {
+
+class RecvQueue;
+
+/**
+ * @brief Whether T is serialized as the bytes of the object.
+ *
+ * The fields write an element as the bytes of its internal value, so a
+ * container of elements can be sent as is. Reading an element additionally
+ * reduces it, which a receiver must still do.
+ */
+template <typename T>
+struct IsRawSerializable : std::false_type {};
+
+template <unsigned Bits, typename Field>
+struct IsRawSerializable<FF<Bits, Field>>
+    : std::bool_constant<std::is_trivially_copyable_v<FF<Bits, Field>> &&
+                         sizeof(FF<Bits, Field>) ==
+                             FF<Bits, Field>::ByteSize()> {};
+
+}  // namespace details
+
 #define _SCL_CC(x) reinterpret_cast<const unsigned char*>(x)
 #define _SCL_C(x) reinterpret_cast<unsigned char*>(x)
 
@@ -76,6 +105,13 @@ using IsCopyable =
  */
 class Channel {
  public:
+  /**
+   * @brief Destroy the channel.
+   *
+   * Receives started with RecvAsync must have completed.
+   */
+  virtual ~Channel();
+
   /**
    * @brief Close connection to remote.
    */
@@ -95,6 +131,86 @@ class Channel {
    */
   virtual void Recv(unsigned char* dst, std::size_t n) = 0;
 
+  /**
+   * @brief Send several buffers to the remote party, in order.
+   *
+   * The default implementation calls Send on each buffer. Channels that can
+   * pass a list of buffers to the operating system at once override this.
+   *
+   * @param iov the buffers to send
+   * @param count the number of buffers
+   */
+  virtual void SendV(const struct iovec* iov, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i)
+      Send(_SCL_CC(iov[i].iov_base), iov[i].iov_len);
+  }
+
+  /**
+   * @brief Receive at most n bytes without waiting for them.
+   *
+   * The default implementation waits until all \p n bytes are received, which
+   * is correct for callers such as scl::Round, but does not let them receive
+   * from other channels in the meantime.
+   *
+   * @param dst where to store the received data
+   * @param n the maximum number of bytes to receive
+   * @return the number of bytes received
+   */
+  virtual std::size_t TryRecv(unsigned char* dst, std::size_t n) {
+    Recv(dst, n);
+    return n;
+  }
+
+  /**
+   * @brief A file descriptor that becomes readable when TryRecv can make
+   * progress, or -1 if the channel has none.
+   */
+  virtual int PollDescriptor() const { return -1; }
+
+  /**
+   * @brief Receive data from the remote party in the background.
+   *
+   * Receives started with RecvAsync complete in the order they were started,
+   * one after the other, on a thread of the channel. Until the returned future
+   * is ready, \p dst must not be touched, and no blocking receive may be made
+   * on the channel. Errors are reported through the future.
+   *
+   * @param dst where to store the received data
+   * @param n how much data to receive
+   * @return a future that is ready once all \p n bytes have been received
+   */
+  std::future<void> RecvAsync(unsigned char* dst, std::size_t n) {
+    return Enqueue([this, dst, n]() { Recv(dst, n); });
+  }
+
+  /**
+   * @brief Receive field elements into a range in the background.
+   *
+   * Like RecvAsync(unsigned char*, std::size_t), but the elements are reduced
+   * as Recv(Vec<T>&) would before the future is ready.
+   *
+   * @param dst the first element of the range
+   * @param count the number of elements to receive
+   */
+  template <typename T,
+            std::enable_if_t<details::IsRawSerializable<T>::value, bool> = true>
+  std::future<void> RecvAsync(T* dst, std::size_t count) {
+    return Enqueue([this, dst, count]() { RecvRaw(dst, count); });
+  }
+
+  /**
+   * @brief Receive anything Recv can receive in the background.
+   *
+   * Like RecvAsync(unsigned char*, std::size_t), with <code>Recv(obj)</code>
+   * run on the thread of the channel.
+   *
+   * @param obj where to store the received object
+   */
+  template <typename T>
+  std::future<void> RecvAsync(T& obj) {
+    return Enqueue([this, &obj]() { Recv(obj); });
+  }
+
   /**
    * @brief Send a trivially copyable item.
    * @param src the thing to send
@@ -121,9 +237,9 @@ class Channel {
    * @brief Send a vector object.
    *
    * Note that \p T cannot be guaranteed to be trivially copyable so this method
-   * needs to make a temporary copy of \p vec in order to serialize it
-   * correctly. If \p T is known to be trivially copyable, then it might be
-   * faster to call <code>Send(vec.ToStlVector())</code> instead.
+   * may need to make a temporary copy of \p vec in order to serialize it
+   * correctly. Vectors of field elements are sent directly from their
+   * storage, together with their size in a single SendV.
    *
    * This method sends the size of the vector first followed by its content.
    *
@@ -131,20 +247,58 @@ class Channel {
    */
   template <typename T>
   void Send(const Vec<T>& vec) {
-    const std::uint32_t vec_size = vec.Size();
-    Send(vec_size);
-    // have to make a copy here since it's not guaranteed that we can directly
-    // write T to the channel.
-    auto buf = std::make_unique<unsigned char[]>(vec.ByteSize());
-    vec.Write(buf.get());
-    Send(_SCL_CC(buf.get()), vec.ByteSize());
+    SendMany(&vec, 1);
+  }
+
+  /**
+   * @brief Send a list of vectors.
+   *
+   * This is the same as sending each vector in turn, so the vectors can be
+   * received one by one. Vectors of field elements are passed to a single SendV
+   * without copying them.
+   *
+   * @param vecs the vectors
+   * @param count the number of vectors
+   */
+  template <typename T>
+  void SendMany(const Vec<T>* vecs, std::size_t count) {
+    if constexpr (details::IsRawSerializable<T>::value) {
+      std::vector<std::uint32_t> sizes(count);
+      std::vector<struct iovec> iov(2 * count);
+      for (std::size_t i = 0; i < count; ++i) {
+        sizes[i] = vecs[i].Size();
+        iov[2 * i] = {&sizes[i], sizeof(std::uint32_t)};
+        iov[2 * i + 1] = {const_cast<T*>(vecs[i].ToStlVector().data()),
+                          vecs[i].ByteSize()};
+      }
+      SendV(iov.data(), iov.size());
+    } else {
+      for (std::size_t i = 0; i < count; ++i) {
+        const std::uint32_t vec_size = vecs[i].Size();
+        Send(vec_size);
+        // have to make a copy here since it's not guaranteed that we can
+        // directly write T to the channel.
+        auto buf = std::make_unique<unsigned char[]>(vecs[i].ByteSize());
+        vecs[i].Write(buf.get());
+        Send(_SCL_CC(buf.get()), vecs[i].ByteSize());
+      }
+    }
+  }
+
+  /**
+   * @brief Send a list of vectors.
+   * @param vecs the vectors
+   */
+  template <typename T>
+  void SendMany(const std::vector<Vec<T>>& vecs) {
+    SendMany(vecs.data(), vecs.size());
   }
 
   /**
    * @brief Send a matrix.
    *
-   * Like with Send(const Vec<T>&) this method makes a copy of \p mat internally
-   * in order to serialize the matrix correctly.
+   * Like with Send(const Vec<T>&) this method may make a copy of \p mat
+   * internally in order to serialize the matrix correctly.
    *
    * Also similar to Send(const Vec<T>&) this method first sends the row count,
    * then column count and finally the matrix content.
@@ -153,13 +307,19 @@ class Channel {
    */
   template <typename T>
   void Send(const Mat<T>& mat) {
-    const std::uint32_t rows = mat.Rows();
-    const std::uint32_t cols = mat.Cols();
-    Send(rows);
-    Send(cols);
-    auto buf = std::make_unique<unsigned char[]>(mat.ByteSize());
-    mat.Write(buf.get());
-    Send(_SCL_CC(buf.get()), mat.ByteSize());
+    const std::uint32_t shape[2] = {static_cast<std::uint32_t>(mat.Rows()),
+                                    static_cast<std::uint32_t>(mat.Cols())};
+    if constexpr (details::IsRawSerializable<T>::value) {
+      struct iovec iov[2] = {
+          {const_cast<std::uint32_t*>(shape), sizeof(shape)},
+          {const_cast<T*>(mat.Data()), mat.ByteSize()}};
+      SendV(iov, 2);
+    } else {
+      Send(_SCL_CC(shape), sizeof(shape));
+      auto buf = std::make_unique<unsigned char[]>(mat.ByteSize());
+      mat.Write(buf.get());
+      Send(_SCL_CC(buf.get()), mat.ByteSize());
+    }
   }
 
   /**
@@ -185,6 +345,10 @@ class Channel {
 
   /**
    * @brief Receive a vector.
+   *
+   * Vectors of field elements are received directly into \p vec, which is
+   * only reallocated if it does not have the received size already.
+   *
    * @param vec where to store the received vector
    * @throws std::logic_error in case the received vector size exceeds
    * MAX_VEC_READ_SIZE
@@ -194,10 +358,37 @@ class Channel {
     auto vec_size = RecvSize();
     if (vec_size > MAX_VEC_READ_SIZE)
       throw std::logic_error("received vector exceeds size limit");
-    auto n = vec_size * T::ByteSize();
-    auto buf = std::make_unique<unsigned char[]>(n);
-    Recv(_SCL_C(buf.get()), n);
-    vec = Vec<T>::Read(vec_size, _SCL_CC(buf.get()));
+    if constexpr (details::IsRawSerializable<T>::value) {
+      if (vec.Size() != vec_size) vec = Vec<T>(vec_size);
+      RecvRaw(vec.ToStlVector().data(), vec_size);
+    } else {
+      auto n = vec_size * T::ByteSize();
+      auto buf = std::make_unique<unsigned char[]>(n);
+      Recv(_SCL_C(buf.get()), n);
+      vec = Vec<T>::Read(vec_size, _SCL_CC(buf.get()));
+    }
+  }
+
+  /**
+   * @brief Receive a list of vectors sent with SendMany.
+   * @param vecs where to store the received vectors
+   * @param count the number of vectors
+   */
+  template <typename T>
+  void RecvMany(Vec<T>* vecs, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) Recv(vecs[i]);
+  }
+
+  /**
+   * @brief Receive a list of vectors sent with SendMany.
+   *
+   * <code>vecs.size()</code> determines how many vectors to receive.
+   *
+   * @param vecs where to store the received vectors
+   */
+  template <typename T>
+  void RecvMany(std::vector<Vec<T>>& vecs) {
+    RecvMany(vecs.data(), vecs.size());
   }
 
   /**
@@ -212,18 +403,39 @@ class Channel {
     auto cols = RecvSize();
     if (rows * cols > MAX_MAT_READ_SIZE)
       throw std::logic_error("received matrix exceeds size limit");
-    auto n = rows * cols * T::ByteSize();
-    auto buf = std::make_unique<unsigned char[]>(n);
-    Recv(_SCL_C(buf.get()), n);
-    mat = Mat<T>::Read(rows, cols, _SCL_CC(buf.get()));
+    if constexpr (details::IsRawSerializable<T>::value) {
+      if (rows * cols == 0) {
+        mat = Mat<T>::Read(rows, cols, nullptr);
+        return;
+      }
+      if (mat.Rows() != rows || mat.Cols() != cols) mat = Mat<T>(rows, cols);
+      RecvRaw(mat.Data(), rows * cols);
+    } else {
+      auto n = rows * cols * T::ByteSize();
+      auto buf = std::make_unique<unsigned char[]>(n);
+      Recv(_SCL_C(buf.get()), n);
+      mat = Mat<T>::Read(rows, cols, _SCL_CC(buf.get()));
+    }
   }
 
  private:
+  std::future<void> Enqueue(std::function<void()> recv);
+
   std::uint32_t RecvSize() {
     std::uint32_t size;
     Recv(size);
     return size;
   }
+
+  // Receive n elements into dst, and reduce them as T::Read would
+  template <typename T>
+  void RecvRaw(T* dst, std::size_t n) {
+    Recv(_SCL_C(dst), n * sizeof(T));
+    for (std::size_t i = 0; i < n; ++i) dst[i] = T::Read(_SCL_CC(dst + i));
+  }
+
+  std::once_flag mRecvQueueStarted;
+  std::shared_ptr<details::RecvQueue> mRecvQueue;
 };
 
 #undef _SCL_C
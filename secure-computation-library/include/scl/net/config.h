@@ -22,6 +22,8 @@
 #ifndef _SCL_NET_CONFIG_H
 #define _SCL_NET_CONFIG_H
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -56,6 +58,45 @@ struct Party {
   int port;
 };
 
+/**
+ * @brief Options for the TCP connections of a network.
+ */
+struct TcpOptions {
+  /**
+   * @brief How long to wait for all peers, or 0 to wait forever.
+   */
+  std::chrono::milliseconds timeout = std::chrono::seconds(60);
+
+  /**
+   * @brief Whether to send small messages right away (TCP_NODELAY).
+   */
+  bool no_delay = true;
+
+  /**
+   * @brief Size of the send buffer of each socket, or 0 for the default.
+   */
+  int send_buffer = 0;
+
+  /**
+   * @brief Size of the receive buffer of each socket, or 0 for the default.
+   */
+  int recv_buffer = 0;
+
+  /**
+   * @brief Number of streams to stripe large messages across.
+   *
+   * With more than one, each peer is connected by this many sockets for large
+   * messages plus one for small ones, see scl::StripedChannel. All parties
+   * must use the same value.
+   */
+  std::size_t streams = 1;
+
+  /**
+   * @brief Size in bytes from which a message is striped.
+   */
+  std::size_t stripe_threshold = 1 << 18;
+};
+
 /**
  * @brief Network configuration.
  *
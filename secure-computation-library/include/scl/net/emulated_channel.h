@@ -0,0 +1,212 @@
+/**
+ * @file emulated_channel.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_EMULATED_CHANNEL_H
+#define _SCL_NET_EMULATED_CHANNEL_H
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scl/net/channel.h"
+
+namespace scl {
+
+/**
+ * @brief Conditions of one direction of an emulated link.
+ *
+ * The defaults describe a perfect link.
+ */
+struct LinkConditions {
+  /**
+   * @brief Fixed one-way latency.
+   */
+  std::chrono::microseconds latency{0};
+
+  /**
+   * @brief Largest extra latency added to a message.
+   *
+   * The extra latency of each message is uniformly random, but messages are
+   * never reordered.
+   */
+  std::chrono::microseconds jitter{0};
+
+  /**
+   * @brief Bandwidth in bits per second, or 0 for no limit.
+   */
+  double bandwidth = 0;
+
+  /**
+   * @brief Number of bytes that can be sent at once after the link was idle.
+   */
+  std::size_t burst = 0;
+
+  /**
+   * @brief Seed of the random jitter.
+   */
+  std::uint64_t seed = 0;
+
+  /**
+   * @brief Parse a profile.
+   *
+   * A profile is either "lan" (1 ms, 8 Gbit/s, tc's 1Gbps), "wan" (100 ms,
+   * 800 Mbit/s, tc's 100Mbps) or "<delay>,<rate>" with a delay in
+   * milliseconds and a rate in Mbit/s, like the arguments to network.sh.
+   */
+  static LinkConditions FromProfile(const std::string& profile);
+};
+
+/**
+ * @brief A clock that can be moved forward.
+ *
+ * Used by emulated channels in virtual time, where a party that waits for a
+ * message moves its clock to the time the message arrives instead of sleeping
+ * until then. All channels of a party should share the same clock.
+ */
+class VirtualClock {
+ public:
+  /**
+   * @brief The clock that virtual time runs alongside.
+   */
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief The current virtual time.
+   */
+  Clock::time_point Now() const {
+    return Clock::now() + Clock::duration(mOffset.load());
+  };
+
+  /**
+   * @brief Move the clock forward to at least t.
+   */
+  void AdvanceTo(Clock::time_point t);
+
+  /**
+   * @brief How far the clock is ahead of real time.
+   */
+  Clock::duration Offset() const { return Clock::duration(mOffset.load()); };
+
+ private:
+  std::atomic<Clock::rep> mOffset{0};
+};
+
+/**
+ * @brief A decorator for channels that emulates latency and limited bandwidth.
+ *
+ * Each Send takes its turn on the link according to a token bucket, and is
+ * delivered one latency (plus jitter) after it has been put on the link. In
+ * real time a delivery thread holds every message back until then, much like
+ * netem would. In virtual time nothing sleeps: messages are tagged with their
+ * arrival time, and receiving one moves the receiver's clock forward to it.
+ * Both ends of a link must use the same mode.
+ */
+class EmulatedChannel final : public Channel {
+ public:
+  /**
+   * @brief Decorate a channel.
+   * @param channel the channel carrying the messages
+   * @param conditions the conditions of messages sent on this channel
+   * @param clock the clock of the party in virtual time, or nullptr to run in
+   * real time
+   */
+  EmulatedChannel(std::shared_ptr<Channel> channel, LinkConditions conditions,
+                  std::shared_ptr<VirtualClock> clock = nullptr);
+
+  /**
+   * @brief Delivers what is held back.
+   */
+  ~EmulatedChannel();
+
+  using Channel::Recv;
+  using Channel::Send;
+
+  /**
+   * @brief Delivers what is held back and closes the channel.
+   *
+   * Rethrows the error of the delivery thread, if sending failed.
+   */
+  void Close() override;
+
+  void Send(const unsigned char* src, std::size_t n) override;
+
+  void SendV(const struct iovec* iov, std::size_t count) override;
+
+  void Recv(unsigned char* dst, std::size_t n) override;
+
+  std::size_t TryRecv(unsigned char* dst, std::size_t n) override;
+
+  int PollDescriptor() const override { return mChannel->PollDescriptor(); };
+
+ private:
+  using Clock = VirtualClock::Clock;
+
+  // Arrival time of a message of n bytes sent now
+  Clock::time_point Schedule(std::size_t n);
+
+  void Deliver();
+
+  // Read the rest of the frame header. Returns false if it is not all there
+  bool ReadFrameHeader(bool block);
+
+  std::shared_ptr<Channel> mChannel;
+  LinkConditions mConditions;
+  std::shared_ptr<VirtualClock> mClock;
+
+  double mTokens = 0;
+  Clock::time_point mRefilled;
+  Clock::time_point mLastArrival;
+  std::mt19937_64 mRng;
+
+  struct Message {
+    Clock::time_point arrival;
+    std::vector<unsigned char> data;
+  };
+
+  // Real time: messages held back by the delivery thread
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  std::deque<Message> mQueue;
+  bool mClosing = false;
+  std::exception_ptr mError;
+  std::thread mDeliverer;
+
+  // Virtual time: the header of the frame being received
+  unsigned char mFrameHeader[16];
+  std::size_t mFrameHeaderRead = 0;
+  std::uint64_t mFrameLeft = 0;
+};
+
+}  // namespace scl
+
+#endif /* _SCL_NET_EMULATED_CHANNEL_H */
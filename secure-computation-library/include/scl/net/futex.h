@@ -0,0 +1,109 @@
+/**
+ * @file futex.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_FUTEX_H
+#define _SCL_NET_FUTEX_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+namespace scl {
+namespace details {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) &&
+                  std::atomic<std::uint32_t>::is_always_lock_free,
+              "futex words must be plain 32-bit integers");
+
+/**
+ * @brief Lets one thread wait for progress made by another.
+ *
+ * The waiter polls its condition for a while, and then sleeps on a futex until
+ * the other side calls Notify. The futex is not FUTEX_PRIVATE, so a signal in
+ * shared memory works across processes.
+ */
+class FutexSignal {
+ public:
+  /**
+   * @brief Number of times the condition is polled before sleeping.
+   */
+  static constexpr int kSpins = 1 << 10;
+
+  /**
+   * @brief Wait until ready() holds.
+   *
+   * The other side must publish whatever makes ready() hold before calling
+   * Notify. Since the waiting flag is set before the condition is checked, and
+   * seq is read before either, no wake-up is lost.
+   */
+  template <typename Pred>
+  void WaitUntil(Pred ready) {
+    for (int i = 0; i < kSpins; ++i) {
+      if (ready()) return;
+      CpuRelax();
+    }
+
+    while (!ready()) {
+      const auto s = mSeq.load();
+      mWaiting.store(1);
+      if (!ready()) {
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&mSeq),
+                  FUTEX_WAIT, s, nullptr, nullptr, 0);
+      }
+      mWaiting.store(0);
+    }
+  }
+
+  /**
+   * @brief Wake up the waiter, if it is sleeping.
+   */
+  void Notify() {
+    if (mWaiting.load()) NotifyAlways();
+  }
+
+  /**
+   * @brief Wake up the waiter, also if it is about to sleep.
+   */
+  void NotifyAlways() {
+    mSeq.fetch_add(1);
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&mSeq), FUTEX_WAKE,
+              INT_MAX, nullptr, nullptr, 0);
+  }
+
+ private:
+  static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  std::atomic<std::uint32_t> mSeq{0};
+  std::atomic<std::uint32_t> mWaiting{0};
+};
+
+}  // namespace details
+}  // namespace scl
+
+#endif /* _SCL_NET_FUTEX_H */
@@ -24,13 +24,18 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "scl/net/channel.h"
 #include "scl/net/config.h"
+#include "scl/net/emulated_channel.h"
 #include "scl/net/mem_channel.h"
+#include "scl/net/shm_channel.h"
+#include "scl/net/stats.h"
+#include "scl/net/striped_channel.h"
 #include "scl/net/tcp_channel.h"
 
 namespace scl {
@@ -44,22 +49,93 @@ class Network {
    * @brief Create a network using a network config.
    *
    * This creates a network where parties are connected using private
-   * peer-to-peer channels over TPC.
+   * peer-to-peer channels over TPC. Parties may be started in any order: the
+   * connections to peers are made concurrently, and retried until the peer is
+   * up or \p options.timeout has passed. With \p options.streams above one,
+   * each peer is connected by several sockets joined in an
+   * scl::StripedChannel.
    *
    * @param config the network configuration to use
+   * @param options the options of the connections
    */
-  static Network Create(const NetworkConfig& config);
+  static Network Create(const NetworkConfig& config,
+                        const TcpOptions& options = TcpOptions());
 
   /**
    * @brief Create a network using a network config.
    *
    * This creates a network where parties are connected using private
-   * peer-to-peer channels over TPC. The channels are wrapped in the
-   * scl::ThreadedSender decorator.
+   * peer-to-peer channels over TPC, like Create. The channels are wrapped in
+   * the scl::ThreadedSender decorator.
    *
    * @param config the config
+   * @param options the options of the connections
    */
-  static Network CreateThreadedSenders(const NetworkConfig& config);
+  static Network CreateThreadedSenders(
+      const NetworkConfig& config, const TcpOptions& options = TcpOptions());
+
+  /**
+   * @brief Create a network of parties running on the same host.
+   *
+   * This creates a network where parties are connected using scl::ShmChannel,
+   * so that messages are exchanged through shared memory instead of the
+   * kernel's TCP stack. Only the id and size of \p config are used, together
+   * with the port of the first party which, like the ports of a TCP network,
+   * tells apart networks running at the same time.
+   *
+   * @param config the network configuration to use
+   * @param capacity the capacity in bytes of the ring to each peer
+   */
+  static Network CreateSharedMemory(
+      const NetworkConfig& config,
+      std::size_t capacity = ShmChannel::kDefaultCapacity);
+
+  /**
+   * @brief Emulate network conditions on top of an existing network.
+   *
+   * This wraps the channel to each peer of \p network in scl::EmulatedChannel,
+   * so that parties on one host can be benchmarked under LAN or WAN conditions
+   * without shaping the host's network interface. The channel of a party to
+   * itself is left as is. All parties must agree on whether virtual time is
+   * used.
+   *
+   * @param network the network to decorate
+   * @param id the id of the party owning the network
+   * @param links the conditions of messages sent to each party
+   * @param clock the clock of the party in virtual time, or nullptr to emulate
+   * in real time
+   */
+  static Network CreateEmulated(const Network& network, unsigned id,
+                                const std::vector<LinkConditions>& links,
+                                std::shared_ptr<VirtualClock> clock = nullptr);
+
+  /**
+   * @brief Emulate the same conditions on every link of a network.
+   *
+   * The jitter of the link from party i to party j is seeded with
+   * <code>link.seed + i * n + j</code>.
+   *
+   * @param network the network to decorate
+   * @param id the id of the party owning the network
+   * @param link the conditions of messages sent to any party
+   * @param clock the clock of the party in virtual time, or nullptr to emulate
+   * in real time
+   */
+  static Network CreateEmulated(const Network& network, unsigned id,
+                                const LinkConditions& link,
+                                std::shared_ptr<VirtualClock> clock = nullptr);
+
+  /**
+   * @brief Count the traffic of an existing network.
+   *
+   * This wraps the channel to each peer of \p network in
+   * scl::InstrumentedChannel. The counters are available through Stats, and
+   * SetPhase labels the traffic that follows.
+   *
+   * @param network the network to decorate
+   * @param id the id of the party owning the network
+   */
+  static Network CreateInstrumented(const Network& network, unsigned id);
 
   /**
    * @brief Create a mock network.
@@ -111,8 +187,21 @@ class Network {
     for (auto c : mChannels) c->Close();
   };
 
+  /**
+   * @brief The traffic counters, or nullptr if the network is not instrumented.
+   */
+  NetworkStats* Stats() { return mStats.get(); };
+
+  /**
+   * @brief Label the traffic that follows, if the network is instrumented.
+   */
+  void SetPhase(const std::string& name) {
+    if (mStats) mStats->SetPhase(name);
+  };
+
  private:
   std::vector<std::shared_ptr<Channel>> mChannels;
+  std::shared_ptr<NetworkStats> mStats;
 };
 
 }  // namespace scl
@@ -0,0 +1,71 @@
+/**
+ * @file recv_queue.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_RECV_QUEUE_H
+#define _SCL_NET_RECV_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace scl {
+namespace details {
+
+/**
+ * @brief Runs the asynchronous receives of a channel in order.
+ *
+ * Each receive is a function that blocks until its data is there. A thread
+ * started with the queue runs them one after the other, and completes their
+ * futures.
+ */
+class RecvQueue {
+ public:
+  RecvQueue();
+
+  /**
+   * @brief Waits for the receives that were queued, and stops the thread.
+   */
+  ~RecvQueue();
+
+  /**
+   * @brief Queue a receive.
+   * @return a future that is ready once \p recv has returned
+   */
+  std::future<void> Push(std::function<void()> recv);
+
+ private:
+  void Run();
+
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  std::deque<std::pair<std::function<void()>, std::promise<void>>> mQueue;
+  bool mStopping = false;
+  std::thread mWorker;
+};
+
+}  // namespace details
+}  // namespace scl
+
+#endif /* _SCL_NET_RECV_QUEUE_H */
@@ -0,0 +1,121 @@
+/**
+ * @file round.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_ROUND_H
+#define _SCL_NET_ROUND_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "scl/net/network.h"
+
+namespace scl {
+
+/**
+ * @brief One round of communication with the parties of a network.
+ *
+ * A round lists the messages to receive from each party, and then receives
+ * them all at once with Run. Data is taken from whichever party it is
+ * available from, so a party that is late to send does not hold up the
+ * processing of what the others already sent. Channels with a
+ * PollDescriptor, such as TCP channels, are waited on together with
+ * epoll(7).
+ *
+ * Messages to send are sent right away, so that a round works best with
+ * channels whose Send does not block, such as scl::ThreadedSenderChannel.
+ */
+class Round {
+ public:
+  /**
+   * @brief Called with the id of a party once a message from it is received.
+   */
+  using Handler = std::function<void(std::size_t)>;
+
+  /**
+   * @brief Create a round over a network.
+   * @param network the network, which must outlive the round
+   */
+  Round(Network& network) : mNetwork(network), mIncoming(network.Size()){};
+
+  /**
+   * @brief Send a vector of trivially copyable things to a party.
+   * @param party the id of the party
+   * @param src the data to send
+   */
+  template <typename T,
+            std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
+  void Send(std::size_t party, const std::vector<T>& src) {
+    mNetwork.Party(party)->Send(src);
+  }
+
+  /**
+   * @brief Receive n bytes from a party.
+   *
+   * Messages from the same party are received in the order they are posted.
+   *
+   * @param party the id of the party
+   * @param dst where to store the data, which must stay valid until Run
+   * returns
+   * @param n the number of bytes
+   * @param handler called once the message is received
+   */
+  void Recv(std::size_t party, unsigned char* dst, std::size_t n,
+            Handler handler = nullptr) {
+    mIncoming[party].push_back({dst, n, 0, handler});
+  }
+
+  /**
+   * @brief Receive a vector of trivially copyable things from a party.
+   *
+   * <code>dst.size()</code> determines how many things to receive.
+   */
+  template <typename T,
+            std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
+  void Recv(std::size_t party, std::vector<T>& dst, Handler handler = nullptr) {
+    Recv(party, reinterpret_cast<unsigned char*>(dst.data()),
+         sizeof(T) * dst.size(), handler);
+  }
+
+  /**
+   * @brief Receive all messages, running their handlers as they complete.
+   *
+   * Handlers run in the calling thread.
+   */
+  void Run();
+
+ private:
+  struct Incoming {
+    unsigned char* dst;
+    std::size_t size;
+    std::size_t received;
+    Handler handler;
+  };
+
+  Network& mNetwork;
+  std::vector<std::deque<Incoming>> mIncoming;
+};
+
+}  // namespace scl
+
+#endif /* _SCL_NET_ROUND_H */
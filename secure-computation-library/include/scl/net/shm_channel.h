@@ -0,0 +1,173 @@
+/**
+ * @file shm_channel.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_SHM_CHANNEL_H
+#define _SCL_NET_SHM_CHANNEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "scl/net/channel.h"
+
+namespace scl {
+
+namespace details {
+
+struct ShmRingHeader;
+
+/**
+ * @brief A single-producer single-consumer byte ring in POSIX shared memory.
+ *
+ * The reader of a ring creates the shared memory object, and the writer opens
+ * it by name once it exists. When the ring is empty (resp. full) the reader
+ * (resp. writer) spins for a short while and then blocks on a futex, so that
+ * an idle party does not burn a core.
+ */
+class ShmRing {
+ public:
+  /**
+   * @brief Create a ring, removing any stale object with the same name.
+   * @param name the name of the shared memory object
+   * @param capacity the number of bytes the ring can hold
+   */
+  static std::shared_ptr<ShmRing> Create(const std::string& name,
+                                         std::size_t capacity);
+
+  /**
+   * @brief Open a ring created by its reader, waiting until it exists.
+   * @param name the name of the shared memory object
+   */
+  static std::shared_ptr<ShmRing> Open(const std::string& name);
+
+  ~ShmRing();
+
+  /**
+   * @brief Wait until the writer has opened the ring.
+   *
+   * Called by the reader. Once both ends have mapped the object its name is no
+   * longer needed, so it is unlinked here.
+   */
+  void WaitConnected();
+
+  /**
+   * @brief Write n bytes, blocking while the ring is full.
+   */
+  void Write(const unsigned char* src, std::size_t n);
+
+  /**
+   * @brief Read n bytes, blocking while the ring is empty.
+   */
+  void Read(unsigned char* dst, std::size_t n);
+
+  /**
+   * @brief Read at most n bytes, without blocking.
+   * @return the number of bytes read
+   */
+  std::size_t TryRead(unsigned char* dst, std::size_t n);
+
+  /**
+   * @brief Mark the ring as closed and wake up the other end.
+   */
+  void Close();
+
+ private:
+  ShmRing(const std::string& name, int fd, std::size_t size, bool owner);
+
+  // Copy n bytes out of the ring, which must hold them
+  void CopyOut(unsigned char* dst, std::uint64_t tail, std::size_t n);
+
+  std::string mName;
+  int mFd;
+  std::size_t mSize;
+  bool mLinked;
+  ShmRingHeader* mHeader;
+  unsigned char* mData;
+};
+
+}  // namespace details
+
+/**
+ * @brief Channel that communicates through rings in shared memory.
+ *
+ * Intended for parties running on the same host, where it avoids the cost of
+ * the kernel's TCP stack. Each direction of the channel is a
+ * details::ShmRing. Messages larger than a ring are streamed through it, so
+ * like TCP a Send blocks once the peer falls a full ring behind.
+ */
+class ShmChannel final : public Channel {
+ public:
+  /**
+   * @brief Default capacity of each ring in bytes.
+   */
+  static constexpr std::size_t kDefaultCapacity = 1 << 22;
+
+  /**
+   * @brief Name of the ring that carries messages from one party to another.
+   * @param session a name shared by all parties of a network
+   * @param from the id of the sender
+   * @param to the id of the receiver
+   */
+  static std::string RingName(const std::string& session, unsigned from,
+                              unsigned to);
+
+  /**
+   * @brief Create a pair of paired channels in the current process.
+   * @param session a name that is not in use by any other network
+   * @param capacity the capacity of each ring
+   */
+  static std::array<std::shared_ptr<ShmChannel>, 2> CreatePaired(
+      const std::string& session, std::size_t capacity = kDefaultCapacity);
+
+  /**
+   * @brief Create a new channel from a ring to read from and one to write to.
+   * @param in the ring created by this party
+   * @param out the ring opened by this party
+   */
+  ShmChannel(std::shared_ptr<details::ShmRing> in,
+             std::shared_ptr<details::ShmRing> out)
+      : mIn(in), mOut(out){};
+
+  using Channel::Recv;
+  using Channel::Send;
+
+  void Close() override;
+
+  void Send(const unsigned char* src, std::size_t n) override {
+    mOut->Write(src, n);
+  };
+
+  void Recv(unsigned char* dst, std::size_t n) override { mIn->Read(dst, n); };
+
+  std::size_t TryRecv(unsigned char* dst, std::size_t n) override {
+    return mIn->TryRead(dst, n);
+  };
+
+ private:
+  std::shared_ptr<details::ShmRing> mIn;
+  std::shared_ptr<details::ShmRing> mOut;
+};
+
+}  // namespace scl
+
+#endif /* _SCL_NET_SHM_CHANNEL_H */
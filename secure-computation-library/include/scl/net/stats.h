@@ -0,0 +1,191 @@
+/**
+ * @file stats.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_STATS_H
+#define _SCL_NET_STATS_H
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "scl/net/channel.h"
+
+namespace scl {
+
+/**
+ * @brief Traffic on the link to one peer during one phase.
+ */
+struct LinkCounters {
+  /**
+   * @brief Bytes sent to the peer.
+   */
+  std::atomic<std::uint64_t> bytes_sent{0};
+
+  /**
+   * @brief Bytes received from the peer.
+   */
+  std::atomic<std::uint64_t> bytes_recv{0};
+
+  /**
+   * @brief Messages sent, one per buffer passed to Send or SendV.
+   *
+   * The peer receives each buffer with a call to Recv, so this matches its
+   * count of messages received.
+   */
+  std::atomic<std::uint64_t> messages_sent{0};
+
+  /**
+   * @brief Messages received, by calls to Recv or by scl::Round.
+   */
+  std::atomic<std::uint64_t> messages_recv{0};
+
+  /**
+   * @brief Round trips, i.e., times the party waited on the peer after sending
+   * to it.
+   */
+  std::atomic<std::uint64_t> rounds{0};
+
+  /**
+   * @brief Nanoseconds spent blocked in Recv, or in scl::Round until data
+   * from the peer ended the wait.
+   *
+   * scl::Round charges each wait to a single peer, so the sum over the peers
+   * is the time the party spent waiting.
+   */
+  std::atomic<std::uint64_t> recv_wait_ns{0};
+};
+
+/**
+ * @brief Communication of one party, broken down by phase and peer.
+ *
+ * The protocol driver labels phases with SetPhase, and traffic is counted
+ * towards the phase that is current when it happens. Traffic before the first
+ * label goes to the phase "default".
+ */
+class NetworkStats {
+ public:
+  /**
+   * @brief Create counters for a network.
+   * @param n the size of the network
+   */
+  NetworkStats(std::size_t n);
+
+  /**
+   * @brief Count the traffic from now on towards a phase.
+   *
+   * A phase that was current before is continued.
+   */
+  void SetPhase(const std::string& name);
+
+  /**
+   * @brief The counters of the current phase for a peer.
+   */
+  LinkCounters& Current(unsigned peer) { return mCurrent.load()[peer]; };
+
+  /**
+   * @brief The counters of a phase for a peer.
+   *
+   * Throws std::invalid_argument if the phase was never current.
+   */
+  const LinkCounters& Get(const std::string& phase, unsigned peer) const;
+
+  /**
+   * @brief Names of the phases, in the order they were first current.
+   */
+  std::vector<std::string> Phases() const;
+
+  /**
+   * @brief The size of the network.
+   */
+  std::size_t Size() const { return mSize; };
+
+  /**
+   * @brief Write all counters as a JSON object.
+   *
+   * The object is <code>{"phases": [{"name": ..., "peers": [{"peer": ...,
+   * "bytes_sent": ..., ...}, ...]}, ...]}</code>, with the fields of
+   * scl::LinkCounters for each peer except the party itself.
+   *
+   * @param os the stream to write to
+   * @param self the id of the party, or -1 to include all peers
+   */
+  void WriteJson(std::ostream& os, int self = -1) const;
+
+ private:
+  struct Phase {
+    std::string name;
+    std::unique_ptr<LinkCounters[]> links;
+  };
+
+  std::size_t mSize;
+  mutable std::mutex mMutex;
+  std::deque<Phase> mPhases;
+  std::atomic<LinkCounters*> mCurrent;
+};
+
+/**
+ * @brief A decorator for channels that counts their traffic.
+ */
+class InstrumentedChannel final : public Channel {
+ public:
+  /**
+   * @brief Decorate a channel.
+   * @param channel the channel to count the traffic of
+   * @param stats the counters of the party
+   * @param peer the id of the party at the other end of the channel
+   */
+  InstrumentedChannel(std::shared_ptr<Channel> channel,
+                      std::shared_ptr<NetworkStats> stats, unsigned peer)
+      : mChannel(channel), mStats(stats), mPeer(peer){};
+
+  using Channel::Recv;
+  using Channel::Send;
+
+  void Close() override { mChannel->Close(); };
+
+  void Send(const unsigned char* src, std::size_t n) override;
+
+  void SendV(const struct iovec* iov, std::size_t count) override;
+
+  void Recv(unsigned char* dst, std::size_t n) override;
+
+  std::size_t TryRecv(unsigned char* dst, std::size_t n) override;
+
+  int PollDescriptor() const override { return mChannel->PollDescriptor(); };
+
+ private:
+  std::shared_ptr<Channel> mChannel;
+  std::shared_ptr<NetworkStats> mStats;
+  unsigned mPeer;
+  std::atomic<bool> mSentLast{false};
+};
+
+}  // namespace scl
+
+#endif /* _SCL_NET_STATS_H */
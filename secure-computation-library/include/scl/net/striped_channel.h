@@ -0,0 +1,115 @@
+/**
+ * @file striped_channel.h
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+#ifndef _SCL_NET_STRIPED_CHANNEL_H
+#define _SCL_NET_STRIPED_CHANNEL_H
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "scl/net/channel.h"
+
+namespace scl {
+
+/**
+ * @brief A channel that stripes large messages across several streams.
+ *
+ * The first stream carries small messages and the header of every message,
+ * so that latency critical traffic never waits behind bulk data. A message of
+ * at least the threshold is split into one contiguous part per remaining
+ * stream, and the parts are sent and received concurrently. On a link with a
+ * large bandwidth-delay product this lets several TCP windows fill the pipe
+ * where one could not.
+ *
+ * Messages are framed, so data may be received in other pieces than it was
+ * sent in, just like on a single stream. Both ends must use the same number of
+ * streams and the same threshold.
+ */
+class StripedChannel final : public Channel {
+ public:
+  /**
+   * @brief Create a channel from its streams.
+   * @param streams a stream for small messages followed by at least one for
+   * large messages
+   * @param threshold the size in bytes from which a message is striped
+   */
+  StripedChannel(std::vector<std::shared_ptr<Channel>> streams,
+                 std::size_t threshold);
+
+  using Channel::Recv;
+  using Channel::Send;
+
+  /**
+   * @brief Close all streams.
+   */
+  void Close() override;
+
+  void Send(const unsigned char* src, std::size_t n) override;
+
+  /**
+   * @brief Send several buffers, with small ones going out in a single write.
+   */
+  void SendV(const struct iovec* iov, std::size_t count) override;
+
+  void Recv(unsigned char* dst, std::size_t n) override;
+
+  /**
+   * @brief Receive without waiting for a small message.
+   *
+   * A striped message is received in full as soon as its header is there.
+   */
+  std::size_t TryRecv(unsigned char* dst, std::size_t n) override;
+
+  int PollDescriptor() const override {
+    return mStreams[0]->PollDescriptor();
+  };
+
+ private:
+  // Split a message across the bulk streams and move the parts concurrently
+  void SendStriped(const unsigned char* src, std::size_t n);
+  void RecvStriped(unsigned char* dst, std::size_t n);
+
+  // Start the next message once its header is complete. Returns false if
+  // block is false and the header is not all there yet
+  bool NextMessage(bool block);
+
+  // Take up to n bytes of the current message. Returns how many were taken
+  std::size_t Take(unsigned char* dst, std::size_t n, bool block);
+
+  std::vector<std::shared_ptr<Channel>> mStreams;
+  std::size_t mThreshold;
+
+  std::uint64_t mHeader = 0;
+  std::size_t mHeaderRead = 0;
+  // Bytes of the current message that have not been received
+  std::size_t mLeft = 0;
+  // A striped message that was received in full but only partly taken
+  std::vector<unsigned char> mBuffer;
+  std::size_t mBufferPos = 0;
+};
+
+}  // namespace scl
+
+#endif /* _SCL_NET_STRIPED_CHANNEL_H */
@@ -52,8 +52,16 @@ class TcpChannel final : public Channel {
    */
   bool Alive() const { return mAlive; };
 
+  /**
+   * @brief The underlying socket.
+   */
+  int Socket() const { return mSocket; };
+
   void Send(const unsigned char* src, std::size_t n) override;
   void Recv(unsigned char* dst, std::size_t n) override;
+  void SendV(const struct iovec* iov, std::size_t count) override;
+  std::size_t TryRecv(unsigned char* dst, std::size_t n) override;
+  int PollDescriptor() const override { return mSocket; };
   void Close() override;
 
  private:
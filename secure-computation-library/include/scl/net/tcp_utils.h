@@ -23,10 +23,15 @@
 #define _SCL_NET_TCP_UTILS_H
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <system_error>
 
+#include "scl/net/config.h"
+
 namespace scl {
 namespace details {
 
@@ -66,6 +71,14 @@ struct AcceptedConnection {
  */
 AcceptedConnection AcceptConnection(int server_socket);
 
+/**
+ * @brief Accept a connection, waiting at most until a deadline.
+ *
+ * Throws std::system_error with ETIMEDOUT if no peer connects in time.
+ */
+AcceptedConnection AcceptConnection(
+    int server_socket, std::chrono::steady_clock::time_point deadline);
+
 /**
  * @brief Extra the hostname of an accepted connection.
  */
@@ -79,6 +92,25 @@ std::string GetAddress(AcceptedConnection connection);
  */
 int ConnectAsClient(std::string hostname, int port);
 
+/**
+ * @brief Connect to a server, retrying with exponential backoff.
+ *
+ * Every attempt uses a fresh socket, configured with ConfigureSocket before
+ * connecting. Throws std::system_error with ETIMEDOUT if the server does not
+ * accept the connection within <code>options.timeout</code>.
+ *
+ * @param hostname the IPv4 address of the server
+ * @param port the port of the server
+ * @param options the options of the socket
+ */
+int ConnectAsClient(const std::string& hostname, int port,
+                    const TcpOptions& options);
+
+/**
+ * @brief Apply the socket options of \p options to a socket.
+ */
+void ConfigureSocket(int socket, const TcpOptions& options);
+
 /**
  * @brief Close a socket.
  */
@@ -89,11 +121,23 @@ int CloseSocket(int socket);
  */
 int ReadFromSocket(int socket, unsigned char* dst, std::size_t n);
 
+/**
+ * @brief Read from a socket without blocking.
+ * @return the number of bytes read, or 0 if no data is available.
+ * @throws std::runtime_error if the connection was closed
+ */
+std::size_t TryReadFromSocket(int socket, unsigned char* dst, std::size_t n);
+
 /**
  * @brief Write to a socket.
  */
 int WriteToSocket(int socket, const unsigned char* src, std::size_t n);
 
+/**
+ * @brief Write a list of buffers to a socket.
+ */
+ssize_t WriteVToSocket(int socket, const struct iovec* iov, int iovcnt);
+
 }  // namespace details
 }  // namespace scl
 
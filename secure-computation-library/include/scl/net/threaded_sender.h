@@ -25,8 +25,8 @@
 #include <cstddef>
 #include <future>
 
+#include "scl/net/byte_ring.h"
 #include "scl/net/channel.h"
-#include "scl/net/shared_deque.h"
 #include "scl/net/tcp_channel.h"
 
 namespace scl {
@@ -37,29 +37,53 @@ namespace scl {
  *
  * The purpose of this class is to avoid situations where calls to Send may
  * block, for example if we're trying to send more that what can fit in the TCP
- * window.
+ * window. Send copies the data into a bounded ring, and only blocks once the
+ * ring is full. The sender thread writes everything in the ring to the socket
+ * with a single writev(2), so many small messages cost one system call.
  */
 class ThreadedSenderChannel final : public Channel {
  public:
+  /**
+   * @brief Default capacity of the send buffer in bytes.
+   */
+  static constexpr std::size_t kDefaultCapacity = 1 << 22;
+
   /**
    * @brief Create a new threaded sender channel.
    * @param socket an open socket used to construct scl::TcpChannel
+   * @param capacity the capacity of the send buffer
+   */
+  ThreadedSenderChannel(int socket, std::size_t capacity = kDefaultCapacity);
+
+  /**
+   * @brief Sends what is buffered and closes the connection.
    */
-  ThreadedSenderChannel(int socket);
+  ~ThreadedSenderChannel();
 
+  /**
+   * @brief Sends what is buffered and closes the connection.
+   *
+   * Rethrows the error of the sender thread, if writing to the socket failed.
+   */
   void Close() override;
 
   void Send(const unsigned char* src, std::size_t n) override {
-    mSendBuffer.PushBack({src, src + n});
+    mSendBuffer.Write(src, n);
   };
 
   void Recv(unsigned char* dst, std::size_t n) override {
     mChannel.Recv(dst, n);
   };
 
+  std::size_t TryRecv(unsigned char* dst, std::size_t n) override {
+    return mChannel.TryRecv(dst, n);
+  };
+
+  int PollDescriptor() const override { return mChannel.PollDescriptor(); };
+
  private:
   TcpChannel mChannel;
-  details::SharedDeque<std::vector<unsigned char>> mSendBuffer;
+  details::ByteRing mSendBuffer;
   std::future<void> mSender;
 };
 
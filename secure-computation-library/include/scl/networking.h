@@ -27,6 +27,8 @@
 #include "scl/net/discovery/server.h"
 #include "scl/net/mem_channel.h"
 #include "scl/net/network.h"
+#include "scl/net/round.h"
+#include "scl/net/shm_channel.h"
 #include "scl/net/tcp_channel.h"
 
 #endif /* _SCL_NETWORKING_H */
@@ -100,14 +100,18 @@ namespace scl {
       T Evaluate(const T& x) const {
 	T z;
 	for (std::size_t j = 0; j < Degree()+1; ++j) {
-	  T ell(1);
+	  // Accumulate numerator and denominator separately so that there
+	  // is one inversion per basis polynomial
+	  T num(1);
+	  T den(1);
 	  auto xj = mX[j];
 	  for (std::size_t m = 0; m < Degree()+1; ++m) {
 	    if (m == j) continue;
 	    auto xm = mX[m];
-	    ell *= (x - xm) / (xj - xm);
+	    num *= x - xm;
+	    den *= xj - xm;
 	  }
-	  z += mY[j] * ell;
+	  z += mY[j] * num / den;
 	}
 	return z;
       };
@@ -24,6 +24,8 @@
 
 #include <array>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <stdexcept>
 
 #include "scl/math/la.h"
@@ -187,6 +189,232 @@ namespace scl {
     }
 
 
+    /**
+     * @brief Precomputed linear maps for packed sharing and reconstruction.
+     *
+     * @details Sharing k secrets with degree d puts the secrets at
+     * [0,-1,...,-(k-1)] and random values at [1,...,d+1-k], so the
+     * shares f(1)...f(n) are a fixed linear function of these d+1
+     * values. Similarly, reconstructing the secrets from f(1)...f(d+1)
+     * is a fixed linear function of the shares. A plan holds both
+     * matrices, so sharing and reconstruction become a matrix-vector
+     * product with no field inversions.
+     */
+    template <typename T>
+    class PackedSharingPlan {
+    public:
+      /**
+       * @brief Returns the plan for (n_parties, n_secrets, degree),
+       * creating it on first use. Plans are shared and never freed.
+       */
+      static const PackedSharingPlan& Get(std::size_t n_parties, std::size_t n_secrets, std::size_t degree);
+
+      /**
+       * @brief Computes the sharing and reconstruction matrices.
+       * @param n_parties number of shares f(1)...f(n)
+       * @param n_secrets number of secrets k
+       * @param degree degree d of the sharings
+       */
+      PackedSharingPlan(std::size_t n_parties, std::size_t n_secrets, std::size_t degree);
+
+      /**
+       * @brief Shares a vector of secrets. Samples the same randomness
+       * from \p prg as EvPolyFromSecretsAndDegree
+       * @param secrets the secrets, of size n_secrets
+       * @param prg pseudorandom function for randomness
+       * @return The shares f(1)...f(n)
+       */
+      Vec<T> Share(const Vec<T>& secrets, PRG& prg) const;
+
+      /**
+       * @brief Shares many vectors of secrets at once
+       * @param secrets a n_secrets x m matrix, one vector of secrets
+       * per column
+       * @param prg pseudorandom function for randomness. Columns draw
+       * their randomness in order, as m calls to Share would
+       * @return A n_parties x m matrix. Row i holds the shares of party i
+       */
+      Mat<T> ShareMany(const Mat<T>& secrets, PRG& prg) const;
+
+      /**
+       * @brief Reconstructs many vectors of secrets at once
+       * @param shares a n_parties x m matrix, one sharing per column
+       * @return A n_secrets x m matrix, one vector of secrets per column
+       */
+      Mat<T> ReconstructMany(const Mat<T>& shares) const;
+
+      /**
+       * @brief Reconstructs the secrets from the shares. Only the first
+       * degree+1 shares are used
+       * @param shares the shares f(1)...f(n)
+       * @return The secrets f(0)...f(-(k-1))
+       */
+      Vec<T> Reconstruct(const Vec<T>& shares) const;
+
+      /**
+       * @brief Reconstructs the secret at position -idx
+       */
+      T ReconstructAt(std::size_t idx, const Vec<T>& shares) const;
+
+      /**
+       * @brief n x (d+1) matrix mapping (secrets, randomness) to shares
+       */
+      const Mat<T>& ShareMatrix() const { return mShareMatrix; };
+
+      /**
+       * @brief k x (d+1) matrix mapping shares to secrets
+       */
+      const Mat<T>& ReconstructionMatrix() const { return mReconstructionMatrix; };
+
+      std::size_t Parties() const { return mShareMatrix.Rows(); };
+      std::size_t Secrets() const { return mReconstructionMatrix.Rows(); };
+      std::size_t Degree() const { return mShareMatrix.Cols() - 1; };
+
+    private:
+      // Row i holds the Lagrange coefficients of x_points evaluated at
+      // targets[i]
+      static Mat<T> LagrangeMatrix(const Vec<T>& x_points, const Vec<T>& targets);
+
+      Mat<T> mShareMatrix;
+      Mat<T> mReconstructionMatrix;
+    };
+
+    template <typename T>
+    const PackedSharingPlan<T>& PackedSharingPlan<T>::Get(std::size_t n_parties,
+							   std::size_t n_secrets,
+							   std::size_t degree) {
+      static std::mutex mutex;
+      static std::map<std::array<std::size_t, 3>, PackedSharingPlan<T>> plans;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::array<std::size_t, 3> key{n_parties, n_secrets, degree};
+      auto it = plans.find(key);
+      if (it == plans.end()) {
+	it = plans.try_emplace(key, n_parties, n_secrets, degree).first;
+      }
+      return it->second;
+    }
+
+    template <typename T>
+    PackedSharingPlan<T>::PackedSharingPlan(std::size_t n_parties, std::size_t n_secrets, std::size_t degree) {
+      if (n_secrets == 0)
+	throw std::invalid_argument("number of secrets must be positive");
+      if (n_secrets > degree + 1)
+	throw std::invalid_argument("number of secrets is larger than number of x points");
+      if (degree + 1 > n_parties)
+	throw std::invalid_argument("not enough shares to reconstruct");
+
+      Vec<T> x_points;
+      x_points.Reserve(degree+1);
+      for (std::size_t i = 0; i < n_secrets; i++) { x_points.Emplace(T(-i)); }
+      for (std::size_t i = 0; i < (degree + 1) - n_secrets; i++) { x_points.Emplace(T(i+1)); }
+
+      Vec<T> x_shares;
+      x_shares.Reserve(n_parties);
+      for (std::size_t i = 0; i < n_parties; i++) { x_shares.Emplace(T(i+1)); }
+      mShareMatrix = LagrangeMatrix(x_points, x_shares);
+
+      Vec<T> x_recon;
+      x_recon.Reserve(degree+1);
+      for (std::size_t i = 0; i < degree+1; i++) { x_recon.Emplace(T(i+1)); }
+      Vec<T> x_secrets;
+      x_secrets.Reserve(n_secrets);
+      for (std::size_t i = 0; i < n_secrets; i++) { x_secrets.Emplace(T(-i)); }
+      mReconstructionMatrix = LagrangeMatrix(x_recon, x_secrets);
+    }
+
+    template <typename T>
+    Mat<T> PackedSharingPlan<T>::LagrangeMatrix(const Vec<T>& x_points, const Vec<T>& targets) {
+      std::size_t n_points = x_points.Size();
+
+      // Barycentric weights w_j = 1/prod_{m != j} (x_j - x_m), so that
+      // ell_j(x) = w_j * prod_{m != j} (x - x_m)
+      Vec<T> weights;
+      weights.Reserve(n_points);
+      for (std::size_t j = 0; j < n_points; j++) {
+	T den(1);
+	for (std::size_t m = 0; m < n_points; m++) {
+	  if (m != j) den *= x_points[j] - x_points[m];
+	}
+	weights.Emplace(den.Inverse());
+      }
+
+      Mat<T> coefficients(targets.Size(), n_points);
+      for (std::size_t i = 0; i < targets.Size(); i++) {
+	for (std::size_t j = 0; j < n_points; j++) {
+	  T ell = weights[j];
+	  for (std::size_t m = 0; m < n_points; m++) {
+	    if (m != j) ell *= targets[i] - x_points[m];
+	  }
+	  coefficients(i, j) = ell;
+	}
+      }
+      return coefficients;
+    }
+
+    template <typename T>
+    Vec<T> PackedSharingPlan<T>::Share(const Vec<T>& secrets, PRG& prg) const {
+      std::size_t n_secrets = Secrets();
+      if (secrets.Size() != n_secrets)
+	throw std::invalid_argument("number of secrets does not match the plan");
+
+      Vec<T> y_points = Vec<T>::PartialRandom(
+					      Degree()+1, [n_secrets](std::size_t i) { return i >= n_secrets; }, prg);
+      for (std::size_t i = 0; i < n_secrets; i++) {
+	y_points[i] = secrets[i];
+      }
+
+      return mShareMatrix.Multiply(y_points);
+    }
+
+    template <typename T>
+    Mat<T> PackedSharingPlan<T>::ShareMany(const Mat<T>& secrets, PRG& prg) const {
+      std::size_t n_secrets = Secrets();
+      if (secrets.Rows() != n_secrets)
+	throw std::invalid_argument("number of secrets does not match the plan");
+      if (Degree()+1 == n_secrets) return mShareMatrix.Multiply(secrets);
+
+      Mat<T> y_points(Degree()+1, secrets.Cols());
+      for (std::size_t i = 0; i < n_secrets; i++) {
+	for (std::size_t j = 0; j < secrets.Cols(); j++) y_points(i, j) = secrets(i, j);
+      }
+      for (std::size_t j = 0; j < secrets.Cols(); j++) {
+	for (std::size_t i = n_secrets; i < Degree()+1; i++) y_points(i, j) = T::Random(prg);
+      }
+      return mShareMatrix.Multiply(y_points);
+    }
+
+    template <typename T>
+    Mat<T> PackedSharingPlan<T>::ReconstructMany(const Mat<T>& shares) const {
+      if (shares.Rows() < Degree()+1)
+	throw std::invalid_argument("not enough shares to reconstruct");
+      if (shares.Rows() == Degree()+1) return mReconstructionMatrix.Multiply(shares);
+
+      Mat<T> used_shares(Degree()+1, shares.Cols());
+      for (std::size_t i = 0; i < Degree()+1; i++) {
+	for (std::size_t j = 0; j < shares.Cols(); j++) used_shares(i, j) = shares(i, j);
+      }
+      return mReconstructionMatrix.Multiply(used_shares);
+    }
+
+    template <typename T>
+    T PackedSharingPlan<T>::ReconstructAt(std::size_t idx, const Vec<T>& shares) const {
+      if (shares.Size() < Degree()+1)
+	throw std::invalid_argument("not enough shares to reconstruct");
+      T secret;
+      for (std::size_t j = 0; j < Degree()+1; j++) {
+	secret += mReconstructionMatrix(idx, j) * shares[j];
+      }
+      return secret;
+    }
+
+    template <typename T>
+    Vec<T> PackedSharingPlan<T>::Reconstruct(const Vec<T>& shares) const {
+      if (shares.Size() < Degree()+1)
+	throw std::invalid_argument("not enough shares to reconstruct");
+      if (shares.Size() == Degree()+1) return mReconstructionMatrix.Multiply(shares);
+      return mReconstructionMatrix.Multiply(Vec<T>(shares.begin(), shares.begin() + Degree() + 1));
+    }
 
   }  // namespace details
 }  // namespace scl
@@ -0,0 +1,92 @@
+/**
+ * @file byte_ring.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/byte_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+scl::details::ByteRing::ByteRing(std::size_t capacity)
+    : mCapacity(capacity),
+      mData(new unsigned char[capacity]),
+      mClosed(false),
+      mHead(0),
+      mTail(0) {
+  if (capacity == 0)
+    throw std::invalid_argument("ring capacity must be positive");
+}
+
+void scl::details::ByteRing::Write(const unsigned char* src, std::size_t n) {
+  while (n > 0) {
+    const auto head = mHead.load(std::memory_order_relaxed);
+    const auto tail = mTail.load(std::memory_order_acquire);
+    if (head - tail == mCapacity) {
+      mSpaceSignal.WaitUntil(
+          [this, tail]() { return mTail.load() != tail || mClosed.load(); });
+      if (mTail.load() == tail) throw std::runtime_error("ring closed");
+      continue;
+    }
+
+    const auto chunk = std::min<std::uint64_t>(n, mCapacity - (head - tail));
+    const auto pos = head % mCapacity;
+    const auto first = std::min<std::uint64_t>(chunk, mCapacity - pos);
+    std::memcpy(mData.get() + pos, src, first);
+    std::memcpy(mData.get(), src + first, chunk - first);
+
+    mHead.store(head + chunk);
+    mDataSignal.Notify();
+
+    src += chunk;
+    n -= chunk;
+  }
+}
+
+int scl::details::ByteRing::Readable(struct iovec (&iov)[2]) {
+  const auto tail = mTail.load(std::memory_order_relaxed);
+  mDataSignal.WaitUntil(
+      [this, tail]() { return mHead.load() != tail || mClosed.load(); });
+
+  const auto head = mHead.load(std::memory_order_acquire);
+  const auto size = head - tail;
+  if (size == 0) return 0;
+
+  const auto pos = tail % mCapacity;
+  const auto first = std::min<std::uint64_t>(size, mCapacity - pos);
+  iov[0].iov_base = mData.get() + pos;
+  iov[0].iov_len = first;
+  if (first == size) return 1;
+  iov[1].iov_base = mData.get();
+  iov[1].iov_len = size - first;
+  return 2;
+}
+
+void scl::details::ByteRing::Consume(std::size_t n) {
+  mTail.store(mTail.load(std::memory_order_relaxed) + n);
+  mSpaceSignal.Notify();
+}
+
+void scl::details::ByteRing::Close() {
+  mClosed.store(true);
+  mDataSignal.NotifyAlways();
+  mSpaceSignal.NotifyAlways();
+}
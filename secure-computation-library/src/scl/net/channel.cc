@@ -0,0 +1,78 @@
+/**
+ * @file channel.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/channel.h"
+
+#include "scl/net/recv_queue.h"
+
+scl::Channel::~Channel() {}
+
+std::future<void> scl::Channel::Enqueue(std::function<void()> recv) {
+  std::call_once(mRecvQueueStarted, [this]() {
+    mRecvQueue = std::make_shared<details::RecvQueue>();
+  });
+  return mRecvQueue->Push(std::move(recv));
+}
+
+scl::details::RecvQueue::RecvQueue() : mWorker(&RecvQueue::Run, this) {}
+
+scl::details::RecvQueue::~RecvQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mCond.notify_one();
+  mWorker.join();
+}
+
+std::future<void> scl::details::RecvQueue::Push(std::function<void()> recv) {
+  std::promise<void> done;
+  auto future = done.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue.emplace_back(std::move(recv), std::move(done));
+  }
+  mCond.notify_one();
+  return future;
+}
+
+void scl::details::RecvQueue::Run() {
+  while (true) {
+    std::function<void()> recv;
+    std::promise<void> done;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCond.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+      if (mQueue.empty()) return;
+      recv = std::move(mQueue.front().first);
+      done = std::move(mQueue.front().second);
+      mQueue.pop_front();
+    }
+
+    try {
+      recv();
+      done.set_value();
+    } catch (...) {
+      done.set_exception(std::current_exception());
+    }
+  }
+}
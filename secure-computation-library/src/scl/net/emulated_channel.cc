@@ -0,0 +1,260 @@
+/**
+ * @file emulated_channel.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/emulated_channel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+using Clock = scl::VirtualClock::Clock;
+
+// A frame header holds the arrival time and length of a message
+constexpr std::size_t kFrameHeaderSize = 2 * sizeof(std::uint64_t);
+
+}  // namespace
+
+scl::LinkConditions scl::LinkConditions::FromProfile(
+    const std::string& profile) {
+  // Same presets as network.sh. Note that tc reads "Mbps" as megabytes per
+  // second and "Mbit" as megabits per second.
+  LinkConditions link;
+  if (profile == "lan") {
+    link.latency = std::chrono::milliseconds(1);
+    link.bandwidth = 8e9;
+  } else if (profile == "wan") {
+    link.latency = std::chrono::milliseconds(100);
+    link.bandwidth = 8e8;
+  } else {
+    const auto comma = profile.find(',');
+    try {
+      if (comma == std::string::npos) throw std::invalid_argument(profile);
+      std::size_t end;
+      const auto delay = std::stod(profile.substr(0, comma), &end);
+      if (end != comma || delay < 0) throw std::invalid_argument(profile);
+      const auto rate = std::stod(profile.substr(comma + 1), &end);
+      if (end != profile.size() - comma - 1 || rate < 0)
+        throw std::invalid_argument(profile);
+      link.latency = std::chrono::microseconds(
+          static_cast<std::chrono::microseconds::rep>(delay * 1000));
+      link.bandwidth = rate * 1e6;
+    } catch (const std::logic_error&) {
+      throw std::invalid_argument("invalid network profile: " + profile);
+    }
+  }
+  return link;
+}
+
+void scl::VirtualClock::AdvanceTo(Clock::time_point t) {
+  const auto ahead = (t - Clock::now()).count();
+  auto offset = mOffset.load();
+  while (offset < ahead && !mOffset.compare_exchange_weak(offset, ahead)) {
+  }
+}
+
+scl::EmulatedChannel::EmulatedChannel(std::shared_ptr<Channel> channel,
+                                      LinkConditions conditions,
+                                      std::shared_ptr<VirtualClock> clock)
+    : mChannel(channel),
+      mConditions(conditions),
+      mClock(clock),
+      mTokens(conditions.burst),
+      mRefilled(clock ? clock->Now() : Clock::now()),
+      mRng(conditions.seed) {
+  if (conditions.bandwidth < 0)
+    throw std::invalid_argument("bandwidth cannot be negative");
+  if (!mClock) mDeliverer = std::thread(&EmulatedChannel::Deliver, this);
+}
+
+scl::EmulatedChannel::~EmulatedChannel() {
+  if (mDeliverer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mClosing = true;
+    }
+    mCond.notify_one();
+    mDeliverer.join();
+  }
+}
+
+void scl::EmulatedChannel::Close() {
+  if (mDeliverer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mClosing = true;
+    }
+    mCond.notify_one();
+    mDeliverer.join();
+  }
+  mChannel->Close();
+  if (mError) std::rethrow_exception(std::exchange(mError, nullptr));
+}
+
+Clock::time_point scl::EmulatedChannel::Schedule(std::size_t n) {
+  const auto now = mClock ? mClock->Now() : Clock::now();
+
+  // The message goes on the link once the previous one is off it, and once
+  // the bucket holds a token for each byte
+  auto t = std::max(now, mRefilled);
+  const auto rate = mConditions.bandwidth / 8;
+  if (rate > 0) {
+    const std::chrono::duration<double> idle = t - mRefilled;
+    mTokens = std::min<double>(mConditions.burst, mTokens + idle.count() * rate);
+    mRefilled = t;
+    if (mTokens >= n) {
+      mTokens -= n;
+    } else {
+      t += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>((n - mTokens) / rate));
+      mTokens = 0;
+      mRefilled = t;
+    }
+  }
+
+  auto arrival = t + mConditions.latency;
+  if (mConditions.jitter.count() > 0) {
+    std::uniform_int_distribution<std::chrono::microseconds::rep> jitter(
+        0, mConditions.jitter.count());
+    arrival += std::chrono::microseconds(jitter(mRng));
+  }
+  mLastArrival = std::max(arrival, mLastArrival);
+  return mLastArrival;
+}
+
+void scl::EmulatedChannel::Send(const unsigned char* src, std::size_t n) {
+  struct iovec iov = {const_cast<unsigned char*>(src), n};
+  SendV(&iov, 1);
+}
+
+void scl::EmulatedChannel::SendV(const struct iovec* iov, std::size_t count) {
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < count; ++i) n += iov[i].iov_len;
+  if (n == 0) return;
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  const auto arrival = Schedule(n);
+
+  if (mClock) {
+    lock.unlock();
+    const std::uint64_t header[] = {
+        static_cast<std::uint64_t>(arrival.time_since_epoch().count()), n};
+    std::vector<struct iovec> frame;
+    frame.reserve(count + 1);
+    frame.push_back({const_cast<std::uint64_t*>(header), kFrameHeaderSize});
+    frame.insert(frame.end(), iov, iov + count);
+    mChannel->SendV(frame.data(), frame.size());
+    return;
+  }
+
+  if (mError) std::rethrow_exception(mError);
+  Message msg{arrival, std::vector<unsigned char>(n)};
+  auto* p = msg.data.data();
+  for (std::size_t i = 0; i < count; ++i) {
+    std::memcpy(p, iov[i].iov_base, iov[i].iov_len);
+    p += iov[i].iov_len;
+  }
+  mQueue.emplace_back(std::move(msg));
+  lock.unlock();
+  mCond.notify_one();
+}
+
+void scl::EmulatedChannel::Deliver() {
+  while (true) {
+    Message msg;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCond.wait(lock, [this]() { return mClosing || !mQueue.empty(); });
+      if (mQueue.empty()) return;
+      msg = std::move(mQueue.front());
+      mQueue.pop_front();
+    }
+
+    std::this_thread::sleep_until(msg.arrival);
+    try {
+      mChannel->Send(msg.data.data(), msg.data.size());
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mError = std::current_exception();
+      mQueue.clear();
+      return;
+    }
+  }
+}
+
+bool scl::EmulatedChannel::ReadFrameHeader(bool block) {
+  auto* dst = mFrameHeader + mFrameHeaderRead;
+  const auto left = kFrameHeaderSize - mFrameHeaderRead;
+  if (block) {
+    mChannel->Recv(dst, left);
+    mFrameHeaderRead = kFrameHeaderSize;
+  } else {
+    mFrameHeaderRead += mChannel->TryRecv(dst, left);
+    if (mFrameHeaderRead < kFrameHeaderSize) return false;
+  }
+
+  std::uint64_t header[2];
+  std::memcpy(header, mFrameHeader, kFrameHeaderSize);
+  mClock->AdvanceTo(Clock::time_point(Clock::duration(header[0])));
+  mFrameLeft = header[1];
+  mFrameHeaderRead = 0;
+  return true;
+}
+
+void scl::EmulatedChannel::Recv(unsigned char* dst, std::size_t n) {
+  if (!mClock) {
+    mChannel->Recv(dst, n);
+    return;
+  }
+
+  while (n > 0) {
+    if (mFrameLeft == 0) {
+      ReadFrameHeader(true);
+      continue;
+    }
+    const auto chunk = std::min<std::uint64_t>(n, mFrameLeft);
+    mChannel->Recv(dst, chunk);
+    mFrameLeft -= chunk;
+    dst += chunk;
+    n -= chunk;
+  }
+}
+
+std::size_t scl::EmulatedChannel::TryRecv(unsigned char* dst, std::size_t n) {
+  if (!mClock) return mChannel->TryRecv(dst, n);
+
+  std::size_t got = 0;
+  while (got < n) {
+    if (mFrameLeft == 0) {
+      if (!ReadFrameHeader(false)) break;
+      continue;
+    }
+    const auto chunk = std::min<std::uint64_t>(n - got, mFrameLeft);
+    const auto k = mChannel->TryRecv(dst + got, chunk);
+    mFrameLeft -= k;
+    got += k;
+    if (k < chunk) break;
+  }
+  return got;
+}
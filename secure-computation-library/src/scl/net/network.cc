@@ -1,5 +1,9 @@
 #include "scl/net/network.h"
 
+#include <chrono>
+#include <functional>
+#include <future>
+#include <stdexcept>
 #include <thread>
 
 #include "scl/net/tcp_utils.h"
@@ -9,72 +13,193 @@ static inline std::shared_ptr<scl::Channel> Self() {
   return scl::InMemoryChannel::CreateSelfConnecting();
 }
 
+using MakeChannel = std::function<std::shared_ptr<scl::Channel>(int)>;
+
+// Sockets per peer. With striping, one carries small messages and the others
+// share large ones
+static inline std::size_t StreamsPerPeer(const scl::TcpOptions& options) {
+  return options.streams > 1 ? options.streams + 1 : 1;
+}
+
+// Turn the streams to a peer into a single channel
+static inline std::shared_ptr<scl::Channel> Join(
+    std::vector<std::shared_ptr<scl::Channel>> streams,
+    const scl::TcpOptions& options) {
+  if (streams.size() == 1) return streams[0];
+  return std::make_shared<scl::StripedChannel>(streams,
+                                               options.stripe_threshold);
+}
+
 static inline void AcceptConnections(
     std::vector<std::shared_ptr<scl::Channel>>& channels,
-    const scl::NetworkConfig config) {
+    const scl::NetworkConfig& config, const scl::TcpOptions& options,
+    std::chrono::steady_clock::time_point deadline, MakeChannel make) {
   // Act as server for all clients with an ID strictly greater than ours.
   auto my_id = config.Id();
   auto n = config.NetworkSize() - my_id - 1;
   if (n) {
+    const auto m = StreamsPerPeer(options);
     auto port = config.GetParty(my_id).port;
-    int ssock = scl::details::CreateServerSocket(port, n);
-    for (std::size_t i = config.Id() + 1; i < config.NetworkSize(); ++i) {
-      auto ac = scl::details::AcceptConnection(ssock);
-      std::shared_ptr<scl::Channel> channel =
-          std::make_shared<scl::TcpChannel>(ac.socket);
-      unsigned id;
-      channel->Recv(id);
-      channels[id] = channel;
+    int ssock = scl::details::CreateServerSocket(port, n * m);
+    std::vector<std::vector<std::shared_ptr<scl::Channel>>> streams(
+        config.NetworkSize(), std::vector<std::shared_ptr<scl::Channel>>(m));
+    try {
+      // Accepted sockets inherit the buffer sizes of the server socket
+      scl::details::ConfigureSocket(ssock, options);
+      for (std::size_t i = 0; i < n * m; ++i) {
+        auto ac = scl::details::AcceptConnection(ssock, deadline);
+        scl::details::ConfigureSocket(ac.socket, options);
+        auto channel = make(ac.socket);
+        unsigned id;
+        unsigned stream = 0;
+        channel->Recv(id);
+        if (m > 1) channel->Recv(stream);
+        if (id <= my_id || id >= config.NetworkSize() || stream >= m ||
+            streams[id][stream])
+          throw std::runtime_error("unexpected id from connecting peer");
+        streams[id][stream] = channel;
+      }
+    } catch (...) {
+      scl::details::CloseSocket(ssock);
+      throw;
     }
     scl::details::CloseSocket(ssock);
+
+    for (std::size_t id = my_id + 1; id < config.NetworkSize(); ++id)
+      channels[id] = Join(streams[id], options);
   }
 }
 
-scl::Network scl::Network::Create(const scl::NetworkConfig& config) {
-  std::vector<std::shared_ptr<scl::Channel>> channels(config.NetworkSize());
+// Connect to all parties over TCP. Peers with a smaller id are connected to
+// concurrently, while those with a larger id are accepted
+static scl::Network CreateTcp(const scl::NetworkConfig& config,
+                              const scl::TcpOptions& options,
+                              MakeChannel make) {
+  const auto deadline =
+      options.timeout.count() > 0
+          ? std::chrono::steady_clock::now() + options.timeout
+          : std::chrono::steady_clock::time_point::max();
 
+  std::vector<std::shared_ptr<scl::Channel>> channels(config.NetworkSize());
   channels[config.Id()] = Self();
 
-  std::thread server(AcceptConnections, std::ref(channels), config);
+  auto server = std::async(std::launch::async, AcceptConnections,
+                           std::ref(channels), std::cref(config),
+                           std::cref(options), deadline, make);
 
+  std::vector<std::future<void>> clients;
   for (std::size_t i = 0; i < config.Id(); ++i) {
-    const auto party = config.GetParty(i);
-    auto socket = scl::details::ConnectAsClient(party.hostname, party.port);
-    std::shared_ptr<scl::Channel> channel =
-        std::make_shared<scl::TcpChannel>(socket);
-    channel->Send((unsigned)config.Id());
-    channels[i] = channel;
+    clients.emplace_back(std::async(std::launch::async, [&, i]() {
+      const auto party = config.GetParty(i);
+      const auto m = StreamsPerPeer(options);
+      std::vector<std::shared_ptr<scl::Channel>> streams;
+      for (unsigned stream = 0; stream < m; ++stream) {
+        auto socket =
+            scl::details::ConnectAsClient(party.hostname, party.port, options);
+        auto channel = make(socket);
+        channel->Send((unsigned)config.Id());
+        if (m > 1) channel->Send(stream);
+        streams.push_back(channel);
+      }
+      channels[i] = Join(streams, options);
+    }));
   }
 
-  server.join();
+  for (auto& client : clients) client.get();
+  server.get();
 
-  return Network{channels};
+  return scl::Network{channels};
 }
 
-scl::Network scl::Network::CreateThreadedSenders(const NetworkConfig& config) {
-  // TODO: The code here is identical to the above method with the exception of
-  // which instantiation is used. This will be refactored at some point.
-
-  std::vector<std::shared_ptr<scl::Channel>> channels(config.NetworkSize());
+scl::Network scl::Network::Create(const scl::NetworkConfig& config,
+                                  const TcpOptions& options) {
+  return CreateTcp(config, options, [](int socket) {
+    return std::make_shared<scl::TcpChannel>(socket);
+  });
+}
 
-  channels[config.Id()] = Self();
+scl::Network scl::Network::CreateThreadedSenders(const NetworkConfig& config,
+                                                 const TcpOptions& options) {
+  return CreateTcp(config, options, [](int socket) {
+    return std::make_shared<scl::ThreadedSenderChannel>(socket);
+  });
+}
 
-  std::thread server(AcceptConnections, std::ref(channels), config);
+scl::Network scl::Network::CreateSharedMemory(const NetworkConfig& config,
+                                              std::size_t capacity) {
+  const auto n = config.NetworkSize();
+  const auto my_id = config.Id();
+  const auto session = "scl-" + std::to_string(config.GetParty(0).port);
+
+  // Every party first creates the rings it reads from, and then opens the
+  // rings it writes to. Opening only waits for peers to create their rings,
+  // which they do without waiting on anyone, so this cannot deadlock.
+  std::vector<std::shared_ptr<scl::details::ShmRing>> in(n);
+  std::vector<std::shared_ptr<scl::details::ShmRing>> out(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (i == my_id) continue;
+    in[i] = scl::details::ShmRing::Create(
+        scl::ShmChannel::RingName(session, i, my_id), capacity);
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    if (i == my_id) continue;
+    out[i] = scl::details::ShmRing::Open(
+        scl::ShmChannel::RingName(session, my_id, i));
+  }
 
-  for (std::size_t i = 0; i < config.Id(); ++i) {
-    const auto party = config.GetParty(i);
-    auto socket = scl::details::ConnectAsClient(party.hostname, party.port);
-    std::shared_ptr<scl::Channel> channel =
-        std::make_shared<scl::ThreadedSenderChannel>(socket);
-    channel->Send((unsigned)config.Id());
-    channels[i] = channel;
+  std::vector<std::shared_ptr<scl::Channel>> channels(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (i == my_id) {
+      channels[i] = Self();
+    } else {
+      in[i]->WaitConnected();
+      channels[i] = std::make_shared<scl::ShmChannel>(in[i], out[i]);
+    }
   }
 
-  server.join();
+  return Network{channels};
+}
+
+scl::Network scl::Network::CreateEmulated(
+    const Network& network, unsigned id,
+    const std::vector<LinkConditions>& links,
+    std::shared_ptr<VirtualClock> clock) {
+  const auto n = network.Size();
+  if (links.size() != n)
+    throw std::invalid_argument("need the conditions of every link");
 
+  std::vector<std::shared_ptr<scl::Channel>> channels(network.mChannels);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (i == id) continue;
+    channels[i] =
+        std::make_shared<scl::EmulatedChannel>(channels[i], links[i], clock);
+  }
   return Network{channels};
 }
 
+scl::Network scl::Network::CreateEmulated(const Network& network, unsigned id,
+                                          const LinkConditions& link,
+                                          std::shared_ptr<VirtualClock> clock) {
+  const auto n = network.Size();
+  std::vector<LinkConditions> links(n, link);
+  for (std::size_t i = 0; i < n; ++i) links[i].seed = link.seed + id * n + i;
+  return CreateEmulated(network, id, links, clock);
+}
+
+scl::Network scl::Network::CreateInstrumented(const Network& network,
+                                              unsigned id) {
+  auto stats = std::make_shared<scl::NetworkStats>(network.Size());
+  std::vector<std::shared_ptr<scl::Channel>> channels(network.mChannels);
+  for (std::size_t i = 0; i < channels.size(); ++i) {
+    if (i == id) continue;
+    channels[i] =
+        std::make_shared<scl::InstrumentedChannel>(channels[i], stats, i);
+  }
+  Network instrumented{channels};
+  instrumented.mStats = stats;
+  return instrumented;
+}
+
 using BuildMockNetwork_ReturnT =
     std::pair<scl::Network, std::vector<std::shared_ptr<scl::Channel>>>;
 
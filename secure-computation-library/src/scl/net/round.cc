@@ -0,0 +1,158 @@
+/**
+ * @file round.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/round.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include "scl/net/tcp_utils.h"
+
+namespace {
+
+// Closes the epoll instance also when a handler throws
+struct EpollInstance {
+  EpollInstance() : fd(::epoll_create1(0)) {
+    if (fd < 0) scl::details::ThrowError("could not create epoll instance");
+  }
+  ~EpollInstance() { ::close(fd); }
+
+  void Control(int op, int socket, std::size_t party) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = party;
+    if (::epoll_ctl(fd, op, socket, &event) < 0)
+      scl::details::ThrowError("could not register socket with epoll");
+  }
+
+  int fd;
+};
+
+}  // namespace
+
+void scl::Round::Run() {
+  const auto n = mNetwork.Size();
+  // The channels only see the bytes that TryRecv returns, so messages and
+  // waiting time are counted here
+  auto* stats = mNetwork.Stats();
+  std::size_t pending = 0;
+  for (const auto& queue : mIncoming) pending += queue.size();
+
+  // Receives what is available from party i, and runs the handlers of the
+  // messages that are complete. Returns whether there was any progress.
+  auto progress = [&](std::size_t i) {
+    auto& queue = mIncoming[i];
+    bool any = false;
+    while (!queue.empty()) {
+      auto& in = queue.front();
+      if (in.received < in.size) {
+        auto got = mNetwork.Party(i)->TryRecv(in.dst + in.received,
+                                              in.size - in.received);
+        in.received += got;
+        any = any || got > 0;
+        if (in.received < in.size) break;
+      }
+      auto handler = std::move(in.handler);
+      queue.pop_front();
+      pending--;
+      if (stats) stats->Current(i).messages_recv++;
+      any = true;
+      if (handler) handler(i);
+    }
+    return any;
+  };
+
+  // Take what already arrived before sleeping on anything
+  for (std::size_t i = 0; i < n; ++i) progress(i);
+  if (pending == 0) return;
+
+  // The parties that are waited on with epoll, and the rest
+  std::vector<std::size_t> unpolled;
+  std::size_t polled = 0;
+  EpollInstance epoll;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (mIncoming[i].empty()) continue;
+    auto fd = mNetwork.Party(i)->PollDescriptor();
+    if (fd < 0) {
+      unpolled.emplace_back(i);
+    } else {
+      epoll.Control(EPOLL_CTL_ADD, fd, i);
+      polled++;
+    }
+  }
+
+  // Time spent waiting is charged once, to the party whose data ends the
+  // wait, so that the waits of all parties add up to the time waited
+  std::uint64_t waited_ns = 0;
+  auto waited = [&](std::chrono::steady_clock::time_point start) {
+    waited_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  };
+  auto made_progress = [&](std::size_t i) {
+    if (!progress(i)) return false;
+    if (stats && waited_ns > 0) stats->Current(i).recv_wait_ns += waited_ns;
+    waited_ns = 0;
+    return true;
+  };
+
+  std::vector<struct epoll_event> events(n);
+  while (pending > 0) {
+    bool any = false;
+    bool waiting_unpolled = false;
+    for (auto i : unpolled) {
+      any = made_progress(i) || any;
+      waiting_unpolled = waiting_unpolled || !mIncoming[i].empty();
+    }
+
+    if (polled > 0) {
+      // Only block if no other channel needs to be polled by hand
+      const bool block = !any && !waiting_unpolled;
+      int ready;
+      const auto start = std::chrono::steady_clock::now();
+      do {
+        ready = ::epoll_wait(epoll.fd, events.data(), events.size(),
+                             block ? -1 : 0);
+      } while (ready < 0 && errno == EINTR);
+      if (ready < 0) scl::details::ThrowError("epoll_wait failed");
+      if (block) waited(start);
+
+      for (int e = 0; e < ready; ++e) {
+        const auto i = events[e].data.u64;
+        any = made_progress(i) || any;
+        if (mIncoming[i].empty()) {
+          epoll.Control(EPOLL_CTL_DEL, mNetwork.Party(i)->PollDescriptor(), i);
+          polled--;
+        }
+      }
+    }
+
+    if (!any) {
+      const auto start = std::chrono::steady_clock::now();
+      std::this_thread::yield();
+      waited(start);
+    }
+  }
+}
@@ -0,0 +1,266 @@
+/**
+ * @file shm_channel.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/shm_channel.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "scl/net/futex.h"
+#include "scl/net/tcp_utils.h"
+
+/**
+ * @brief The control block at the start of a ring.
+ *
+ * head and tail count the bytes written and read so far. The fields written by
+ * the writer and by the reader are kept on separate cache lines.
+ */
+struct scl::details::ShmRingHeader {
+  std::atomic<std::uint32_t> magic;
+  std::atomic<std::uint32_t> connected;
+  std::atomic<std::uint32_t> closed;
+  std::uint64_t capacity;
+
+  alignas(64) std::atomic<std::uint64_t> head;
+  alignas(64) std::atomic<std::uint64_t> tail;
+
+  // signalled by the writer (resp. reader) when the ring gets data (space)
+  alignas(64) scl::details::FutexSignal data;
+  alignas(64) scl::details::FutexSignal space;
+};
+
+namespace {
+
+using Header = scl::details::ShmRingHeader;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared memory rings require lock-free atomics");
+
+// Set once the reader has initialized the header
+constexpr std::uint32_t kMagic = 0x53434c52;
+
+const char* const kClosedError = "shared memory ring closed";
+
+constexpr auto kPollInterval = std::chrono::milliseconds(1);
+
+// The data follows the header, which fills whole cache lines
+constexpr std::size_t kDataOffset = sizeof(Header);
+
+}  // namespace
+
+scl::details::ShmRing::ShmRing(const std::string& name, int fd,
+                               std::size_t size, bool owner)
+    : mName(name), mFd(fd), mSize(size), mLinked(owner) {
+  void* addr =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    ::close(fd);
+    if (owner) ::shm_unlink(name.c_str());
+    scl::details::ThrowError("could not map shared memory object");
+  }
+  mHeader = static_cast<Header*>(addr);
+  mData = static_cast<unsigned char*>(addr) + kDataOffset;
+}
+
+scl::details::ShmRing::~ShmRing() {
+  ::munmap(mHeader, mSize);
+  ::close(mFd);
+  if (mLinked) ::shm_unlink(mName.c_str());
+}
+
+std::shared_ptr<scl::details::ShmRing> scl::details::ShmRing::Create(
+    const std::string& name, std::size_t capacity) {
+  if (capacity == 0)
+    throw std::invalid_argument("ring capacity must be positive");
+
+  // An earlier run that crashed before connecting may have left the object
+  ::shm_unlink(name.c_str());
+  int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) scl::details::ThrowError("could not create shared memory object");
+
+  const auto size = kDataOffset + capacity;
+  if (::ftruncate(fd, size) < 0) {
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    scl::details::ThrowError("could not size shared memory object");
+  }
+
+  std::shared_ptr<ShmRing> ring(new ShmRing(name, fd, size, true));
+  auto* h = new (ring->mHeader) Header();
+  h->capacity = capacity;
+  h->magic.store(kMagic, std::memory_order_release);
+  return ring;
+}
+
+std::shared_ptr<scl::details::ShmRing> scl::details::ShmRing::Open(
+    const std::string& name) {
+  while (true) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      if (errno != ENOENT)
+        scl::details::ThrowError("could not open shared memory object");
+      std::this_thread::sleep_for(kPollInterval);
+      continue;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+      ::close(fd);
+      scl::details::ThrowError("could not stat shared memory object");
+    }
+
+    // The object exists, but the reader may not have sized and initialized
+    // it yet. A ring some other writer connected to is left over from an
+    // earlier run, and will be replaced by the reader
+    if (static_cast<std::size_t>(st.st_size) > kDataOffset) {
+      std::shared_ptr<ShmRing> ring(new ShmRing(name, fd, st.st_size, false));
+      auto* h = ring->mHeader;
+      if (h->magic.load(std::memory_order_acquire) == kMagic &&
+          h->connected.exchange(1) == 0) {
+        return ring;
+      }
+    } else {
+      ::close(fd);
+    }
+    std::this_thread::sleep_for(kPollInterval);
+  }
+}
+
+void scl::details::ShmRing::WaitConnected() {
+  while (!mHeader->connected.load()) std::this_thread::sleep_for(kPollInterval);
+  if (mLinked) {
+    ::shm_unlink(mName.c_str());
+    mLinked = false;
+  }
+}
+
+void scl::details::ShmRing::Write(const unsigned char* src, std::size_t n) {
+  auto* h = mHeader;
+  const auto cap = h->capacity;
+
+  while (n > 0) {
+    const auto head = h->head.load(std::memory_order_relaxed);
+    const auto tail = h->tail.load(std::memory_order_acquire);
+    if (head - tail == cap) {
+      h->space.WaitUntil(
+          [h, tail]() { return h->tail.load() != tail || h->closed.load(); });
+      if (h->tail.load() == tail) throw std::runtime_error(kClosedError);
+      continue;
+    }
+
+    const auto chunk = std::min<std::uint64_t>(n, cap - (head - tail));
+    const auto pos = head % cap;
+    const auto first = std::min<std::uint64_t>(chunk, cap - pos);
+    std::memcpy(mData + pos, src, first);
+    std::memcpy(mData, src + first, chunk - first);
+
+    h->head.store(head + chunk);
+    h->data.Notify();
+
+    src += chunk;
+    n -= chunk;
+  }
+}
+
+void scl::details::ShmRing::CopyOut(unsigned char* dst, std::uint64_t tail,
+                                    std::size_t n) {
+  const auto cap = mHeader->capacity;
+  const auto pos = tail % cap;
+  const auto first = std::min<std::uint64_t>(n, cap - pos);
+  std::memcpy(dst, mData + pos, first);
+  std::memcpy(dst + first, mData, n - first);
+
+  mHeader->tail.store(tail + n);
+  mHeader->space.Notify();
+}
+
+void scl::details::ShmRing::Read(unsigned char* dst, std::size_t n) {
+  auto* h = mHeader;
+
+  while (n > 0) {
+    const auto tail = h->tail.load(std::memory_order_relaxed);
+    const auto head = h->head.load(std::memory_order_acquire);
+    if (head == tail) {
+      h->data.WaitUntil(
+          [h, tail]() { return h->head.load() != tail || h->closed.load(); });
+      if (h->head.load() == tail) throw std::runtime_error(kClosedError);
+      continue;
+    }
+
+    const auto chunk = std::min<std::uint64_t>(n, head - tail);
+    CopyOut(dst, tail, chunk);
+    dst += chunk;
+    n -= chunk;
+  }
+}
+
+std::size_t scl::details::ShmRing::TryRead(unsigned char* dst, std::size_t n) {
+  auto* h = mHeader;
+  const auto tail = h->tail.load(std::memory_order_relaxed);
+  const auto head = h->head.load(std::memory_order_acquire);
+  if (head == tail && n > 0 && h->closed.load() && h->head.load() == tail)
+    throw std::runtime_error(kClosedError);
+
+  const auto chunk = std::min<std::uint64_t>(n, head - tail);
+  if (chunk > 0) CopyOut(dst, tail, chunk);
+  return chunk;
+}
+
+void scl::details::ShmRing::Close() {
+  mHeader->closed.store(1);
+  mHeader->data.NotifyAlways();
+  mHeader->space.NotifyAlways();
+}
+
+std::string scl::ShmChannel::RingName(const std::string& session,
+                                      unsigned from, unsigned to) {
+  return "/" + session + "-" + std::to_string(from) + "-" +
+         std::to_string(to);
+}
+
+std::array<std::shared_ptr<scl::ShmChannel>, 2> scl::ShmChannel::CreatePaired(
+    const std::string& session, std::size_t capacity) {
+  auto in0 = details::ShmRing::Create(RingName(session, 1, 0), capacity);
+  auto in1 = details::ShmRing::Create(RingName(session, 0, 1), capacity);
+  auto out0 = details::ShmRing::Open(RingName(session, 0, 1));
+  auto out1 = details::ShmRing::Open(RingName(session, 1, 0));
+  in0->WaitConnected();
+  in1->WaitConnected();
+  return {std::make_shared<ShmChannel>(in0, out0),
+          std::make_shared<ShmChannel>(in1, out1)};
+}
+
+void scl::ShmChannel::Close() {
+  mIn->Close();
+  mOut->Close();
+}
@@ -0,0 +1,127 @@
+/**
+ * @file stats.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/stats.h"
+
+#include <chrono>
+#include <stdexcept>
+
+scl::NetworkStats::NetworkStats(std::size_t n) : mSize(n) {
+  mPhases.push_back({"default", std::make_unique<LinkCounters[]>(n)});
+  mCurrent.store(mPhases.back().links.get());
+}
+
+void scl::NetworkStats::SetPhase(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (const auto& phase : mPhases) {
+    if (phase.name == name) {
+      mCurrent.store(phase.links.get());
+      return;
+    }
+  }
+  // Counters are never freed while the stats live, so a channel that still
+  // counts towards the previous phase is fine
+  mPhases.push_back({name, std::make_unique<LinkCounters[]>(mSize)});
+  mCurrent.store(mPhases.back().links.get());
+}
+
+const scl::LinkCounters& scl::NetworkStats::Get(const std::string& phase,
+                                                unsigned peer) const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (const auto& p : mPhases) {
+    if (p.name == phase) return p.links[peer];
+  }
+  throw std::invalid_argument("unknown phase: " + phase);
+}
+
+std::vector<std::string> scl::NetworkStats::Phases() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::vector<std::string> names;
+  for (const auto& p : mPhases) names.push_back(p.name);
+  return names;
+}
+
+void scl::NetworkStats::WriteJson(std::ostream& os, int self) const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  os << "{\"phases\": [";
+  for (std::size_t p = 0; p < mPhases.size(); ++p) {
+    os << (p ? ", " : "") << "{\"name\": \"" << mPhases[p].name
+       << "\", \"peers\": [";
+    bool first = true;
+    for (std::size_t i = 0; i < mSize; ++i) {
+      if (static_cast<int>(i) == self) continue;
+      const auto& c = mPhases[p].links[i];
+      os << (first ? "" : ", ") << "{\"peer\": " << i
+         << ", \"bytes_sent\": " << c.bytes_sent.load()
+         << ", \"bytes_recv\": " << c.bytes_recv.load()
+         << ", \"messages_sent\": " << c.messages_sent.load()
+         << ", \"messages_recv\": " << c.messages_recv.load()
+         << ", \"rounds\": " << c.rounds.load()
+         << ", \"recv_wait_ns\": " << c.recv_wait_ns.load() << "}";
+      first = false;
+    }
+    os << "]}";
+  }
+  os << "]}";
+}
+
+void scl::InstrumentedChannel::Send(const unsigned char* src, std::size_t n) {
+  auto& c = mStats->Current(mPeer);
+  c.bytes_sent += n;
+  c.messages_sent++;
+  mSentLast.store(true);
+  mChannel->Send(src, n);
+}
+
+void scl::InstrumentedChannel::SendV(const struct iovec* iov,
+                                     std::size_t count) {
+  auto& c = mStats->Current(mPeer);
+  // The peer receives each buffer with its own Recv
+  for (std::size_t i = 0; i < count; ++i) c.bytes_sent += iov[i].iov_len;
+  c.messages_sent += count;
+  mSentLast.store(true);
+  mChannel->SendV(iov, count);
+}
+
+void scl::InstrumentedChannel::Recv(unsigned char* dst, std::size_t n) {
+  const auto start = std::chrono::steady_clock::now();
+  mChannel->Recv(dst, n);
+  const auto waited = std::chrono::steady_clock::now() - start;
+
+  auto& c = mStats->Current(mPeer);
+  c.bytes_recv += n;
+  c.messages_recv++;
+  c.recv_wait_ns +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count();
+  if (mSentLast.exchange(false)) c.rounds++;
+}
+
+std::size_t scl::InstrumentedChannel::TryRecv(unsigned char* dst,
+                                              std::size_t n) {
+  const auto got = mChannel->TryRecv(dst, n);
+  if (got > 0) {
+    auto& c = mStats->Current(mPeer);
+    c.bytes_recv += got;
+    if (mSentLast.exchange(false)) c.rounds++;
+  }
+  return got;
+}
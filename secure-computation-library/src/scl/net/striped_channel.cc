@@ -0,0 +1,194 @@
+/**
+ * @file striped_channel.cc
+ *
+ * SCL --- Secure Computation Library
+ * Copyright (C) 2022 Anders Dalskov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include "scl/net/striped_channel.h"
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+namespace {
+
+// Call f(stream, offset, length) for each part of a message of n bytes split
+// across streams 1 to count - 1, with all but the first part on their own
+// thread. The error of the first part to fail is rethrown once all are done
+template <typename F>
+void ForEachPart(std::size_t n, std::size_t count, F f) {
+  const auto parts = count - 1;
+  const auto part = (n + parts - 1) / parts;
+
+  std::vector<std::future<void>> others;
+  for (std::size_t j = 1; j < parts && j * part < n; ++j) {
+    const auto offset = j * part;
+    const auto len = std::min(part, n - offset);
+    others.emplace_back(std::async(std::launch::async,
+                                   [&f, j, offset, len]() {
+                                     f(j + 1, offset, len);
+                                   }));
+  }
+
+  std::exception_ptr error;
+  try {
+    f(1, 0, std::min(part, n));
+  } catch (...) {
+    error = std::current_exception();
+  }
+  for (auto& other : others) {
+    try {
+      other.get();
+    } catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace
+
+scl::StripedChannel::StripedChannel(
+    std::vector<std::shared_ptr<Channel>> streams, std::size_t threshold)
+    : mStreams(streams), mThreshold(threshold) {
+  if (mStreams.size() < 2)
+    throw std::invalid_argument("a striped channel needs at least two streams");
+  if (mThreshold == 0)
+    throw std::invalid_argument("stripe threshold cannot be 0");
+}
+
+void scl::StripedChannel::Close() {
+  for (auto& stream : mStreams) stream->Close();
+}
+
+void scl::StripedChannel::Send(const unsigned char* src, std::size_t n) {
+  struct iovec iov = {const_cast<unsigned char*>(src), n};
+  SendV(&iov, 1);
+}
+
+void scl::StripedChannel::SendV(const struct iovec* iov, std::size_t count) {
+  // Every buffer is a message of its own, preceded by its length. Small ones
+  // and the headers are written to the first stream in as few writes as
+  // possible
+  std::vector<std::uint64_t> headers(count);
+  std::vector<struct iovec> batch;
+  batch.reserve(2 * count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto len = iov[i].iov_len;
+    if (len == 0) continue;
+    headers[i] = len;
+    batch.push_back({&headers[i], sizeof(std::uint64_t)});
+    if (len < mThreshold) {
+      batch.push_back(iov[i]);
+    } else {
+      mStreams[0]->SendV(batch.data(), batch.size());
+      batch.clear();
+      SendStriped(static_cast<const unsigned char*>(iov[i].iov_base), len);
+    }
+  }
+  if (!batch.empty()) mStreams[0]->SendV(batch.data(), batch.size());
+}
+
+void scl::StripedChannel::SendStriped(const unsigned char* src,
+                                      std::size_t n) {
+  ForEachPart(n, mStreams.size(),
+              [this, src](std::size_t stream, std::size_t offset,
+                          std::size_t len) {
+                mStreams[stream]->Send(src + offset, len);
+              });
+}
+
+void scl::StripedChannel::RecvStriped(unsigned char* dst, std::size_t n) {
+  ForEachPart(n, mStreams.size(),
+              [this, dst](std::size_t stream, std::size_t offset,
+                          std::size_t len) {
+                mStreams[stream]->Recv(dst + offset, len);
+              });
+}
+
+bool scl::StripedChannel::NextMessage(bool block) {
+  auto* header = reinterpret_cast<unsigned char*>(&mHeader);
+  const auto rem = sizeof(std::uint64_t) - mHeaderRead;
+  if (block) {
+    mStreams[0]->Recv(header + mHeaderRead, rem);
+    mHeaderRead += rem;
+  } else {
+    mHeaderRead += mStreams[0]->TryRecv(header + mHeaderRead, rem);
+    if (mHeaderRead < sizeof(std::uint64_t)) return false;
+  }
+  mHeaderRead = 0;
+  mLeft = mHeader;
+  return true;
+}
+
+std::size_t scl::StripedChannel::Take(unsigned char* dst, std::size_t n,
+                                      bool block) {
+  if (mBufferPos < mBuffer.size()) {
+    const auto k = std::min(n, mBuffer.size() - mBufferPos);
+    std::copy(mBuffer.begin() + mBufferPos, mBuffer.begin() + mBufferPos + k,
+              dst);
+    mBufferPos += k;
+    if (mBufferPos == mBuffer.size()) {
+      mBuffer.clear();
+      mBufferPos = 0;
+    }
+    return k;
+  }
+
+  if (mLeft == 0) {
+    if (!NextMessage(block)) return 0;
+    if (mLeft >= mThreshold) {
+      const auto len = mLeft;
+      mLeft = 0;
+      // Receive straight into dst when the whole message fits
+      if (n >= len) {
+        RecvStriped(dst, len);
+        return len;
+      }
+      mBuffer.resize(len);
+      RecvStriped(mBuffer.data(), len);
+      return Take(dst, n, block);
+    }
+  }
+
+  const auto k = std::min(n, mLeft);
+  std::size_t got = k;
+  if (block) {
+    mStreams[0]->Recv(dst, k);
+  } else {
+    got = mStreams[0]->TryRecv(dst, k);
+  }
+  mLeft -= got;
+  return got;
+}
+
+void scl::StripedChannel::Recv(unsigned char* dst, std::size_t n) {
+  while (n > 0) {
+    const auto got = Take(dst, n, true);
+    dst += got;
+    n -= got;
+  }
+}
+
+std::size_t scl::StripedChannel::TryRecv(unsigned char* dst, std::size_t n) {
+  if (n == 0) return 0;
+  return Take(dst, n, false);
+}
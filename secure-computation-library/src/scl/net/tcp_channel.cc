@@ -22,6 +22,44 @@ void scl::TcpChannel::Send(const unsigned char* src, std::size_t n) {
   }
 }
 
+void scl::TcpChannel::SendV(const struct iovec* iov, std::size_t count) {
+  // Number of buffers passed to each writev. Well below IOV_MAX
+  constexpr std::size_t kBatch = 64;
+  struct iovec batch[kBatch];
+
+  // the next byte to send is at offset in buffer i
+  std::size_t i = 0;
+  std::size_t offset = 0;
+
+  while (true) {
+    while (i < count && offset == iov[i].iov_len) {
+      ++i;
+      offset = 0;
+    }
+    if (i == count) break;
+
+    std::size_t m = 0;
+    for (; m < kBatch && i + m < count; ++m) batch[m] = iov[i + m];
+    batch[0].iov_base = static_cast<unsigned char*>(batch[0].iov_base) + offset;
+    batch[0].iov_len -= offset;
+
+    auto sent = scl::details::WriteVToSocket(mSocket, batch, m);
+    if (sent < 0) scl::details::ThrowError("write failed");
+
+    std::size_t rem = sent;
+    while (rem > 0) {
+      const auto left = iov[i].iov_len - offset;
+      if (rem < left) {
+        offset += rem;
+        break;
+      }
+      rem -= left;
+      ++i;
+      offset = 0;
+    }
+  }
+}
+
 void scl::TcpChannel::Recv(unsigned char* dst, std::size_t n) {
   std::size_t rem = n;
   std::size_t offset = 0;
@@ -35,3 +73,7 @@ void scl::TcpChannel::Recv(unsigned char* dst, std::size_t n) {
     offset += recv;
   }
 }
+
+std::size_t scl::TcpChannel::TryRecv(unsigned char* dst, std::size_t n) {
+  return scl::details::TryReadFromSocket(mSocket, dst, n);
+}
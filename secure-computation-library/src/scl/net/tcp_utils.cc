@@ -1,9 +1,13 @@
 #include "scl/net/tcp_utils.h"
 
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <cstddef>
@@ -12,6 +16,17 @@
 #include <system_error>
 #include <thread>
 
+namespace {
+
+// Connection attempts are retried after 1ms, 2ms, 4ms, ... up to this
+constexpr auto kMaxBackoff = std::chrono::milliseconds(100);
+
+[[noreturn]] void ThrowTimeout(const std::string& what) {
+  throw std::system_error(ETIMEDOUT, std::generic_category(), what);
+}
+
+}  // namespace
+
 int scl::details::CreateServerSocket(int port, int backlog) {
   int err;
   int ssock = ::socket(AF_INET, SOCK_STREAM, 0);
@@ -50,6 +65,22 @@ scl::details::AcceptedConnection scl::details::AcceptConnection(
   return ac;
 }
 
+scl::details::AcceptedConnection scl::details::AcceptConnection(
+    int server_socket, std::chrono::steady_clock::time_point deadline) {
+  while (true) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) ThrowTimeout("timed out waiting for peers");
+
+    struct pollfd pfd = {server_socket, POLLIN, 0};
+    const auto ready =
+        ::poll(&pfd, 1, std::min<std::chrono::milliseconds::rep>(left.count(), 1000));
+    if (ready < 0 && errno != EINTR)
+      scl::details::ThrowError("could not poll server socket");
+    if (ready > 0) return AcceptConnection(server_socket);
+  }
+}
+
 std::string scl::details::GetAddress(
     scl::details::AcceptedConnection connection) {
   struct sockaddr_in* s =
@@ -58,11 +89,13 @@ std::string scl::details::GetAddress(
 }
 
 int scl::details::ConnectAsClient(std::string hostname, int port) {
-  using namespace std::chrono_literals;
-
-  int sock = ::socket(AF_INET, SOCK_STREAM, 0);
-  if (sock < 0) scl::details::ThrowError("could not acquire socket");
+  TcpOptions options;
+  options.timeout = std::chrono::milliseconds(0);
+  return ConnectAsClient(hostname, port, options);
+}
 
+int scl::details::ConnectAsClient(const std::string& hostname, int port,
+                                  const TcpOptions& options) {
   struct sockaddr_in addr;
   addr.sin_family = AF_INET;
   addr.sin_port = ::htons(port);
@@ -71,10 +104,48 @@ int scl::details::ConnectAsClient(std::string hostname, int port) {
   if (err == 0) throw std::runtime_error("invalid hostname");
   if (err < 0) scl::details::ThrowError("invalid address family");
 
-  while (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
-    std::this_thread::sleep_for(300ms);
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration backoff = std::chrono::milliseconds(1);
+  while (true) {
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) scl::details::ThrowError("could not acquire socket");
+    ConfigureSocket(sock, options);
+    if (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+      return sock;
+    ::close(sock);
+
+    // The server is not up yet, or its backlog is full
+    auto wait = backoff;
+    if (options.timeout.count() > 0) {
+      const auto left =
+          start + options.timeout - std::chrono::steady_clock::now();
+      if (left <= left.zero()) {
+        ThrowTimeout("could not connect to " + hostname + ":" +
+                     std::to_string(port));
+      }
+      wait = std::min(wait, left);
+    }
+    std::this_thread::sleep_for(wait);
+    backoff = std::min<std::chrono::steady_clock::duration>(2 * backoff,
+                                                            kMaxBackoff);
+  }
+}
 
-  return sock;
+void scl::details::ConfigureSocket(int socket, const TcpOptions& options) {
+  int opt = options.no_delay;
+  if (opt &&
+      ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) < 0)
+    scl::details::ThrowError("could not set TCP_NODELAY");
+
+  opt = options.send_buffer;
+  if (opt > 0 &&
+      ::setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &opt, sizeof(opt)) < 0)
+    scl::details::ThrowError("could not set SO_SNDBUF");
+
+  opt = options.recv_buffer;
+  if (opt > 0 &&
+      ::setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt)) < 0)
+    scl::details::ThrowError("could not set SO_RCVBUF");
 }
 
 int scl::details::CloseSocket(int socket) { return ::close(socket); }
@@ -84,7 +155,24 @@ int scl::details::ReadFromSocket(int socket, unsigned char* dst,
   return ::read(socket, dst, n);
 }
 
+std::size_t scl::details::TryReadFromSocket(int socket, unsigned char* dst,
+                                            std::size_t n) {
+  if (n == 0) return 0;
+  auto recv = ::recv(socket, dst, n, MSG_DONTWAIT);
+  if (recv == 0) throw std::runtime_error("connection closed by peer");
+  if (recv < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+    scl::details::ThrowError("read failed");
+  }
+  return recv;
+}
+
 int scl::details::WriteToSocket(int socket, const unsigned char* src,
                                 std::size_t n) {
   return ::write(socket, src, n);
 }
+
+ssize_t scl::details::WriteVToSocket(int socket, const struct iovec* iov,
+                                     int iovcnt) {
+  return ::writev(socket, iov, iovcnt);
+}
@@ -2,23 +2,39 @@
 
 #include <future>
 
-scl::ThreadedSenderChannel::ThreadedSenderChannel(int socket)
-    : mChannel(scl::TcpChannel(socket)) {
-  mSender = std::async(std::launch::async, [&]() {
-    while (true) {
-      auto data = mSendBuffer.Peek();
-      if (!mChannel.Alive()) {
-        break;
+#include "scl/net/tcp_utils.h"
+
+scl::ThreadedSenderChannel::ThreadedSenderChannel(int socket,
+                                                  std::size_t capacity)
+    : mChannel(scl::TcpChannel(socket)), mSendBuffer(capacity) {
+  mSender = std::async(std::launch::async, [this]() {
+    struct iovec iov[2];
+    int count;
+    while ((count = mSendBuffer.Readable(iov)) > 0) {
+      auto sent = scl::details::WriteVToSocket(mChannel.Socket(), iov, count);
+      if (sent < 0) {
+        // Unblock the producer before giving up
+        mSendBuffer.Close();
+        scl::details::ThrowError("write failed");
       }
-      mChannel.Send(data.data(), data.size());
-      mSendBuffer.PopFront();
+      mSendBuffer.Consume(sent);
     }
   });
 }
 
+scl::ThreadedSenderChannel::~ThreadedSenderChannel() {
+  if (mSender.valid()) {
+    mSendBuffer.Close();
+    mSender.wait();
+  }
+}
+
 void scl::ThreadedSenderChannel::Close() {
+  if (!mSender.valid()) return;
+
+  mSendBuffer.Close();
+  auto sender = std::move(mSender);
+  sender.wait();
   mChannel.Close();
-  unsigned char stop_signal = 1;
-  Send(&stop_signal, 1);
-  mSender.wait();
+  sender.get();
 }
@@ -0,0 +1,127 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "scl/math/ff.h"
+#include "scl/math/kernels.h"
+#include "scl/math/vec.h"
+#include "scl/prg.h"
+
+using Field = scl::FF<61>;
+using Kernels = scl::details::Mersenne61Kernels;
+using u64 = std::uint64_t;
+
+namespace {
+
+// Random values, with the extremes of the field at the front so that
+// they also land in the vectorized part of the kernels
+std::vector<u64> RandomValues(std::size_t n, scl::PRG& prg) {
+  const u64 p = (1ULL << 61) - 1;
+  std::vector<u64> values;
+  values.reserve(n);
+  values.emplace_back(p - 1);
+  values.emplace_back(0);
+  values.emplace_back(1);
+  values.emplace_back(p - 2);
+  while (values.size() < n) {
+    Field x = Field::Random(prg);
+    values.emplace_back(*scl::details::RawValues(&x));
+  }
+  values.resize(n);
+  return values;
+}
+
+void CompareWithScalar(const Kernels& kernels) {
+  const auto& scalar = Kernels::Scalar();
+  scl::PRG prg;
+  for (std::size_t n : {0, 1, 3, 4, 8, 13, 64, 67}) {
+    auto a = RandomValues(n, prg);
+    auto b = RandomValues(n, prg);
+    u64 c = RandomValues(5, prg).back();
+
+    auto expected = a;
+    auto actual = a;
+    scalar.Add(expected.data(), b.data(), n);
+    kernels.Add(actual.data(), b.data(), n);
+    REQUIRE(actual == expected);
+
+    expected = a;
+    actual = a;
+    scalar.Multiply(expected.data(), b.data(), n);
+    kernels.Multiply(actual.data(), b.data(), n);
+    REQUIRE(actual == expected);
+
+    expected = a;
+    actual = a;
+    scalar.MultiplyAccumulate(expected.data(), c, b.data(), n);
+    kernels.MultiplyAccumulate(actual.data(), c, b.data(), n);
+    REQUIRE(actual == expected);
+
+    REQUIRE(kernels.Dot(a.data(), b.data(), n) ==
+            scalar.Dot(a.data(), b.data(), n));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Mersenne61Kernels", "[math]") {
+  SECTION("Scalar") {
+    scl::PRG prg;
+    auto a = RandomValues(10, prg);
+    auto b = RandomValues(10, prg);
+    auto c = a;
+    Kernels::Scalar().Multiply(c.data(), b.data(), c.size());
+    Field dot;
+    for (std::size_t i = 0; i < a.size(); i++) {
+      Field x;
+      Field y;
+      *scl::details::RawValues(&x) = a[i];
+      *scl::details::RawValues(&y) = b[i];
+      REQUIRE(*scl::details::RawValues(&(x *= y)) == c[i]);
+      dot += x;
+    }
+    REQUIRE(Kernels::Scalar().Dot(a.data(), b.data(), a.size()) ==
+            *scl::details::RawValues(&dot));
+  }
+
+  SECTION("AVX2") {
+    if (Kernels::AVX2()) CompareWithScalar(*Kernels::AVX2());
+  }
+
+  SECTION("AVX512IFMA") {
+    if (Kernels::AVX512IFMA()) CompareWithScalar(*Kernels::AVX512IFMA());
+  }
+
+  SECTION("Best") { CompareWithScalar(Kernels::Best()); }
+
+  SECTION("LazyDot") {
+    // All entries p-1 is the worst case for the unreduced accumulator
+    const u64 p = (1ULL << 61) - 1;
+    for (std::size_t n : {0, 1, 62, 63, 64, 130}) {
+      std::vector<u64> a(n, p - 1);
+      std::vector<u64> b(n, p - 1);
+      REQUIRE(scl::details::Mersenne61LazyDot(a.data(), b.data(), n) ==
+              Kernels::Best().Dot(a.data(), b.data(), n));
+    }
+    scl::PRG prg;
+    auto a = RandomValues(200, prg);
+    auto b = RandomValues(200, prg);
+    REQUIRE(scl::details::Mersenne61LazyDot(a.data(), b.data(), 200) ==
+            Kernels::Best().Dot(a.data(), b.data(), 200));
+  }
+
+  SECTION("MatVec") {
+    scl::PRG prg;
+    auto m = scl::Mat<Field>::Random(7, 70, prg);
+    auto v = scl::Vec<Field>::Random(70, prg);
+    auto mv = m.Multiply(v);
+    REQUIRE(mv.Size() == 7);
+    for (std::size_t i = 0; i < 7; i++) {
+      Field entry;
+      for (std::size_t j = 0; j < 70; j++) entry += m(i, j) * v[j];
+      REQUIRE(mv[i] == entry);
+    }
+    REQUIRE_THROWS_MATCHES(
+        m.Multiply(scl::Vec<Field>(3)), std::invalid_argument,
+        Catch::Matchers::Message("invalid matrix dimensions for multiply"));
+  }
+}
@@ -127,6 +127,23 @@ TEST_CASE("Matrix", "[math]") {
         Catch::Matchers::Message("invalid matrix dimensions for multiply"));
   }
 
+  SECTION("MultiplyWide") {
+    // Dimensions that cross the blocking boundaries of Multiply
+    scl::PRG prg;
+    auto a = Mat::Random(3, 70, prg);
+    auto b = Mat::Random(70, 1030, prg);
+    auto c = a.Multiply(b);
+    REQUIRE(c.Rows() == 3);
+    REQUIRE(c.Cols() == 1030);
+    Mat expected(3, 1030);
+    for (std::size_t i = 0; i < c.Rows(); i++) {
+      for (std::size_t j = 0; j < c.Cols(); j++) {
+        for (std::size_t k = 0; k < a.Cols(); k++) expected(i, j) += a(i, k) * b(k, j);
+      }
+    }
+    REQUIRE(c.Equals(expected));
+  }
+
   SECTION("ScalarMultiply") {
     auto m2 = m0.ScalarMultiply(F(2));
     REQUIRE(m2(0, 0) == F(2));
@@ -0,0 +1,85 @@
+#include <sys/uio.h>
+
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "scl/net/byte_ring.h"
+#include "scl/prg.h"
+#include "util.h"
+
+// Reads n bytes from the ring, in the way the threaded sender does
+static void Drain(scl::details::ByteRing& ring, unsigned char* dst,
+                  std::size_t n) {
+  while (n > 0) {
+    struct iovec iov[2];
+    int count = ring.Readable(iov);
+    if (count == 0) break;
+    std::size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+      auto len = std::min(iov[i].iov_len, n - total);
+      std::memcpy(dst + total, iov[i].iov_base, len);
+      total += len;
+    }
+    ring.Consume(total);
+    dst += total;
+    n -= total;
+  }
+}
+
+TEST_CASE("ByteRing", "[network]") {
+  scl::PRG prg;
+  unsigned char data_in[200] = {0};
+  prg.Next(data_in, 200);
+
+  SECTION("Wrap around") {
+    scl::details::ByteRing ring(64);
+    unsigned char data_out[200] = {0};
+
+    ring.Write(data_in, 50);
+    Drain(ring, data_out, 50);
+
+    // The next 40 bytes are split in two regions
+    ring.Write(data_in + 50, 40);
+    struct iovec iov[2];
+    REQUIRE(ring.Readable(iov) == 2);
+    REQUIRE(iov[0].iov_len == 14);
+    REQUIRE(iov[1].iov_len == 26);
+    Drain(ring, data_out + 50, 40);
+
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 90));
+  }
+
+  SECTION("Backpressure") {
+    scl::details::ByteRing ring(16);
+    std::vector<unsigned char> data_out(2000);
+
+    std::thread producer([&]() {
+      for (int i = 0; i < 10; ++i) ring.Write(data_in, 200);
+    });
+    Drain(ring, data_out.data(), 2000);
+    producer.join();
+
+    bool eq = true;
+    for (int i = 0; i < 10; ++i)
+      eq = eq && scl_tests::BufferEquals(data_in, data_out.data() + 200 * i, 200);
+    REQUIRE(eq);
+  }
+
+  SECTION("Close") {
+    scl::details::ByteRing ring(16);
+    ring.Write(data_in, 10);
+    ring.Close();
+
+    // What was written before closing can still be read
+    unsigned char data_out[10] = {0};
+    Drain(ring, data_out, 10);
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 10));
+
+    struct iovec iov[2];
+    REQUIRE(ring.Readable(iov) == 0);
+    REQUIRE_THROWS_MATCHES(ring.Write(data_in, 20), std::runtime_error,
+                           Catch::Matchers::Message("ring closed"));
+  }
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "scl/math.h"
+#include "scl/net/emulated_channel.h"
+#include "scl/net/mem_channel.h"
+#include "scl/net/network.h"
+#include "scl/prg.h"
+#include "util.h"
+
+using namespace std::chrono_literals;
+
+static std::array<std::shared_ptr<scl::Channel>, 2> EmulatedPair(
+    scl::LinkConditions link, std::shared_ptr<scl::VirtualClock> clock0,
+    std::shared_ptr<scl::VirtualClock> clock1) {
+  auto chls = scl::InMemoryChannel::CreatePaired();
+  return {std::make_shared<scl::EmulatedChannel>(chls[0], link, clock0),
+          std::make_shared<scl::EmulatedChannel>(chls[1], link, clock1)};
+}
+
+TEST_CASE("EmulatedChannel", "[network]") {
+  scl::PRG prg;
+  unsigned char data_in[200] = {0};
+  prg.Next(data_in, 200);
+
+  SECTION("Profiles") {
+    auto lan = scl::LinkConditions::FromProfile("lan");
+    REQUIRE(lan.latency == 1ms);
+    REQUIRE(lan.bandwidth == 8e9);
+    auto custom = scl::LinkConditions::FromProfile("10,60");
+    REQUIRE(custom.latency == 10ms);
+    REQUIRE(custom.bandwidth == 60e6);
+    REQUIRE_THROWS_MATCHES(
+        scl::LinkConditions::FromProfile("10ms"), std::invalid_argument,
+        Catch::Matchers::Message("invalid network profile: 10ms"));
+    REQUIRE_THROWS_AS(scl::LinkConditions::FromProfile("1,x"),
+                      std::invalid_argument);
+  }
+
+  SECTION("Latency") {
+    scl::LinkConditions link;
+    link.latency = 20ms;
+    auto channels = EmulatedPair(link, nullptr, nullptr);
+    unsigned char data_out[200] = {0};
+
+    const auto start = std::chrono::steady_clock::now();
+    channels[0]->Send(data_in, 200);
+    channels[1]->Recv(data_out, 200);
+    REQUIRE(std::chrono::steady_clock::now() - start >= 20ms);
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 200));
+  }
+
+  SECTION("Bandwidth") {
+    // 10 messages of 10 kB at 1 MB/s take 100 ms to go on the link
+    scl::LinkConditions link;
+    link.bandwidth = 8e6;
+    auto channels = EmulatedPair(link, nullptr, nullptr);
+    std::vector<unsigned char> data(10000);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i) channels[0]->Send(data.data(), data.size());
+    for (int i = 0; i < 10; ++i) channels[1]->Recv(data.data(), data.size());
+    REQUIRE(std::chrono::steady_clock::now() - start >= 100ms);
+  }
+
+  SECTION("Jitter keeps order") {
+    scl::LinkConditions link;
+    link.jitter = 2ms;
+    auto channels = EmulatedPair(link, nullptr, nullptr);
+    for (int i = 0; i < 50; ++i) channels[0]->Send(i);
+    bool ordered = true;
+    for (int i = 0; i < 50; ++i) {
+      int x;
+      channels[1]->Recv(x);
+      ordered = ordered && x == i;
+    }
+    REQUIRE(ordered);
+  }
+
+  SECTION("Virtual time") {
+    // 1 MB at 8 Mbit/s plus 1 s of latency arrives 2 s later, without waiting
+    scl::LinkConditions link;
+    link.latency = 1s;
+    link.bandwidth = 8e6;
+    auto clock0 = std::make_shared<scl::VirtualClock>();
+    auto clock1 = std::make_shared<scl::VirtualClock>();
+    auto channels = EmulatedPair(link, clock0, clock1);
+    std::vector<unsigned char> data(1000000);
+    data[12345] = 42;
+
+    const auto start = std::chrono::steady_clock::now();
+    channels[0]->Send(data.data(), data.size());
+    channels[0]->Send(data_in, 200);
+    std::vector<unsigned char> big(data.size());
+    unsigned char data_out[200] = {0};
+    channels[1]->Recv(big.data(), big.size());
+    channels[1]->Recv(data_out, 200);
+    REQUIRE(std::chrono::steady_clock::now() - start < 1s);
+    REQUIRE(clock1->Now() - start >= 2s);
+    REQUIRE(clock0->Offset() == 0s);
+    REQUIRE(big == data);
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 200));
+  }
+
+  SECTION("Virtual time with vectors") {
+    scl::LinkConditions link;
+    link.latency = 10ms;
+    auto clock = std::make_shared<scl::VirtualClock>();
+    auto channels = EmulatedPair(link, clock, clock);
+    const auto start = clock->Now();
+    auto v = scl::Vec<scl::FF<61>>::Random(20, prg);
+    channels[0]->Send(v);
+    scl::Vec<scl::FF<61>> w;
+    channels[1]->Recv(w);
+    REQUIRE(v.Equals(w));
+    REQUIRE(clock->Now() - start >= 10ms);
+  }
+
+  SECTION("Network") {
+    auto networks = scl::Network::CreateFullInMemory(3);
+    auto link = scl::LinkConditions::FromProfile("5,100");
+    for (unsigned i = 0; i < 3; ++i) {
+      networks[i] = scl::Network::CreateEmulated(networks[i], i, link);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < 3; ++i) {
+      for (unsigned j = 0; j < 3; ++j) networks[i].Party(j)->Send(10 * i + j);
+    }
+    bool ok = true;
+    for (unsigned j = 0; j < 3; ++j) {
+      for (unsigned i = 0; i < 3; ++i) {
+        unsigned x;
+        networks[j].Party(i)->Recv(x);
+        ok = ok && x == 10 * i + j;
+      }
+    }
+    REQUIRE(ok);
+    REQUIRE(std::chrono::steady_clock::now() - start >= 5ms);
+
+    for (auto& network : networks) network.Close();
+  }
+}
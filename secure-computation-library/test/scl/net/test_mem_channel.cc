@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
+#include <chrono>
 #include <cstring>
+#include <future>
 #include <iostream>
 #include <vector>
 
@@ -109,6 +111,43 @@ TEST_CASE("InMemoryChannel", "[network]") {
   chl0->Flush();
   chl1->Flush();
 
+  SECTION("Send many Vecs") {
+    scl::Channel* c0 = chl0.get();
+    scl::Channel* c1 = chl1.get();
+    std::vector<Vec> vs = {Vec::Random(10, prg), Vec{}, Vec::Random(3, prg)};
+    c0->SendMany(vs);
+
+    // Received one by one, into a Vec of the right size and one that is not
+    Vec w0(10);
+    auto data = w0.ToStlVector().data();
+    c1->Recv(w0);
+    REQUIRE(w0.ToStlVector().data() == data);
+    std::vector<Vec> w(2);
+    c1->RecvMany(w);
+    REQUIRE(vs[0].Equals(w0));
+    REQUIRE(vs[1].Equals(w[0]));
+    REQUIRE(vs[2].Equals(w[1]));
+  }
+
+  chl0->Flush();
+  chl1->Flush();
+
+  SECTION("Recv reduces elements") {
+    scl::Channel* c0 = chl0.get();
+    scl::Channel* c1 = chl1.get();
+    // 2^61 - 1 + 5 is not reduced, and must be read as 5
+    std::uint32_t size = 1;
+    std::uint64_t value = (((std::uint64_t)1) << 61) + 4;
+    c0->Send(size);
+    c0->Send(value);
+    Vec w;
+    c1->Recv(w);
+    REQUIRE(w[0] == FF(5));
+  }
+
+  chl0->Flush();
+  chl1->Flush();
+
   using Mat = scl::Mat<FF>;
 
   SECTION("Send mat") {
@@ -121,6 +160,38 @@ TEST_CASE("InMemoryChannel", "[network]") {
     REQUIRE(m.Equals(a));
   }
 
+  chl0->Flush();
+  chl1->Flush();
+
+  SECTION("Receive asynchronously") {
+    scl::Channel* c0 = chl0.get();
+    scl::Channel* c1 = chl1.get();
+
+    // All receives are started before anything is sent
+    unsigned char data_out[200] = {0};
+    Vec w;
+    FF range[2];
+    auto f0 = c1->RecvAsync(data_out, 200);
+    auto f1 = c1->RecvAsync(w);
+    auto f2 = c1->RecvAsync(range, 2);
+    REQUIRE(f0.wait_for(std::chrono::milliseconds(10)) ==
+            std::future_status::timeout);
+
+    auto v = Vec::Random(10, prg);
+    std::uint64_t values[] = {3, (((std::uint64_t)1) << 61) + 4};
+    c0->Send(data_in, 200);
+    c0->Send(v);
+    c0->Send(reinterpret_cast<const unsigned char*>(values), sizeof(values));
+
+    f0.get();
+    f1.get();
+    f2.get();
+    REQUIRE(Eq(data_in, data_out, 200));
+    REQUIRE(v.Equals(w));
+    REQUIRE(range[0] == FF(3));
+    REQUIRE(range[1] == FF(5));
+  }
+
   SECTION("Send self") {
     auto c = scl::InMemoryChannel::CreateSelfConnecting();
 
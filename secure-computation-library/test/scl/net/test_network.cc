@@ -1,8 +1,22 @@
 #include <catch2/catch.hpp>
+#include <chrono>
+#include <system_error>
 #include <thread>
+#include <vector>
 
 #include "scl/net/config.h"
 #include "scl/net/network.h"
+#include "scl/net/tcp_utils.h"
+#include "util.h"
+
+using namespace std::chrono_literals;
+
+// Reserve a port for each party of a network
+static int GetPorts(std::size_t n) {
+  const int base = scl_tests::GetPort();
+  for (std::size_t i = 1; i < n; ++i) scl_tests::GetPort();
+  return base;
+}
 
 TEST_CASE("Network", "[network]") {
   SECTION("Mock") {
@@ -86,4 +100,55 @@ TEST_CASE("Network", "[network]") {
 
     REQUIRE(x == 5555);
   }
+
+  SECTION("TCP out of order") {
+    // Parties with a higher id start first, so their first connection attempts
+    // are refused and must be retried
+    const std::size_t n = 8;
+    const int port = GetPorts(n);
+    std::vector<scl::Network> networks(n);
+    std::vector<std::thread> parties;
+    for (std::size_t i = n; i-- > 0;) {
+      parties.emplace_back([&, i]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5 * (n - i)));
+        networks[i] =
+            scl::Network::Create(scl::NetworkConfig::Localhost(i, n, port));
+      });
+    }
+    for (auto& p : parties) p.join();
+
+    for (std::size_t i = 0; i < n; ++i) {
+      networks[i].Party((i + 1) % n)->Send((int)i);
+    }
+    bool ok = true;
+    for (std::size_t i = 0; i < n; ++i) {
+      int x;
+      networks[i].Party((i + n - 1) % n)->Recv(x);
+      ok = ok && x == (int)((i + n - 1) % n);
+    }
+    REQUIRE(ok);
+    for (auto& network : networks) network.Close();
+  }
+
+  SECTION("TCP connect timeout") {
+    scl::TcpOptions options;
+    options.timeout = 50ms;
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE_THROWS_AS(scl::details::ConnectAsClient("127.0.0.1",
+                                                    scl_tests::GetPort(),
+                                                    options),
+                      std::system_error);
+    REQUIRE(std::chrono::steady_clock::now() - start >= 50ms);
+  }
+
+  SECTION("TCP accept timeout") {
+    // Party 1 waits for party 0, which never shows up
+    scl::TcpOptions options;
+    options.timeout = 100ms;
+    const int port = GetPorts(2);
+    REQUIRE_THROWS_AS(
+        scl::Network::Create(scl::NetworkConfig::Localhost(1, 2, port),
+                             options),
+        std::system_error);
+  }
 }
@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "scl/net/config.h"
+#include "scl/net/network.h"
+#include "scl/net/round.h"
+#include "util.h"
+
+TEST_CASE("Round", "[network]") {
+  SECTION("In memory") {
+    auto networks = scl::Network::CreateFullInMemory(3);
+
+    // Two messages from party 1, received in the order they are posted
+    networks[1].Party(0)->Send(std::vector<int>{1, 2});
+    networks[1].Party(0)->Send(std::vector<int>{3});
+    networks[2].Party(0)->Send(std::vector<int>{4, 5, 6});
+
+    std::vector<int> a(2), b(1), c(3);
+    std::vector<std::size_t> done;
+    scl::Round round(networks[0]);
+    round.Recv(1, a, [&](std::size_t i) { done.emplace_back(i); });
+    round.Recv(1, b, [&](std::size_t i) { done.emplace_back(i); });
+    round.Recv(2, c);
+    round.Run();
+
+    REQUIRE(a == std::vector<int>{1, 2});
+    REQUIRE(b == std::vector<int>{3});
+    REQUIRE(c == std::vector<int>{4, 5, 6});
+    REQUIRE(done == std::vector<std::size_t>{1, 1});
+  }
+
+  SECTION("TCP") {
+    const std::size_t n = 3;
+    // Party i listens on port + i
+    const int port = scl_tests::GetPort();
+    for (std::size_t i = 1; i < n; ++i) scl_tests::GetPort();
+    std::vector<scl::Network> networks(n);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < n; ++i) {
+      threads.emplace_back([&networks, i, port, n]() {
+        auto config = scl::NetworkConfig::Localhost(i, n, port);
+        networks[i] = scl::Network::CreateThreadedSenders(config);
+      });
+    }
+    for (auto& t : threads) t.join();
+
+    // Party 1 sends late, and its message is larger than what fits in the
+    // socket's buffers. The message of party 2 is handled first
+    std::vector<unsigned> data(1 << 22);
+    for (std::size_t j = 0; j < data.size(); ++j) data[j] = j;
+    std::thread late([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      scl::Round(networks[1]).Send(0, data);
+    });
+    scl::Round(networks[2]).Send(0, std::vector<unsigned>{7});
+
+    std::vector<unsigned> from1(data.size()), from2(1);
+    std::vector<std::size_t> done;
+    scl::Round round(networks[0]);
+    round.Recv(1, from1, [&](std::size_t i) { done.emplace_back(i); });
+    round.Recv(2, from2, [&](std::size_t i) { done.emplace_back(i); });
+    round.Run();
+    late.join();
+
+    REQUIRE(from1 == data);
+    REQUIRE(from2 == std::vector<unsigned>{7});
+    REQUIRE(done == std::vector<std::size_t>{2, 1});
+
+    for (auto& network : networks) network.Close();
+  }
+}
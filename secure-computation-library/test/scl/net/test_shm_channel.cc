@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+#include "scl/math.h"
+#include "scl/net/network.h"
+#include "scl/net/shm_channel.h"
+#include "scl/prg.h"
+#include "util.h"
+
+TEST_CASE("ShmChannel", "[network]") {
+  scl::PRG prg;
+  unsigned char data_in[200] = {0};
+  prg.Next(data_in, 200);
+
+  SECTION("Send and receive") {
+    auto channels = scl::ShmChannel::CreatePaired("scl-test-shm-basic");
+    unsigned char data_out[200] = {0};
+
+    channels[0]->Send(data_in, 50);
+    channels[0]->Send(data_in + 50, 150);
+    channels[1]->Recv(data_out, 100);
+    channels[1]->Recv(data_out + 100, 100);
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 200));
+
+    channels[1]->Send(data_in, 200);
+    channels[0]->Recv(data_out, 200);
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 200));
+  }
+
+  SECTION("Larger than the ring") {
+    // Each message wraps around a 64 byte ring several times
+    auto channels = scl::ShmChannel::CreatePaired("scl-test-shm-wrap", 64);
+    std::vector<unsigned char> data_out(200);
+
+    std::thread sender([&]() {
+      for (int i = 0; i < 10; ++i) channels[0]->Send(data_in, 200);
+    });
+    bool eq = true;
+    for (int i = 0; i < 10; ++i) {
+      channels[1]->Recv(data_out.data(), 200);
+      eq = eq && scl_tests::BufferEquals(data_in, data_out.data(), 200);
+    }
+    sender.join();
+    REQUIRE(eq);
+  }
+
+  SECTION("Send vectors") {
+    auto channels = scl::ShmChannel::CreatePaired("scl-test-shm-vec", 128);
+    auto v = scl::Vec<scl::FF<61>>::Random(100, prg);
+    std::thread sender([&]() { channels[0]->Send(v); });
+    scl::Vec<scl::FF<61>> w;
+    channels[1]->Recv(w);
+    sender.join();
+    REQUIRE(v.Equals(w));
+  }
+
+  SECTION("Closed") {
+    auto channels = scl::ShmChannel::CreatePaired("scl-test-shm-closed");
+    unsigned char data_out[200] = {0};
+    channels[0]->Send(data_in, 100);
+    channels[0]->Close();
+
+    // Data sent before closing can still be received
+    channels[1]->Recv(data_out, 100);
+    REQUIRE(scl_tests::BufferEquals(data_in, data_out, 100));
+    REQUIRE_THROWS_MATCHES(channels[1]->Recv(data_out, 100),
+                           std::runtime_error,
+                           Catch::Matchers::Message("shared memory ring closed"));
+  }
+
+  SECTION("Network") {
+    std::vector<scl::Network> networks(3);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < 3; ++i) {
+      threads.emplace_back([&networks, i]() {
+        auto config = scl::NetworkConfig::Localhost(i, 3, 7700);
+        networks[i] = scl::Network::CreateSharedMemory(config, 1024);
+      });
+    }
+    for (auto& t : threads) t.join();
+
+    for (unsigned i = 0; i < 3; ++i) {
+      for (unsigned j = 0; j < 3; ++j) networks[i].Party(j)->Send(10 * i + j);
+    }
+    bool ok = true;
+    for (unsigned j = 0; j < 3; ++j) {
+      for (unsigned i = 0; i < 3; ++i) {
+        unsigned x;
+        networks[j].Party(i)->Recv(x);
+        ok = ok && x == 10 * i + j;
+      }
+    }
+    REQUIRE(ok);
+
+    for (auto& network : networks) network.Close();
+  }
+}
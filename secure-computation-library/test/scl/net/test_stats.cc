@@ -0,0 +1,130 @@
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "scl/math.h"
+#include "scl/net/network.h"
+#include "scl/net/round.h"
+#include "scl/net/stats.h"
+#include "scl/prg.h"
+#include "util.h"
+
+TEST_CASE("NetworkStats", "[network]") {
+  SECTION("Phases") {
+    scl::NetworkStats stats(3);
+    REQUIRE(stats.Phases() == std::vector<std::string>{"default"});
+    stats.Current(1).bytes_sent += 5;
+    stats.SetPhase("a");
+    stats.Current(1).bytes_sent += 7;
+    stats.SetPhase("b");
+    stats.SetPhase("a");
+    stats.Current(1).bytes_sent += 1;
+
+    REQUIRE(stats.Phases() == std::vector<std::string>{"default", "a", "b"});
+    REQUIRE(stats.Get("default", 1).bytes_sent == 5);
+    REQUIRE(stats.Get("a", 1).bytes_sent == 8);
+    REQUIRE(stats.Get("b", 1).bytes_sent == 0);
+    REQUIRE_THROWS_MATCHES(stats.Get("c", 1), std::invalid_argument,
+                           Catch::Matchers::Message("unknown phase: c"));
+  }
+
+  SECTION("Instrumented network") {
+    auto networks = scl::Network::CreateFullInMemory(3);
+    for (unsigned i = 0; i < 3; ++i) {
+      networks[i] = scl::Network::CreateInstrumented(networks[i], i);
+    }
+    REQUIRE(networks[0].Stats() != nullptr);
+
+    networks[0].SetPhase("send");
+    networks[1].SetPhase("send");
+    scl::PRG prg;
+    auto v = scl::Vec<scl::FF<61>>::Random(10, prg);
+    networks[0].Party(1)->Send(v);
+    networks[0].Party(1)->Send(42);
+    scl::Vec<scl::FF<61>> w;
+    int x;
+    networks[1].Party(0)->Recv(w);
+    networks[1].Party(0)->Recv(x);
+
+    // A reply ends a round trip for party 0
+    networks[0].SetPhase("reply");
+    networks[1].SetPhase("reply");
+    networks[1].Party(0)->Send(x);
+    networks[0].Party(1)->Recv(x);
+
+    auto* s0 = networks[0].Stats();
+    auto* s1 = networks[1].Stats();
+    const std::size_t vec_bytes = sizeof(std::uint32_t) + 10 * 8;
+    REQUIRE(s0->Get("send", 1).bytes_sent == vec_bytes + sizeof(int));
+    // The size and the content of v, and then 42
+    REQUIRE(s0->Get("send", 1).messages_sent == 3);
+    REQUIRE(s1->Get("send", 0).messages_recv == 3);
+    REQUIRE(s0->Get("send", 2).bytes_sent == 0);
+    REQUIRE(s1->Get("send", 0).bytes_recv == vec_bytes + sizeof(int));
+    REQUIRE(s1->Get("send", 0).rounds == 0);
+    REQUIRE(s0->Get("reply", 1).bytes_recv == sizeof(int));
+    REQUIRE(s0->Get("reply", 1).messages_recv == 1);
+    REQUIRE(s0->Get("reply", 1).rounds == 1);
+
+    std::stringstream ss;
+    s0->WriteJson(ss, 0);
+    REQUIRE(ss.str().rfind("{\"phases\": [{\"name\": \"default\", \"peers\": "
+                           "[{\"peer\": 1, \"bytes_sent\": 0",
+                           0) == 0);
+  }
+
+  SECTION("Received through a round") {
+    const int port = scl_tests::GetPort();
+    for (int i = 1; i < 3; ++i) scl_tests::GetPort();
+    std::vector<scl::Network> networks(3);
+    std::vector<std::thread> parties;
+    for (unsigned i = 0; i < 3; ++i) {
+      parties.emplace_back([&, i]() {
+        networks[i] = scl::Network::CreateThreadedSenders(
+            scl::NetworkConfig::Localhost(i, 3, port));
+      });
+    }
+    for (auto& p : parties) p.join();
+    auto network = scl::Network::CreateInstrumented(networks[0], 0);
+
+    // Party 1 is late, and party 2 sends two messages right away
+    std::thread late([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      networks[1].Party(0)->Send(std::vector<int>{1, 2, 3});
+    });
+    networks[2].Party(0)->Send(std::vector<int>{4});
+    networks[2].Party(0)->Send(std::vector<int>{5});
+
+    std::vector<int> x(3), y(1), z(1);
+    scl::Round round(network);
+    round.Recv(1, x);
+    round.Recv(2, y);
+    round.Recv(2, z);
+    const auto start = std::chrono::steady_clock::now();
+    round.Run();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    late.join();
+
+    REQUIRE(x == std::vector<int>{1, 2, 3});
+    REQUIRE(z == std::vector<int>{5});
+    auto* s = network.Stats();
+    REQUIRE(s->Get("default", 1).messages_recv == 1);
+    REQUIRE(s->Get("default", 2).messages_recv == 2);
+    REQUIRE(s->Get("default", 1).bytes_recv == 3 * sizeof(int));
+    REQUIRE(s->Get("default", 1).recv_wait_ns >= 40'000'000);
+    // Each wait is charged to one party only
+    const auto waited =
+        s->Get("default", 1).recv_wait_ns + s->Get("default", 2).recv_wait_ns;
+    REQUIRE(std::chrono::nanoseconds(waited) <= elapsed);
+
+    for (auto& n : networks) n.Close();
+  }
+
+  SECTION("Not instrumented") {
+    auto networks = scl::Network::CreateFullInMemory(2);
+    REQUIRE(networks[0].Stats() == nullptr);
+    REQUIRE_NOTHROW(networks[0].SetPhase("a"));
+  }
+}
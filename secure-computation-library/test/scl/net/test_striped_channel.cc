@@ -0,0 +1,145 @@
+#include <catch2/catch.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "scl/math.h"
+#include "scl/net/mem_channel.h"
+#include "scl/net/network.h"
+#include "scl/net/striped_channel.h"
+#include "scl/prg.h"
+#include "util.h"
+
+static std::array<std::shared_ptr<scl::Channel>, 2> StripedPair(
+    std::size_t streams, std::size_t threshold) {
+  std::vector<std::shared_ptr<scl::Channel>> a, b;
+  for (std::size_t i = 0; i < streams; ++i) {
+    auto chls = scl::InMemoryChannel::CreatePaired();
+    a.push_back(chls[0]);
+    b.push_back(chls[1]);
+  }
+  return {std::make_shared<scl::StripedChannel>(a, threshold),
+          std::make_shared<scl::StripedChannel>(b, threshold)};
+}
+
+TEST_CASE("StripedChannel", "[network]") {
+  scl::PRG prg;
+  std::vector<unsigned char> data_in(1000);
+  prg.Next(data_in.data(), data_in.size());
+
+  SECTION("Small and large") {
+    auto channels = StripedPair(4, 100);
+    std::vector<unsigned char> data_out(1000);
+    channels[0]->Send(data_in.data(), 10);
+    channels[0]->Send(data_in.data(), 1000);
+    channels[0]->Send(data_in.data(), 99);
+    channels[1]->Recv(data_out.data(), 10);
+    REQUIRE(scl_tests::BufferEquals(data_in.data(), data_out.data(), 10));
+    channels[1]->Recv(data_out.data(), 1000);
+    REQUIRE(data_in == data_out);
+    channels[1]->Recv(data_out.data(), 99);
+    REQUIRE(scl_tests::BufferEquals(data_in.data(), data_out.data(), 99));
+  }
+
+  SECTION("Uneven parts") {
+    // 101 bytes over 3 bulk streams
+    auto channels = StripedPair(4, 100);
+    std::vector<unsigned char> data_out(101);
+    channels[0]->Send(data_in.data(), 101);
+    channels[1]->Recv(data_out.data(), 101);
+    REQUIRE(scl_tests::BufferEquals(data_in.data(), data_out.data(), 101));
+  }
+
+  SECTION("Received in other pieces") {
+    auto channels = StripedPair(3, 100);
+    std::vector<unsigned char> data_out(1000);
+    channels[0]->Send(data_in.data(), 500);
+    channels[0]->Send(data_in.data() + 500, 20);
+    channels[0]->Send(data_in.data() + 520, 480);
+    channels[1]->Recv(data_out.data(), 300);
+    channels[1]->Recv(data_out.data() + 300, 510);
+    channels[1]->Recv(data_out.data() + 810, 190);
+    REQUIRE(data_in == data_out);
+  }
+
+  SECTION("Vectors") {
+    auto channels = StripedPair(3, 64);
+    auto small = scl::Vec<scl::FF<61>>::Random(2, prg);
+    auto large = scl::Vec<scl::FF<61>>::Random(1000, prg);
+    channels[0]->SendMany(std::vector<scl::Vec<scl::FF<61>>>{small, large});
+    channels[0]->Send(42);
+    scl::Vec<scl::FF<61>> small_out, large_out;
+    int x;
+    channels[1]->Recv(small_out);
+    channels[1]->Recv(large_out);
+    channels[1]->Recv(x);
+    REQUIRE(small.Equals(small_out));
+    REQUIRE(large.Equals(large_out));
+    REQUIRE(x == 42);
+  }
+
+  SECTION("TryRecv") {
+    auto channels = StripedPair(2, 100);
+    std::vector<unsigned char> data_out(1000);
+    channels[0]->Send(data_in.data(), 10);
+    channels[0]->Send(data_in.data() + 10, 990);
+    std::size_t got = 0;
+    while (got < 1000)
+      got += channels[1]->TryRecv(data_out.data() + got, 1000 - got);
+    REQUIRE(data_in == data_out);
+  }
+
+  SECTION("Async") {
+    auto channels = StripedPair(3, 100);
+    std::vector<unsigned char> data_out(1000);
+    auto done = channels[1]->RecvAsync(data_out.data(), 1000);
+    channels[0]->Send(data_in.data(), 1000);
+    done.get();
+    REQUIRE(data_in == data_out);
+  }
+
+  SECTION("Too few streams") {
+    std::vector<std::shared_ptr<scl::Channel>> one{
+        scl::InMemoryChannel::CreatePaired()[0]};
+    REQUIRE_THROWS_AS(scl::StripedChannel(one, 100), std::invalid_argument);
+  }
+
+  SECTION("TCP network") {
+    scl::TcpOptions options;
+    options.streams = 3;
+    options.stripe_threshold = 100;
+    const int port = scl_tests::GetPort();
+    for (int i = 1; i < 3; ++i) scl_tests::GetPort();
+
+    std::vector<scl::Network> networks(3);
+    std::vector<std::thread> parties;
+    for (unsigned i = 0; i < 3; ++i) {
+      parties.emplace_back([&, i]() {
+        networks[i] = scl::Network::CreateThreadedSenders(
+            scl::NetworkConfig::Localhost(i, 3, port), options);
+      });
+    }
+    for (auto& p : parties) p.join();
+
+    // Nothing was sent yet
+    unsigned char buf[4];
+    REQUIRE(networks[1].Party(2)->TryRecv(buf, 4) == 0);
+
+    std::vector<unsigned char> big(1 << 20);
+    prg.Next(big.data(), big.size());
+    networks[2].Party(0)->Send(big.data(), big.size());
+    networks[2].Party(0)->Send(7);
+    networks[0].Party(1)->Send(8);
+
+    std::vector<unsigned char> big_out(big.size());
+    int x, y;
+    networks[0].Party(2)->Recv(big_out.data(), big_out.size());
+    networks[0].Party(2)->Recv(x);
+    networks[1].Party(0)->Recv(y);
+    REQUIRE(big == big_out);
+    REQUIRE(x == 7);
+    REQUIRE(y == 8);
+
+    for (auto& network : networks) network.Close();
+  }
+}
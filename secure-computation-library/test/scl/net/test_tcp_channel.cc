@@ -66,4 +66,77 @@ TEST_CASE("TcpChannel", "[network]") {
 
     REQUIRE(scl_tests::BufferEquals(send, recv, 200));
   }
+
+  SECTION("Send scatter-gather") {
+    auto port = scl_tests::GetPort();
+
+    std::shared_ptr<scl::TcpChannel> client, server;
+    std::thread clt([&]() {
+      int socket = scl::details::ConnectAsClient("0.0.0.0", port);
+      client = std::make_shared<scl::TcpChannel>(socket);
+    });
+
+    std::thread srv([&]() {
+      int ssock = scl::details::CreateServerSocket(port, 1);
+      auto ac = scl::details::AcceptConnection(ssock);
+      server = std::make_shared<scl::TcpChannel>(ac.socket);
+      scl::details::CloseSocket(ssock);
+    });
+
+    clt.join();
+    srv.join();
+
+    // More buffers than a single writev takes, some of them empty, and more
+    // data than fits in the socket's buffers
+    scl::PRG prg;
+    std::vector<unsigned char> send(1 << 24);
+    prg.Next(send.data(), send.size());
+    std::vector<struct iovec> iov;
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < 200; ++i) {
+      std::size_t len = i % 3 == 0 ? 0 : send.size() / 150;
+      iov.push_back({send.data() + offset, len});
+      offset += len;
+    }
+    iov.push_back({send.data() + offset, send.size() - offset});
+
+    std::vector<unsigned char> recv(send.size());
+    std::thread sender([&]() { client->SendV(iov.data(), iov.size()); });
+    server->Recv(recv.data(), recv.size());
+    sender.join();
+
+    REQUIRE(send == recv);
+  }
+
+  SECTION("Receive asynchronously") {
+    auto port = scl_tests::GetPort();
+
+    std::shared_ptr<scl::TcpChannel> client, server;
+    std::thread clt([&]() {
+      int socket = scl::details::ConnectAsClient("0.0.0.0", port);
+      client = std::make_shared<scl::TcpChannel>(socket);
+    });
+
+    std::thread srv([&]() {
+      int ssock = scl::details::CreateServerSocket(port, 1);
+      auto ac = scl::details::AcceptConnection(ssock);
+      server = std::make_shared<scl::TcpChannel>(ac.socket);
+      scl::details::CloseSocket(ssock);
+    });
+
+    clt.join();
+    srv.join();
+
+    // More data than fits in the socket's buffers, so the send only completes
+    // because the receive runs in the background
+    scl::PRG prg;
+    std::vector<unsigned char> send(1 << 24);
+    prg.Next(send.data(), send.size());
+    std::vector<unsigned char> recv(send.size());
+    auto received = server->RecvAsync(recv.data(), recv.size());
+    client->Send(send.data(), send.size());
+    received.get();
+
+    REQUIRE(send == recv);
+  }
 }
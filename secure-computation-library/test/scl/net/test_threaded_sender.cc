@@ -45,4 +45,41 @@ TEST_CASE("ThreadedSender", "[network]") {
 
     REQUIRE(scl_tests::BufferEquals(send, recv, 200));
   }
+
+  SECTION("Many small messages") {
+    auto port = scl_tests::GetPort();
+
+    std::shared_ptr<scl::Channel> client, server;
+
+    // A send buffer smaller than the data, so that Send has to wait for the
+    // sender thread
+    std::thread clt([&]() {
+      int socket = scl::details::ConnectAsClient("0.0.0.0", port);
+      client = std::make_shared<scl::ThreadedSenderChannel>(socket, 100);
+    });
+
+    std::thread srv([&]() {
+      int ssock = scl::details::CreateServerSocket(port, 1);
+      auto ac = scl::details::AcceptConnection(ssock);
+      server = std::make_shared<scl::ThreadedSenderChannel>(ac.socket);
+      scl::details::CloseSocket(ssock);
+    });
+
+    clt.join();
+    srv.join();
+
+    for (unsigned i = 0; i < 1000; ++i) client->Send(i);
+    // Close sends what is still buffered
+    client->Close();
+
+    bool ok = true;
+    for (unsigned i = 0; i < 1000; ++i) {
+      unsigned x;
+      server->Recv(x);
+      ok = ok && x == i;
+    }
+    server->Close();
+
+    REQUIRE(ok);
+  }
 }
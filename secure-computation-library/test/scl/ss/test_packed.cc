@@ -65,4 +65,42 @@ TEST_CASE("Packed-SS", "[pss]") {
     REQUIRE(reconstructed.Equals(secrets));
   }  
 
+  SECTION("PackedSharingPlan") {
+    Vec secrets{FF(123), FF(456), FF(789)};
+    auto& plan = scl::details::PackedSharingPlan<FF>::Get(n_shares, secrets.Size(), degree);
+    REQUIRE(&plan == &scl::details::PackedSharingPlan<FF>::Get(n_shares, secrets.Size(), degree));
+
+    // Same PRG state gives the same shares as the polynomial route
+    scl::PRG prg_plan;
+    scl::PRG prg_poly;
+    auto shares = plan.Share(secrets, prg_plan);
+    auto poly = scl::details::EvPolyFromSecretsAndDegree(secrets, degree, prg_poly);
+    REQUIRE(shares.Equals(scl::details::SharesFromEvPoly(poly, n_shares)));
+
+    REQUIRE(plan.Reconstruct(shares).Equals(secrets));
+    REQUIRE(plan.ReconstructAt(2, shares) == secrets[2]);
+
+    // Column j of ShareMany matches the j-th call to Share
+    auto many = scl::Mat<FF>::Random(secrets.Size(), 5, prg);
+    scl::PRG prg_many;
+    scl::PRG prg_one;
+    auto shares_many = plan.ShareMany(many, prg_many);
+    auto secrets_many = plan.ReconstructMany(shares_many);
+    REQUIRE(secrets_many.Equals(many));
+    for (std::size_t j = 0; j < many.Cols(); j++) {
+      Vec column{many(0, j), many(1, j), many(2, j)};
+      auto shares_one = plan.Share(column, prg_one);
+      for (std::size_t i = 0; i < n_shares; i++) REQUIRE(shares_many(i, j) == shares_one[i]);
+    }
+
+    REQUIRE_THROWS_MATCHES(
+        plan.Share(Vec{FF(1)}, prg),
+        std::invalid_argument,
+        Catch::Matchers::Message("number of secrets does not match the plan"));
+    REQUIRE_THROWS_MATCHES(
+        scl::details::PackedSharingPlan<FF>(n_shares, degree+2, degree),
+        std::invalid_argument,
+        Catch::Matchers::Message("number of secrets is larger than number of x points"));
+  }
+
 }
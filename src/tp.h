@@ -1,6 +1,7 @@
 #ifndef TP_H
 #define TP_H
 
+#include <cstdint>
 #include <vector>
 
 #include "scl.h"
@@ -10,10 +11,75 @@ namespace tp {
   using Shr = FF;
   using Poly = scl::details::EvPolynomial<FF>;
   using Vec = scl::Vec<FF>;
+  using SharingPlan = scl::details::PackedSharingPlan<FF>;
 
   template<typename T>
   using vec = std::vector<T>;
 
+  // Wires are identified by the index of the gate that outputs them
+  using WireId = std::uint32_t;
+
+  // Sends buffers[i] to party i as a single message. Empty buffers
+  // are skipped, which matches RecvFromParties below
+  inline void SendToParties(std::shared_ptr<scl::Network> network, const vec<vec<FF>>& buffers) {
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      if ( !buffers[i].empty() ) network->Party(i)->Send(buffers[i]);
+    }
+  }
+
+  // Receives n_elements from each party in [from, to), one message
+  // per party, in the order in which they arrive. The outer index of
+  // the output is the party id
+  inline vec<vec<FF>> RecvFromParties(std::shared_ptr<scl::Network> network, std::size_t n_elements,
+				      std::size_t from, std::size_t to) {
+    vec<vec<FF>> buffers(network->Size());
+    scl::Round round(*network);
+    for (std::size_t i = from; i < to; ++i) {
+      buffers[i].resize(n_elements);
+      if ( n_elements > 0 ) round.Recv(i, buffers[i]);
+    }
+    round.Run();
+    return buffers;
+  }
+
+  inline vec<vec<FF>> RecvFromParties(std::shared_ptr<scl::Network> network, std::size_t n_elements) {
+    return RecvFromParties(network, n_elements, 0, network->Size());
+  }
+
+  // Receives n_elements[i] from each party i, skipping the parties
+  // with nothing to send
+  inline vec<vec<FF>> RecvFromParties(std::shared_ptr<scl::Network> network,
+				      const vec<std::size_t>& n_elements) {
+    vec<vec<FF>> buffers(network->Size());
+    scl::Round round(*network);
+    for (std::size_t i = 0; i < n_elements.size(); ++i) {
+      buffers[i].resize(n_elements[i]);
+      if ( n_elements[i] > 0 ) round.Recv(i, buffers[i]);
+    }
+    round.Run();
+    return buffers;
+  }
+
+  // Which party reconstructs and reshares each batch, the king. With
+  // kParty0 it is P1 for all batches, as in the paper. With
+  // kRotating, batch b goes to party b mod n, so that every party
+  // handles 1/n of the batches and no link carries more than the
+  // others. All parties must use the same policy
+  enum class KingPolicy { kParty0, kRotating };
+
+  inline std::size_t King(KingPolicy policy, std::size_t batch, std::size_t n_parties) {
+    return policy == KingPolicy::kRotating ? batch % n_parties : 0;
+  }
+
+  // The batches in [begin, end) handled by each king, in increasing
+  // order. Messages to and from a king hold its batches in this order
+  inline vec<vec<std::size_t>> BatchesPerKing(KingPolicy policy, std::size_t begin, std::size_t end,
+					      std::size_t n_parties) {
+    vec<vec<std::size_t>> batches(n_parties);
+    for (std::size_t b = begin; b < end; b++) batches[King(policy, b, n_parties)].emplace_back(b);
+    return batches;
+  }
+
 }
 
 #endif  // TP_H
@@ -2,13 +2,17 @@
 #define CIRCUIT_H
 
 #include <iostream>
+#include <type_traits>
 #include <assert.h>
 
 #include "tp/mult_gate.h"
 #include "tp/input_gate.h"
 #include "tp/output_gate.h"
+#include "tp/flat_circuit.h"
 
 #include "tp/correlator.h"
+#include "tp/prep_pool.h"
+#include "tp/thread_pool.h"
 
 using VecMultGates = std::vector<std::shared_ptr<tp::MultGate>>;
 
@@ -57,12 +61,17 @@ namespace tp {
     // Append output gates
     std::shared_ptr<OutputGate> Output(std::size_t owner_id, std::shared_ptr<Gate> output);
 
-    // Consolidates the batches for the outputs
-    void CloseOutputs() { for (auto output_layer : mOutputLayers) output_layer.Close(); mIsClosed = true; }
+    // Consolidates the batches for the outputs, and lays out the
+    // flat circuit the protocol runs over. This assigns every
+    // multiplication to a layer from its multiplicative depth (see
+    // FlatCircuit::AssignLayers), regardless of the layers opened
+    // while building. No gates can be added afterwards
+    void CloseOutputs() { for (auto output_layer : mOutputLayers) output_layer.Close(); Finalize(); }
 
     // Append addition gates
     std::shared_ptr<AddGate> Add(std::shared_ptr<Gate> left, std::shared_ptr<Gate> right) {
       auto add_gate = std::make_shared<tp::AddGate>(left, right);
+      add_gate->mWire = mFlat.AddGate(GateType::kAdd, left->GetWire(), right->GetWire());
       mAddGates.emplace_back(add_gate);
       return add_gate;
     }
@@ -74,7 +83,9 @@ namespace tp {
     // Used after the multiplications of a given layer have been
     // added, and new multiplications will be added to the next
     // layer. This closes the current layer, meaning that dummy gates
-    // are appended if necessary to reach a full batch 
+    // are appended if necessary to reach a full batch.
+    // Optional: these layers only serve GetMultGate while building,
+    // since CloseOutputs reassigns the layers
     void NewLayer();
 
     // Closes the current layer and does not open a new one. 
@@ -87,27 +98,29 @@ namespace tp {
       mID = id;
       mParties = network->Size();
 
-      for (auto input_layer : mInputLayers) input_layer.SetNetwork(network, id);
-      for (auto mult_layer : mMultLayers) mult_layer.SetNetwork(network, id);
-      for (auto output_layer : mOutputLayers) output_layer.SetNetwork(network, id);
+      for (auto& input_layer : mInputLayers) input_layer.SetNetwork(network, id);
+      for (auto& mult_layer : mMultLayers) mult_layer.SetNetwork(network, id);
+      for (auto& output_layer : mOutputLayers) output_layer.SetNetwork(network, id);
 
       mIsNetworkSet = true;
     }
 
-    // Used to fetch input and output gates
-    std::shared_ptr<InputGate> GetInputGate(std::size_t owner_id, std::size_t idx) { return mFlatInputGates[owner_id][idx]; }
-    std::shared_ptr<InputGate> GetInputGate(std::size_t idx) { return mInputGates[idx]; }
-    std::shared_ptr<OutputGate> GetOutputGate(std::size_t owner_id, std::size_t idx) { return mFlatOutputGates[owner_id][idx]; }
-    std::shared_ptr<OutputGate> GetOutputGate(std::size_t idx) { return mOutputGates[idx]; }
+    // Used to fetch input and output gates. Once the circuit is
+    // closed, the protocol runs over the flat circuit, and the gates
+    // returned carry the current mu (and value, for outputs) of their
+    // wire
+    std::shared_ptr<InputGate> GetInputGate(std::size_t owner_id, std::size_t idx) { return Synced(mFlatInputGates[owner_id][idx]); }
+    std::shared_ptr<InputGate> GetInputGate(std::size_t idx) { return Synced(mInputGates[idx]); }
+    std::shared_ptr<OutputGate> GetOutputGate(std::size_t owner_id, std::size_t idx) { return Synced(mFlatOutputGates[owner_id][idx]); }
+    std::shared_ptr<OutputGate> GetOutputGate(std::size_t idx) { return Synced(mOutputGates[idx]); }
 
     // Used to fetch the idx-th mult gate of the desired layer
     std::shared_ptr<MultGate> GetMultGate(std::size_t layer, std::size_t idx) {
-      auto out = mFlatMultLayers[layer][idx];
-      // auto out2 = mLayers[layer].GetMultBatch(idx/mBatchSize)->GetMultGate(idx % mBatchSize);
-      // assert(mLayers[layer].GetMultBatch(idx/mBatchSize)->GetMultGate(idx % mBatchSize) == out); // PASSES
-      return out;
+      return Synced(mFlatMultLayers[layer][idx]);
     }
 
+    const FlatCircuit& GetFlatCircuit() { return mFlat; }
+
     // Set inputs for evaluations in the clear. Input is a vector of
     // vectors indicating the inputs of each party
     void SetClearInputs(std::vector<std::vector<FF>> inputs_per_client);
@@ -186,20 +199,12 @@ namespace tp {
     void GenZeroForProdPartiesSend() { mCorrelator.GenZeroForProdPartiesSend(); }
     void GenZeroForProdPartiesReceive() { mCorrelator.GenZeroForProdPartiesReceive(); }
 
-    void FIPrepSend() {
-      GenIndShrsPartiesSend();
-      GenUnpackedShrPartiesSend();
-      GenZeroPartiesSend();
-      GenZeroForProdPartiesSend();      
-    }
-
-    void FIPrepRecv() {
-      GenIndShrsPartiesReceive();
-      GenUnpackedShrPartiesReceive();
-      GenZeroPartiesReceive();
-      GenZeroForProdPartiesReceive();      
-    }
+    // All the steps above, with a single message per peer
+    void FIPrepSend() { mCorrelator.FIPrepSend(); }
+    void FIPrepRecv() { mCorrelator.FIPrepRecv(); }
 
+    // With kRotating every party is a king, and these three steps
+    // use the same channels, so they must run in order
     void GenProdPartiesSendP1() { mCorrelator.GenProdPartiesSendP1(); }
     void GenProdP1ReceivesAndSends() { mCorrelator.GenProdP1ReceivesAndSends(); }
     void GenProdPartiesReceive() { mCorrelator.GenProdPartiesReceive(); }
@@ -216,6 +221,63 @@ namespace tp {
     void PrepOutputs();
     void PrepMults();
 
+    // All of the preprocessing above, from FIPrepSend to
+    // PrepIOOwnerReceives, streamed over chunks of batches_per_chunk
+    // mult batches. Only the F.I. preprocessing of the current chunk
+    // is held, and that of the next one is computed on another thread
+    // while the F.D. preprocessing of the current one runs. Every
+    // party must call this at the same time, after GenCorrelator,
+    // SetThreshold and, if used, the PRSS setup. The correlator is
+    // left set for the whole circuit, as after GenCorrelator
+    void PipelinedPrep(std::size_t batches_per_chunk);
+
+    // PERSISTENT PREPROCESSING
+    // The preprocessing can be stored on disk, so that the offline
+    // phase runs well before the online phase, and in another
+    // process. Each party stores its own file, see prep_store.h
+
+    // Writes what the online phase needs, that is, the packed
+    // sharings of every mult batch and the lambdas of the wires of
+    // the input and output batches the party owns. To be called after
+    // PrepIOOwnerReceives (or PipelinedPrep)
+    void SavePrep(const std::string& path);
+
+    // Maps the file written by SavePrep for this same circuit and
+    // party, after which the online phase can run without any
+    // preprocessing. Only SetNetwork is needed before
+    void LoadPrep(const std::string& path);
+
+    // Same for the F.I. preprocessing, after the GenProd steps (see
+    // Correlator::SaveFIPrep). LoadFIPrep takes the place of the F.I.
+    // preprocessing, and is followed by MapCorrToCircuit and the F.D.
+    // preprocessing as usual
+    void SaveFIPrep(const std::string& path) { mCorrelator.SaveFIPrep(path); }
+    void LoadFIPrep(const std::string& path) { mCorrelator.LoadFIPrep(path); }
+
+    // BACKGROUND PREPROCESSING
+    // For repeated evaluations of the same circuit, the F.I.
+    // preprocessing can be produced in the background, see PrepPool
+
+    // Starts producing F.I. preprocessing into a pool of the given
+    // capacity, over network, which must connect the same parties as
+    // the network of the circuit through other channels. To be called
+    // after GenCorrelator, SetThreshold, SetFIPrepConfig and, if used,
+    // the PRSS setup, by all the parties at the same point. The pool
+    // works on a fork of the correlator with PRSS streams of its own,
+    // so the correlator of the circuit can still run the F.I.
+    // preprocessing without repeating the sharings of the pool
+    void StartPrepPool(std::shared_ptr<scl::Network> network, std::size_t capacity);
+
+    // Runs the F.D. preprocessing for a new evaluation on the oldest
+    // F.I. preprocessing of the pool, waiting for one if needed. The
+    // online phase can then run again, with new inputs
+    void PrepFromPool();
+
+    // See PrepPool::Stop
+    void StopPrepPool() { if ( mPrepPool ) mPrepPool->Stop(); }
+
+    std::size_t PrepPoolSize() { return mPrepPool ? mPrepPool->Size() : 0; }
+
     // ONLINE PROTOCOL
 
     // Set inputs
@@ -283,8 +345,58 @@ namespace tp {
       mCorrelator.PrecomputeVandermonde();
     }
 
+    void SetFIPrepConfig(FIPrepConfig config) { mCorrelator.SetFIPrepConfig(config); }
+
+    // Number of threads P1 uses to reconstruct and reshare the
+    // batches of a layer, both online and in the preprocessing. The
+    // network is still used from the calling threads only. Defaults
+    // to 1, i.e., no extra threads
+    void SetThreads(std::size_t n_threads) {
+      mPool = std::make_shared<ThreadPool>(n_threads);
+      mCorrelator.SetThreadPool(mPool);
+    }
+
+    // Which party reconstructs and reshares each batch, see
+    // KingPolicy. With kRotating, the online phase also changes: the
+    // owners send their masked inputs, and the kings the mu's they
+    // reconstruct, to every party, which then computes its own
+    // sharings of the mu's. This spreads the work and traffic of P1
+    // over all parties, but the online traffic in total grows by a
+    // factor (k+1)/3. MultP1Sends(l) then receives the mu's of layer
+    // l-1, and OutputP1SendsMu those of the last layer
+    void SetKingPolicy(KingPolicy policy) {
+      mKingPolicy = policy;
+      mCorrelator.SetKingPolicy(policy);
+    }
+
+    void PRSSSetupSend() { mCorrelator.PRSSSetupSend(); }
+    void PRSSSetupRecv() { mCorrelator.PRSSSetupRecv(); }
+
+    // For testing purposes, see Correlator::_FixedPRSSSeeds
+    void _FixedPRSSSeeds() { mCorrelator._FixedPRSSSeeds(); }
+
 
   private:
+    // Lowers the batches and layers into mFlat. Called by CloseOutputs
+    void Finalize();
+
+    // P1 computes the mu of the linear gates up to the given level
+    void P1EvaluateLinear(std::size_t level);
+
+    // With kRotating, every party receives the mu's that the other
+    // kings reconstructed in the given layer
+    void ReceiveMusFromKings(std::size_t layer);
+
+    template <typename G>
+    std::shared_ptr<G> Synced(std::shared_ptr<G> gate) {
+      if ( mIsClosed ) {
+	gate->mMu = mFlat.mMu[gate->mWire];
+	gate->mLearned = mFlat.mLearned[gate->mWire];
+	if constexpr ( std::is_same_v<G, OutputGate> ) gate->mValue = mFlat.mValue[gate->mWire];
+      }
+      return gate;
+    }
+
     std::size_t mBatchSize;
 
     // List of layers. Each layer is itself a list of batches, which
@@ -304,9 +416,16 @@ namespace tp {
     std::vector<std::shared_ptr<OutputGate>> mOutputGates;
     std::vector<std::shared_ptr<AddGate>> mAddGates;
 
+    // Index-based version of the circuit above, which holds the
+    // values of the online phase
+    FlatCircuit mFlat;
+
     // Correlator (for FIPrep)
     Correlator mCorrelator;
 
+    // Background F.I. preprocessing, if started
+    std::shared_ptr<PrepPool> mPrepPool;
+
     // Metrics
     std::size_t mClients; // number of clients
     std::size_t mWidth=0;
@@ -316,6 +435,11 @@ namespace tp {
     std::shared_ptr<scl::Network> mNetwork;
     std::size_t mID;
     std::size_t mParties;
+    scl::PRG mPRG;
+
+    // Threads for the local work of P1
+    std::shared_ptr<ThreadPool> mPool = std::make_shared<ThreadPool>(1);
+    KingPolicy mKingPolicy = KingPolicy::kParty0;
 
     // Flags
     bool mIsClosed;
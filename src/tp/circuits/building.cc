@@ -29,6 +29,7 @@ namespace tp {
 
   std::shared_ptr<InputGate> Circuit::Input(std::size_t owner_id) {
     auto input_gate = std::make_shared<tp::InputGate>(owner_id);
+    input_gate->mWire = mFlat.AddGate(GateType::kInput, FlatCircuit::kPaddingWire, FlatCircuit::kPaddingWire);
     mInputLayers[owner_id].Append(input_gate);
     mFlatInputGates[owner_id].emplace_back(input_gate);
     mInputGates.emplace_back(input_gate);
@@ -37,6 +38,7 @@ namespace tp {
 
   std::shared_ptr<OutputGate> Circuit::Output(std::size_t owner_id, std::shared_ptr<Gate> output) {
     auto output_gate = std::make_shared<tp::OutputGate>(owner_id, output);
+    output_gate->mWire = mFlat.AddGate(GateType::kOutput, output->GetWire(), FlatCircuit::kPaddingWire);
     mOutputLayers[owner_id].Append(output_gate);
     mFlatOutputGates[owner_id].emplace_back(output_gate);
     mOutputGates.emplace_back(output_gate);
@@ -45,6 +47,7 @@ namespace tp {
 
   std::shared_ptr<MultGate> Circuit::Mult(std::shared_ptr<Gate> left, std::shared_ptr<Gate> right) {
     auto mult_gate = std::make_shared<tp::MultGate>(left, right);
+    mult_gate->mWire = mFlat.AddGate(GateType::kMult, left->GetWire(), right->GetWire());
     mMultLayers.back().Append(mult_gate);
     mFlatMultLayers.back().emplace_back(mult_gate);
     mSize++;
@@ -71,4 +74,44 @@ namespace tp {
     mMultLayers.back().Close();
   }
 
+  void Circuit::Finalize() {
+    if ( mIsClosed )
+      throw std::invalid_argument("The circuit is already closed");
+
+    mFlat.mBatchSize = mBatchSize;
+    mFlat.AssignLayers();
+
+    // Rebuild the layers of the builder from the assignment, so that
+    // GetMultGate, the metrics and DN07 see the same layers
+    vec<std::shared_ptr<MultGate>> mult_gates(mFlat.NWires());
+    for (auto& layer : mFlatMultLayers) {
+      for (auto& mult_gate : layer) mult_gates[mult_gate->GetWire()] = mult_gate;
+    }
+    mFlatMultLayers.clear();
+    mMultLayers.clear();
+    mWidth = 0;
+    for (std::size_t layer = 0; layer < mFlat.NLayers(); layer++) {
+      mFlatMultLayers.emplace_back(VecMultGates());
+      mMultLayers.emplace_back(MultLayer(mBatchSize));
+      for (std::size_t i = mFlat.mLayerBegin[layer]*mBatchSize; i < mFlat.mLayerBegin[layer+1]*mBatchSize; i++) {
+	auto w = mFlat.mMultGates[i];
+	if ( w == FlatCircuit::kPaddingWire ) continue;
+	mFlatMultLayers.back().emplace_back(mult_gates[w]);
+	mMultLayers.back().Append(mult_gates[w]);
+      }
+      mMultLayers.back().Close();
+      if (mWidth < mFlatMultLayers.back().size()) mWidth = mFlatMultLayers.back().size();
+    }
+
+    for (std::size_t i = 0; i < mClients; i++) {
+      for (auto& input_gate : mFlatInputGates[i]) mFlat.mInputGates.emplace_back(input_gate->GetWire());
+      mFlat.mInputBegin.emplace_back(mFlat.mInputGates.size());
+      for (auto& output_gate : mFlatOutputGates[i]) mFlat.mOutputGates.emplace_back(output_gate->GetWire());
+      mFlat.mOutputBegin.emplace_back(mFlat.mOutputGates.size());
+    }
+
+    mFlat.Finalize();
+    mIsClosed = true;
+  }
+
 } // namespace tp
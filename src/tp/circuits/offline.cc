@@ -1,117 +1,71 @@
+#include <algorithm>
+#include <future>
+#include <thread>
+
 #include "tp/circuits.h"
 
 namespace tp {
   void Circuit::_DummyPrep(FF lambda) {
-    for (auto input_gate : mInputGates) {
-      input_gate->SetLambda(lambda);
-    }
-    for (std::size_t layer = 0; layer < GetDepth(); layer++) {
-      for (auto mult_gate : mFlatMultLayers[layer]) {
-	mult_gate->SetDummyLambda(lambda);
-      }
-    }
-    for (auto output_gate : mOutputGates) {
-      output_gate->GetDummyLambda(); //populate outputs and add wires
-    }
-
-    // Now update packed sharings
-    for (auto input_layer : mInputLayers) {
-      for (auto input_batch : input_layer.mBatches) {
-	Vec lambda_A;
-	lambda_A.Reserve(mBatchSize);
-	for (std::size_t i = 0; i < mBatchSize; i++) {
-	  lambda_A.Emplace(input_batch->GetInputGate(i)->GetDummyLambda());
-	}
-	scl::PRG prg;
-	auto poly = scl::details::EvPolyFromSecretsAndDegree(lambda_A, mBatchSize-1, prg);
-	Vec new_shares = scl::details::SharesFromEvPoly(poly, mParties);
-
-	input_batch->SetPreprocessing(new_shares[mID]);
-      }
-    }
-    for (auto output_layer : mOutputLayers) {
-      for (auto output_batch : output_layer.mBatches) {
-	Vec lambda_A;
-	lambda_A.Reserve(mBatchSize);
-	for (std::size_t i = 0; i < mBatchSize; i++) {
-	  lambda_A.Emplace(output_batch->GetOutputGate(i)->GetDummyLambda());
-	}
-	scl::PRG prg;
-	auto poly = scl::details::EvPolyFromSecretsAndDegree(lambda_A, mBatchSize-1, prg);
-	Vec new_shares = scl::details::SharesFromEvPoly(poly, mParties);
-
-	output_batch->SetPreprocessing(new_shares[mID]);
-      }
-    }
-    // Mults
-    for (auto mult_layer : mMultLayers) {
-      for (auto mult_batch : mult_layer.mBatches) {
-	Vec lambda_A;
-	Vec lambda_B;
-	Vec lambda_C;
-	lambda_A.Reserve(mBatchSize);
-	lambda_B.Reserve(mBatchSize);
-	lambda_C.Reserve(mBatchSize);
-	for (std::size_t i = 0; i < mBatchSize; i++) {
-	  lambda_A.Emplace(mult_batch->GetMultGate(i)->GetLeft()->GetDummyLambda());
-	  lambda_B.Emplace(mult_batch->GetMultGate(i)->GetRight()->GetDummyLambda());
-	  lambda_C.Emplace(mult_batch->GetMultGate(i)->GetDummyLambda());
-	}
-	scl::PRG prg;
-	auto poly_A = scl::details::EvPolyFromSecretsAndDegree(lambda_A, mBatchSize-1, prg);
-	auto poly_B = scl::details::EvPolyFromSecretsAndDegree(lambda_B, mBatchSize-1, prg);
-	auto poly_C = scl::details::EvPolyFromSecretsAndDegree(lambda_C, mBatchSize-1, prg);
-	Vec new_shares_A = scl::details::SharesFromEvPoly(poly_A, mParties);
-	Vec new_shares_B = scl::details::SharesFromEvPoly(poly_B, mParties);
-	Vec new_shares_C = scl::details::SharesFromEvPoly(poly_C, mParties);
-
-	mult_batch->SetPreprocessing(new_shares_A[mID], new_shares_B[mID], \
-				     new_shares_A[mID] * new_shares_B[mID] - new_shares_C[mID]);
-      }
-    }
-      
-      
+    SetDummyLambdas(lambda);
+    PopulateDummyLambdas();
+    PrepFromDummyLambdas();
   }
 
     // Populates each batch with dummy preprocessing (all zeros)
   void Circuit::_DummyPrep() {
-      for (auto input_layer : mInputLayers) input_layer._DummyPrep();
-      for (auto mult_layer : mMultLayers) mult_layer._DummyPrep();
-      for (auto output_layer : mOutputLayers) output_layer._DummyPrep();
+      std::fill(mFlat.mLambda.begin(), mFlat.mLambda.end(), FF(0));
+      std::fill(mFlat.mShrLambdaA.begin(), mFlat.mShrLambdaA.end(), FF(0));
+      std::fill(mFlat.mShrLambdaB.begin(), mFlat.mShrLambdaB.end(), FF(0));
+      std::fill(mFlat.mShrDeltaC.begin(), mFlat.mShrDeltaC.end(), FF(0));
     }
 
     // Set all settable lambdas to a constant
     void Circuit::SetDummyLambdas(FF lambda) {
       // Output wires of multiplications
-      for (std::size_t layer = 0; layer < GetDepth(); layer++) {
-	for (auto mult_gate : mFlatMultLayers[layer]) {
-	  mult_gate->SetDummyLambda(lambda);
-	}
+      for (auto w : mFlat.mMultGates) {
+	if ( w != FlatCircuit::kPaddingWire ) mFlat.mLambda[w] = lambda;
       }
       // Output wires of input gates
-      for (auto input_gate : mInputGates) {
-	input_gate->SetLambda(lambda);
-      }
+      for (auto w : mFlat.mInputGates) mFlat.mLambda[w] = lambda;
     }
 
-    // Populates the lambdas of addition and output gates
+    // Populates the lambdas of addition and output gates. Wires are
+    // in topological order, so a single pass suffices
     void Circuit::PopulateDummyLambdas() {
-      // Addition gates
-      for (auto add_gate : mAddGates) {
-	(void)add_gate->GetDummyLambda();
+      for (std::size_t w = 1; w < mFlat.NWires(); w++) {
+	if ( mFlat.mType[w] == GateType::kAdd ) {
+	  mFlat.mLambda[w] = mFlat.mLambda[mFlat.mLeft[w]] + mFlat.mLambda[mFlat.mRight[w]];
+	} else if ( mFlat.mType[w] == GateType::kOutput ) {
+	  mFlat.mLambda[w] = mFlat.mLambda[mFlat.mLeft[w]];
+	}
       }
-      // Output gates
-      for (auto output_gate : mOutputGates) {
-	(void)output_gate->GetDummyLambda();
-      }      
     }
 
-    // Sets the lambdas for the output wires of addition and output
-    // gates based on the lambdas for multiplications and input gates
+    // Sets the packed sharings of every mult batch from the lambdas
+    // of its wires, sharing all the batches with one matrix product
     void Circuit::PrepFromDummyLambdas() {
-      for (auto input_layer : mInputLayers) input_layer.PrepFromDummyLambdas();
-      for (auto output_layer : mOutputLayers) output_layer.PrepFromDummyLambdas();
-      for (auto mult_layer : mMultLayers) mult_layer.PrepFromDummyLambdas();
+      std::size_t n_batches = mFlat.NMultBatches();
+      if ( n_batches == 0 ) return;
+
+      // Columns 3j, 3j+1 and 3j+2 hold lambda_A, lambda_B and
+      // lambda_C of batch j
+      scl::Mat<FF> lambdas(mBatchSize, 3*n_batches);
+      for (std::size_t j = 0; j < n_batches; j++) {
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = mFlat.mMultGates[j*mBatchSize + i];
+	  lambdas(i, 3*j) = mFlat.mLambda[mFlat.mLeft[w]];
+	  lambdas(i, 3*j+1) = mFlat.mLambda[mFlat.mRight[w]];
+	  lambdas(i, 3*j+2) = mFlat.mLambda[w];
+	}
+      }
+      // Using deg = BatchSize-1 ensures there's no randomness involved
+      auto shares = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1).ShareMany(lambdas, mPRG);
+
+      for (std::size_t j = 0; j < n_batches; j++) {
+	mFlat.mShrLambdaA[j] = shares(mID, 3*j);
+	mFlat.mShrLambdaB[j] = shares(mID, 3*j+1);
+	mFlat.mShrDeltaC[j] = shares(mID, 3*j) * shares(mID, 3*j+1) - shares(mID, 3*j+2);
+      }
     }
 
     void Circuit::GenCorrelator() {
@@ -119,101 +73,198 @@ namespace tp {
 	throw std::invalid_argument("Cannot set correlator without setting a network first");
       
       std::size_t n_ind_shares = GetNInputs() + GetSize();
-      std::size_t n_mult_batches = GetNMultBatches();
-      std::size_t n_inout_batches = GetNInputBatches() + GetNOutputBatches();
+      std::size_t n_mult_batches = mFlat.NMultBatches();
+      std::size_t n_inout_batches = mFlat.NInputBatches() + mFlat.NOutputBatches();
 
       mCorrelator = Correlator(n_ind_shares, n_mult_batches, n_inout_batches, mBatchSize);
       mCorrelator.SetNetwork(mNetwork, mID);
+      mCorrelator.SetThreadPool(mPool);
+      mCorrelator.SetKingPolicy(mKingPolicy);
       mCorrelator.PrecomputeEi();
     }
 
-    // Populates the mappings in the correlator so that the
-    // F.I. preprocessing is mapped to different gates/batches
+    // Populates the individual sharings of every wire in the
+    // correlator. The batches are already indexed like the circuit's
     void Circuit::MapCorrToCircuit() {
-      // Individual shares
-      for (auto input_gate : mInputGates) {
-	mCorrelator.PopulateIndvShrs(input_gate);
-      }
-      for (std::size_t layer = 0; layer < GetDepth(); layer++) {
-	for (auto mult_gate : mFlatMultLayers[layer]) {
-	  mCorrelator.PopulateIndvShrs(mult_gate);
-	}
-      }
-      for (auto add_gate : mAddGates) {
-	mCorrelator.PopulateIndvShrs(add_gate);
-      }
-      for (auto output_gate : mOutputGates) {
-	mCorrelator.PopulateIndvShrs(output_gate);
-      }
-
-      // Input batches
-      for (auto input_layer : mInputLayers) {
-	for (auto input_batch : input_layer.mBatches) {
-	  mCorrelator.PopulateInputBatches(input_batch);
-	}
-      }
-      // Output batches
-      for (auto output_layer : mOutputLayers) {
-	for (auto output_batch : output_layer.mBatches) {
-	  mCorrelator.PopulateOutputBatches(output_batch);
-	}
-      }
-      // Mult batches
-      for (auto mult_layer : mMultLayers) {
-	for (auto mult_batch : mult_layer.mBatches) {
-	  mCorrelator.PopulateMultBatches(mult_batch);
-	}
-      }
+      mCorrelator.PopulateIndvShrs(mFlat);
     }
 
     // Prep inputs & outputs
     void Circuit::PrepMultPartiesSendP1() {
-      for (auto mult_layer : mMultLayers) {
-	for (auto mult_batch : mult_layer.mBatches) {
-	  mCorrelator.PrepMultPartiesSendP1(mult_batch);
-	}
-      }
+      mCorrelator.PrepMultPartiesSendP1(mFlat);
     }
     void Circuit::PrepMultP1ReceivesAndSends() {
-      for (auto mult_layer : mMultLayers) {
-	for (auto mult_batch : mult_layer.mBatches) {
-	  (void) mult_batch;
-	  mCorrelator.PrepMultP1ReceivesAndSends();
-	}
-      }      
+      mCorrelator.PrepMultP1ReceivesAndSends();
     }
     void Circuit::PrepMultPartiesReceive() {
-      for (auto mult_layer : mMultLayers) {
-	for (auto mult_batch : mult_layer.mBatches) {
-	  mCorrelator.PrepMultPartiesReceive(mult_batch);
-	}
-      }
+      mCorrelator.PrepMultPartiesReceive(mFlat);
     }
 
     void Circuit::PrepIOPartiesSendOwner() {
-      for (auto input_layer : mInputLayers) {
-	for (auto input_batch : input_layer.mBatches) {
-	  mCorrelator.PrepInputPartiesSendOwner(input_batch);
-	}
-      }
-      for (auto output_layer : mOutputLayers) {
-	for (auto output_batch : output_layer.mBatches) {
-	  mCorrelator.PrepOutputPartiesSendOwner(output_batch);
-	}
-      }
+      mCorrelator.PrepIOPartiesSendOwner(mFlat);
     }
 
     void Circuit::PrepIOOwnerReceives() {
-      for (auto input_layer : mInputLayers) {
-	for (auto input_batch : input_layer.mBatches) {
-	  mCorrelator.PrepInputOwnerReceives(input_batch);
-	}
-      }
-      for (auto output_layer : mOutputLayers) {
-	for (auto output_batch : output_layer.mBatches) {
-	  mCorrelator.PrepOutputOwnerReceives(output_batch);
+      mCorrelator.PrepIOOwnerReceives(mFlat);
+    }
+
+    void Circuit::PipelinedPrep(std::size_t batches_per_chunk) {
+      if ( batches_per_chunk == 0 )
+	throw std::invalid_argument("A chunk must hold at least one batch");
+      std::size_t n_batches = mFlat.NMultBatches();
+      std::size_t n_chunks = std::max<std::size_t>(1, (n_batches + batches_per_chunk - 1) / batches_per_chunk);
+
+      // Chunk c holds the batches [first, end). The first one also
+      // holds the individual sharings of the inputs, and the last one
+      // the F.I. preprocessing of the input and output batches, which
+      // is used once all the wires have individual sharings
+      struct Chunk {
+	std::size_t first;
+	std::size_t n_mult_batches;
+	std::size_t n_ind_shares;
+	std::size_t n_inout_batches;
+      };
+      auto chunk = [&](std::size_t c) {
+	std::size_t first = c * batches_per_chunk;
+	std::size_t end = std::min(first + batches_per_chunk, n_batches);
+	std::size_t n_ind_shares = c == 0 ? mFlat.mInputGates.size() : 0;
+	for (std::size_t j = first*mBatchSize; j < end*mBatchSize; j++) {
+	  n_ind_shares += mFlat.mMultGates[j] != FlatCircuit::kPaddingWire;
 	}
+	std::size_t n_inout_batches = c + 1 == n_chunks ? mFlat.NInputBatches() + mFlat.NOutputBatches() : 0;
+	return Chunk{first, end - first, n_ind_shares, n_inout_batches};
+      };
+
+      // Every chunk draws its randomness from a fresh seed
+      auto messages = [&](std::size_t c) {
+	auto sizes = chunk(c);
+	unsigned char seed[scl::PRG::SeedSize()];
+	mPRG.Next(seed, sizeof(seed));
+	return std::async(std::launch::async, [this, sizes, prg = scl::PRG(seed)]() {
+	  return mCorrelator.ChunkFIPrepMessages(sizes.n_mult_batches, sizes.n_ind_shares,
+						 sizes.n_inout_batches, prg);
+	});
+      };
+
+      // F.I. preprocessing of chunk c. The messages are sent from
+      // another thread, as FIPrepSend and FIPrepRecv would be
+      auto fi_prep = [&](std::size_t c, vec<vec<FF>> buffers) {
+	auto sizes = chunk(c);
+	mCorrelator.SetChunk(sizes.first, sizes.n_mult_batches, sizes.n_ind_shares, sizes.n_inout_batches);
+	std::thread send([this, &buffers]() { SendToParties(mNetwork, buffers); });
+	mCorrelator.FIPrepRecv();
+	send.join();
+	mCorrelator.GenProdPartiesSendP1();
+	mCorrelator.GenProdP1ReceivesAndSends();
+	mCorrelator.GenProdPartiesReceive();
+	mCorrelator.PopulateChunkIndvShrs(mFlat);
+      };
+
+      fi_prep(0, messages(0).get());
+      for (std::size_t c = 0; c < n_chunks; c++) {
+	std::future<vec<vec<FF>>> next;
+	if ( c + 1 < n_chunks ) next = messages(c + 1);
+	PrepMultPartiesSendP1();
+	PrepMultP1ReceivesAndSends();
+	PrepMultPartiesReceive();
+	if ( next.valid() ) fi_prep(c + 1, next.get());
       }
+      PrepIOPartiesSendOwner();
+      PrepIOOwnerReceives();
+
+      // Back to the sizes of GenCorrelator, so that what preprocesses
+      // with the correlator later on covers the whole circuit
+      mCorrelator.SetChunk(0, n_batches, GetNInputs() + GetSize(),
+			   mFlat.NInputBatches() + mFlat.NOutputBatches());
     }
   
+    void Circuit::SavePrep(const std::string& path) {
+      if ( !mIsNetworkSet )
+	throw std::invalid_argument("Cannot save the preprocessing without setting a network first");
+      std::size_t n_owned(0);
+      for (auto owner : mFlat.mInputBatchOwner) n_owned += (owner == mID);
+      for (auto owner : mFlat.mOutputBatchOwner) n_owned += (owner == mID);
+
+      PrepHeader header;
+      header.mKind = static_cast<std::uint32_t>(PrepKind::kFunctionDependent);
+      header.mParties = mParties;
+      header.mThreshold = mCorrelator.GetThreshold();
+      header.mBatchSize = mBatchSize;
+      header.mID = mID;
+      header.mCircuitHash = mFlat.Hash();
+      header.mSectionSize[kShrLambdaA] = mFlat.NMultBatches();
+      header.mSectionSize[kShrLambdaB] = mFlat.NMultBatches();
+      header.mSectionSize[kShrDeltaC] = mFlat.NMultBatches();
+      header.mSectionSize[kOwnedLambdas] = n_owned * mBatchSize;
+
+      PrepWriter writer(path, header);
+      writer.Write(mFlat.mShrLambdaA);
+      writer.Write(mFlat.mShrLambdaB);
+      writer.Write(mFlat.mShrDeltaC);
+      vec<FF> lambdas(mBatchSize);
+      auto write_owned = [&](const vec<WireId>& batches, const vec<std::uint32_t>& owners) {
+	for (std::size_t b = 0; b < owners.size(); b++) {
+	  if ( owners[b] != mID ) continue;
+	  for (std::size_t i = 0; i < mBatchSize; i++) lambdas[i] = mFlat.mLambda[batches[b*mBatchSize + i]];
+	  writer.Write(lambdas);
+	}
+      };
+      write_owned(mFlat.mInputBatches, mFlat.mInputBatchOwner);
+      write_owned(mFlat.mOutputBatches, mFlat.mOutputBatchOwner);
+      writer.Close();
+    }
+
+    void Circuit::LoadPrep(const std::string& path) {
+      if ( !mIsNetworkSet )
+	throw std::invalid_argument("Cannot load the preprocessing without setting a network first");
+      PrepFile file(path, PrepKind::kFunctionDependent);
+      file.Check(mParties, mID, mBatchSize);
+      if ( file.Header().mCircuitHash != mFlat.Hash() )
+	throw std::invalid_argument(path + " holds the preprocessing of another circuit");
+
+      // The hash covers the batches and their owners, so the sizes
+      // match too
+      std::size_t n_batches = mFlat.NMultBatches();
+      mFlat.mShrLambdaA.assign(file.Section(kShrLambdaA), file.Section(kShrLambdaA) + n_batches);
+      mFlat.mShrLambdaB.assign(file.Section(kShrLambdaB), file.Section(kShrLambdaB) + n_batches);
+      mFlat.mShrDeltaC.assign(file.Section(kShrDeltaC), file.Section(kShrDeltaC) + n_batches);
+      const FF* lambdas = file.Section(kOwnedLambdas);
+      auto read_owned = [&](const vec<WireId>& batches, const vec<std::uint32_t>& owners) {
+	for (std::size_t b = 0; b < owners.size(); b++) {
+	  if ( owners[b] != mID ) continue;
+	  for (std::size_t i = 0; i < mBatchSize; i++, lambdas++) {
+	    auto w = batches[b*mBatchSize + i];
+	    if ( w != FlatCircuit::kPaddingWire ) mFlat.mLambda[w] = *lambdas;
+	  }
+	}
+      };
+      read_owned(mFlat.mInputBatches, mFlat.mInputBatchOwner);
+      read_owned(mFlat.mOutputBatches, mFlat.mOutputBatchOwner);
+    }
+
+    void Circuit::StartPrepPool(std::shared_ptr<scl::Network> network, std::size_t capacity) {
+      if ( !mIsNetworkSet )
+	throw std::invalid_argument("Cannot start the pool without setting a network first");
+      unsigned char seed[scl::PRG::SeedSize()];
+      mPRG.Next(seed, sizeof(seed));
+      mPrepPool = std::make_shared<PrepPool>(mCorrelator, network, mID, capacity, scl::PRG(seed));
+    }
+
+    void Circuit::PrepFromPool() {
+      if ( !mPrepPool )
+	throw std::invalid_argument("Start the pool before preprocessing from it");
+      mCorrelator.SetFIPrep(mPrepPool->Take());
+      MapCorrToCircuit();
+      PrepMultPartiesSendP1();
+      PrepMultP1ReceivesAndSends();
+      PrepMultPartiesReceive();
+      PrepIOPartiesSendOwner();
+      PrepIOOwnerReceives();
+
+      // The mu's of the last evaluation are overwritten as the online
+      // phase goes, but the linear gates are only evaluated once
+      std::fill(mFlat.mLearned.begin(), mFlat.mLearned.end(), 0);
+      mFlat.mEvaluatedLevels = 0;
+    }
+
 } // namespace tp
@@ -7,34 +7,209 @@ namespace tp {
     // Set input and send to P1
     for (std::size_t i = 0; i < inputs.size(); i++) {
       mFlatInputGates[mID][i]->SetInput(inputs[i]);
+      mFlat.mValue[mFlat.mInputGates[mFlat.mInputBegin[mID] + i]] = inputs[i];
     }      
   }
 
   // Input protocol
+  // Each owner sends all its masked inputs to P1 in a single
+  // message, or to every party with kRotating
   void Circuit::InputOwnerSendsP1() {
-    for (std::size_t i = 0; i < mClients; i++) {
-      for (auto input_gate : mFlatInputGates[i]) {
-	input_gate->OwnerSendsP1();
-      }
+    if ( mID >= mClients ) return;
+    vec<FF> buffer;
+    buffer.reserve(mFlat.mInputBegin[mID+1] - mFlat.mInputBegin[mID]);
+    for (std::size_t i = mFlat.mInputBegin[mID]; i < mFlat.mInputBegin[mID+1]; i++) {
+      auto w = mFlat.mInputGates[i];
+      buffer.emplace_back(mFlat.mValue[w] - mFlat.mLambda[w]);
+    }
+    if ( buffer.empty() ) return;
+    if ( mKingPolicy == KingPolicy::kRotating ) {
+      SendToParties(mNetwork, vec<vec<FF>>(mParties, buffer));
+    } else {
+      mNetwork->Party(0)->Send(buffer);
     }
   }
   void Circuit::InputP1Receives() {
-    for (std::size_t i = 0; i < mClients; i++) { // outer loop can be removed if needed for opt.
-      for (auto input_gate : mFlatInputGates[i]) {
-	input_gate->P1Receives();
-      }
+    if ( mID != 0 && mKingPolicy == KingPolicy::kParty0 ) return;
+    vec<vec<FF>> buffers(mClients);
+    scl::Round round(*mNetwork);
+    for (std::size_t i = 0; i < mClients; i++) {
+      buffers[i].resize(mFlat.mInputBegin[i+1] - mFlat.mInputBegin[i]);
+      if ( buffers[i].empty() ) continue;
+      round.Recv(i, buffers[i], [this, &buffers](std::size_t i) {
+	for (std::size_t j = 0; j < buffers[i].size(); j++) {
+	  auto w = mFlat.mInputGates[mFlat.mInputBegin[i] + j];
+	  mFlat.mMu[w] = buffers[i][j];
+	  mFlat.mLearned[w] = 1;
+	}
+      });
     }
+    round.Run();
   }
   void Circuit::RunInput() {
     InputOwnerSendsP1();
     InputP1Receives();
   }
 
-  // Multiplications in the i-th layer
-  void Circuit::MultP1Sends(std::size_t layer) { mMultLayers[layer].P1Sends(); }
-  void Circuit::MultPartiesReceive(std::size_t layer) { mMultLayers[layer].PartiesReceive(); }
-  void Circuit::MultPartiesSend(std::size_t layer) { mMultLayers[layer].PartiesSend(); }
-  void Circuit::MultP1Receives(std::size_t layer) { mMultLayers[layer].P1Receives(); }
+  // The linear gates of level l only depend on mult layers < l, so
+  // P1 (every party, with kRotating) evaluates them right before they
+  // are needed
+  void Circuit::P1EvaluateLinear(std::size_t level) {
+    for (; mFlat.mEvaluatedLevels <= level; mFlat.mEvaluatedLevels++) {
+      auto l = mFlat.mEvaluatedLevels;
+      for (std::size_t i = mFlat.mLinearBegin[l]; i < mFlat.mLinearBegin[l+1]; i++) {
+	auto w = mFlat.mLinearGates[i];
+	if ( mFlat.mType[w] == GateType::kAdd ) {
+	  mFlat.mMu[w] = mFlat.mMu[mFlat.mLeft[w]] + mFlat.mMu[mFlat.mRight[w]];
+	} else {
+	  mFlat.mMu[w] = mFlat.mMu[mFlat.mLeft[w]];
+	}
+	mFlat.mLearned[w] = 1;
+      }
+    }
+  }
+
+  // Multiplications in the i-th layer. All the batches of the layer
+  // are shared and reconstructed with one matrix product per range of
+  // batches, the ranges being split across the threads of P1, and
+  // every party sends a single message per peer
+  void Circuit::MultP1Sends(std::size_t layer) {
+    if ( mKingPolicy == KingPolicy::kRotating ) {
+      if ( layer > 0 ) ReceiveMusFromKings(layer-1);
+      return;
+    }
+    if ( mID != 0 ) return;
+    P1EvaluateLinear(layer);
+
+    std::size_t first = mFlat.mLayerBegin[layer];
+    std::size_t n_batches = mFlat.mLayerBegin[layer+1] - first;
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1);
+    vec<vec<FF>> buffers(mParties, vec<FF>(2*n_batches));
+
+    // Degree k-1 sharings of k secrets draw no randomness, so the
+    // ranges can share mPRG
+    mPool->ParallelFor(n_batches, [&](std::size_t begin, std::size_t end) {
+      // Column 2j (2j+1) holds mu_A (mu_B) of batch begin+j
+      scl::Mat<FF> mus(mBatchSize, 2*(end - begin));
+      for (std::size_t j = 0; j < end - begin; j++) {
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = mFlat.mMultGates[(first + begin + j)*mBatchSize + i];
+	  mus(i, 2*j) = mFlat.mMu[mFlat.mLeft[w]];
+	  mus(i, 2*j+1) = mFlat.mMu[mFlat.mRight[w]];
+	}
+      }
+      auto shares = plan.ShareMany(mus, mPRG);
+      for (std::size_t i = 0; i < mParties; i++) {
+	for (std::size_t j = 0; j < shares.Cols(); j++) buffers[i][2*begin + j] = shares(i, j);
+      }
+    }, kMinBatchesPerThread);
+
+    SendToParties(mNetwork, buffers);
+  }
+  void Circuit::MultPartiesReceive(std::size_t layer) {
+    std::size_t first = mFlat.mLayerBegin[layer];
+    std::size_t n_batches = mFlat.mLayerBegin[layer+1] - first;
+
+    // With kRotating every party knows the mu's, and its share of a
+    // degree k-1 sharing is row mID of the sharing matrix times them
+    if ( mKingPolicy == KingPolicy::kRotating ) {
+      P1EvaluateLinear(layer);
+      auto& share_matrix = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1).ShareMatrix();
+      for (std::size_t j = 0; j < n_batches; j++) {
+	FF shr_a(0), shr_b(0);
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = mFlat.mMultGates[(first + j)*mBatchSize + i];
+	  shr_a += share_matrix(mID, i) * mFlat.mMu[mFlat.mLeft[w]];
+	  shr_b += share_matrix(mID, i) * mFlat.mMu[mFlat.mRight[w]];
+	}
+	mFlat.mShrMuA[first + j] = shr_a;
+	mFlat.mShrMuB[first + j] = shr_b;
+      }
+      return;
+    }
+
+    vec<FF> buffer(2*n_batches);
+    mNetwork->Party(0)->Recv(buffer);
+    for (std::size_t j = 0; j < n_batches; j++) {
+      mFlat.mShrMuA[first + j] = buffer[2*j];
+      mFlat.mShrMuB[first + j] = buffer[2*j+1];
+    }
+  }
+  // Each party sends each king the shares of the batches of that king
+  void Circuit::MultPartiesSend(std::size_t layer) {
+    auto kings = BatchesPerKing(mKingPolicy, mFlat.mLayerBegin[layer], mFlat.mLayerBegin[layer+1], mParties);
+    vec<vec<FF>> buffers(mParties);
+    for (std::size_t king = 0; king < mParties; king++) {
+      buffers[king].reserve(kings[king].size());
+      for (auto b : kings[king]) {
+	buffers[king].emplace_back(mFlat.mShrMuB[b] * mFlat.mShrLambdaA[b] + mFlat.mShrMuA[b] * mFlat.mShrLambdaB[b] + \
+				   mFlat.mShrMuA[b] * mFlat.mShrMuB[b] + mFlat.mShrDeltaC[b]);
+      }
+    }
+    SendToParties(mNetwork, buffers);
+  }
+  void Circuit::MultP1Receives(std::size_t layer) {
+    auto batches = BatchesPerKing(mKingPolicy, mFlat.mLayerBegin[layer], mFlat.mLayerBegin[layer+1], mParties)[mID];
+    std::size_t n_batches = batches.size();
+    if ( n_batches == 0 ) return;
+
+    // The messages are received on this thread, and only then is
+    // the reconstruction split across the threads of the king
+    auto recv = RecvFromParties(mNetwork, n_batches);
+
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, mParties-1);
+    mPool->ParallelFor(n_batches, [&](std::size_t begin, std::size_t end) {
+      scl::Mat<FF> shares(mParties, end - begin);
+      for (std::size_t i = 0; i < mParties; i++) {
+	for (std::size_t j = begin; j < end; j++) shares(i, j - begin) = recv[i][j];
+      }
+      auto mus = plan.ReconstructMany(shares);
+      for (std::size_t j = begin; j < end; j++) {
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = mFlat.mMultGates[batches[j]*mBatchSize + i];
+	  if ( w == FlatCircuit::kPaddingWire ) continue;
+	  mFlat.mMu[w] = mus(i, j - begin);
+	  mFlat.mLearned[w] = 1;
+	}
+      }
+    }, kMinBatchesPerThread);
+
+    // With kRotating the other parties need the mu's too. The
+    // padding positions are sent as well, so that a message holds k
+    // values per batch
+    if ( mKingPolicy == KingPolicy::kRotating ) {
+      vec<FF> buffer;
+      buffer.reserve(mBatchSize*n_batches);
+      for (auto b : batches) {
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = mFlat.mMultGates[b*mBatchSize + i];
+	  buffer.emplace_back(w == FlatCircuit::kPaddingWire ? FF(0) : mFlat.mMu[w]);
+	}
+      }
+      vec<vec<FF>> buffers(mParties, buffer);
+      buffers[mID].clear();
+      SendToParties(mNetwork, buffers);
+    }
+  }
+
+  void Circuit::ReceiveMusFromKings(std::size_t layer) {
+    auto kings = BatchesPerKing(mKingPolicy, mFlat.mLayerBegin[layer], mFlat.mLayerBegin[layer+1], mParties);
+    vec<std::size_t> n_elements(mParties);
+    for (std::size_t king = 0; king < mParties; king++) {
+      if ( king != mID ) n_elements[king] = mBatchSize*kings[king].size();
+    }
+    auto recv = RecvFromParties(mNetwork, n_elements);
+    for (std::size_t king = 0; king < mParties; king++) {
+      for (std::size_t j = 0; j < n_elements[king] / mBatchSize; j++) {
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = mFlat.mMultGates[kings[king][j]*mBatchSize + i];
+	  if ( w == FlatCircuit::kPaddingWire ) continue;
+	  mFlat.mMu[w] = recv[king][j*mBatchSize + i];
+	  mFlat.mLearned[w] = 1;
+	}
+      }
+    }
+  }
 
   void Circuit::RunMult(std::size_t layer) {
     MultP1Sends(layer);
@@ -44,18 +219,39 @@ namespace tp {
   }
 
   // Output layers
+  // P1 sends to each owner the mu of all its outputs in a single
+  // message. With kRotating the owners know them already
   void Circuit::OutputP1SendsMu() {
+    if ( mKingPolicy == KingPolicy::kRotating ) {
+      if ( mFlat.NLayers() > 0 ) ReceiveMusFromKings(mFlat.NLayers()-1);
+      P1EvaluateLinear(mFlat.NLayers());
+      return;
+    }
+    if ( mID != 0 ) return;
+    P1EvaluateLinear(mFlat.NLayers());
+    vec<vec<FF>> buffers(mParties);
     for (std::size_t i = 0; i < mClients; i++) {
-      for (auto output_gate : mFlatOutputGates[i]) {
-	output_gate->P1SendsMu();
+      buffers[i].reserve(mFlat.mOutputBegin[i+1] - mFlat.mOutputBegin[i]);
+      for (std::size_t j = mFlat.mOutputBegin[i]; j < mFlat.mOutputBegin[i+1]; j++) {
+	buffers[i].emplace_back(mFlat.mMu[mFlat.mOutputGates[j]]);
       }
     }
+    SendToParties(mNetwork, buffers);
   }
   void Circuit::OutputOwnerReceivesMu() {
-    for (std::size_t i = 0; i < mClients; i++) { // outer loop can be removed if needed for opt.
-      for (auto output_gate : mFlatOutputGates[i]) {
-	output_gate->OwnerReceivesMu();
+    if ( mID >= mClients ) return;
+    vec<FF> buffer(mFlat.mOutputBegin[mID+1] - mFlat.mOutputBegin[mID]);
+    if ( buffer.empty() ) return;
+    if ( mKingPolicy == KingPolicy::kRotating ) {
+      for (std::size_t j = 0; j < buffer.size(); j++) {
+	buffer[j] = mFlat.mMu[mFlat.mOutputGates[mFlat.mOutputBegin[mID] + j]];
       }
+    } else {
+      mNetwork->Party(0)->Recv(buffer);
+    }
+    for (std::size_t j = 0; j < buffer.size(); j++) {
+      auto w = mFlat.mOutputGates[mFlat.mOutputBegin[mID] + j];
+      mFlat.mValue[w] = mFlat.mLambda[w] + buffer[j];
     }
   }
   void Circuit::RunOutput() {
@@ -74,9 +270,10 @@ namespace tp {
   // Returns a vector with the outputs after computation
   std::vector<FF> Circuit::GetOutputs() {
     std::vector<FF> output;
-    output.reserve(mFlatOutputGates[mID].size());
-    for (auto output_gate : mFlatOutputGates[mID]) {
-      output.emplace_back(output_gate->GetValue());
+    if ( mID >= mClients ) return output;
+    output.reserve(mFlat.mOutputBegin[mID+1] - mFlat.mOutputBegin[mID]);
+    for (std::size_t j = mFlat.mOutputBegin[mID]; j < mFlat.mOutputBegin[mID+1]; j++) {
+      output.emplace_back(mFlat.mValue[mFlat.mOutputGates[j]]);
     }
     return output;
   }
@@ -1,165 +1,238 @@
+#include <algorithm>
+
 #include "tp/correlator.h"
 
 namespace tp {
-  
 
 
-  // PREP INPUT BATCH
-  void Correlator::PrepInputPartiesSendOwner(std::shared_ptr<InputBatch> input_batch) {
-    // 1 collect [lambda_alpha]_n-1
-    FF shr_lambdaA_p_R(0);
-    for (std::size_t i = 0; i < mBatchSize; i++) {
-      shr_lambdaA_p_R += mSharesOfEi[i] * mMapIndShrs[input_batch->GetInputGate(i)];
-    }
 
-    // 2 add share of 0
-    shr_lambdaA_p_R += mMapInputBatch[input_batch].mShrO;
+  void Correlator::PopulateIndvShrs(const FlatCircuit& flat) {
+    // Wires are in topological order, so the inputs of a gate are
+    // handled before the gate. The padding wire keeps a 0 share
+    mWireIndShrs.assign(flat.NWires(), FF(0));
+    std::size_t ctr(0);
+    for (std::size_t w = 1; w < flat.NWires(); w++) {
+      switch ( flat.mType[w] ) {
+      case GateType::kInput:
+      case GateType::kMult:
+	mWireIndShrs[w] = mIndShrs[ctr++];
+	break;
+      case GateType::kAdd:
+	mWireIndShrs[w] = mWireIndShrs[flat.mLeft[w]] + mWireIndShrs[flat.mRight[w]];
+	break;
+      case GateType::kOutput:
+	mWireIndShrs[w] = mWireIndShrs[flat.mLeft[w]];
+	break;
+      default:
+	break;
+      }
+    }
+  }
 
-    // 3 send to Owner
-    mNetwork->Party(input_batch->GetOwner())->Send(shr_lambdaA_p_R);
+  void Correlator::SetChunk(std::size_t first_batch, std::size_t n_mult_batches,
+			    std::size_t n_ind_shares, std::size_t n_inout_batches) {
+    mFirstBatch = first_batch;
+    mNMultBatches = n_mult_batches;
+    mNIndShrs = n_ind_shares;
+    mNInOutBatches = n_inout_batches;
+
+    // Assigning fresh vectors releases the memory of the last chunk
+    mIndShrs = vec<FF>();
+    mMultBatchFIPrep = vec<MultBatchFIPrep>();
+    mIOBatchFIPrep = vec<IOBatchFIPrep>();
+    mUnpackedShrsA = vec<vec<FF>>();
+    mUnpackedShrsB = vec<vec<FF>>();
+    mUnpackedShrsMask = vec<vec<FF>>();
+    mZeroProdShrs = vec<vec<FF>>();
   }
-    
-  void Correlator::PrepInputOwnerReceives(std::shared_ptr<InputBatch> input_batch) {
-    if (mID == input_batch->GetOwner()) {
-      Vec recv_shares;
-      Vec recv_secret;
-      recv_shares.Reserve(mParties);
-      recv_secret.Reserve(mBatchSize);
-
-      // Owner receives
-      for (std::size_t i = 0; i < mParties; i++) {
-	FF buffer;
-	mNetwork->Party(i)->Recv(buffer);
-	recv_shares.Emplace(buffer);
-      }
-      recv_secret = scl::details::SecretsFromSharesAndLength(recv_shares, mBatchSize);
 
-      // Assign lambdas
-      for (std::size_t i = 0; i < mBatchSize; i++) {
-	auto input_gate = input_batch->GetInputGate(i);
-	input_gate->SetLambda(recv_secret[i]);
+  void Correlator::PopulateChunkIndvShrs(const FlatCircuit& flat) {
+    std::size_t ctr(0);
+    if ( mFirstBatch == 0 ) {
+      mWireIndShrs.assign(flat.NWires(), FF(0));
+      mIndShrsLevels = 0;
+      for (auto w : flat.mInputGates) mWireIndShrs[w] = mIndShrs[ctr++];
+    }
+    std::size_t end = mFirstBatch + mNMultBatches;
+    for (std::size_t j = mFirstBatch*mBatchSize; j < end*mBatchSize; j++) {
+      auto w = flat.mMultGates[j];
+      if ( w != FlatCircuit::kPaddingWire ) mWireIndShrs[w] = mIndShrs[ctr++];
+    }
+    assert(ctr <= mIndShrs.size());
+
+    // The linear gates of level l only depend on mult layers < l. So
+    // all the levels up to the layer of the last batch are known,
+    // and the mult batches of the next chunk need no more than those
+    std::size_t level = flat.NLayers();
+    if ( end < flat.NMultBatches() ) {
+      level = std::upper_bound(flat.mLayerBegin.begin(), flat.mLayerBegin.end(), end - 1) \
+	- flat.mLayerBegin.begin() - 1;
+    }
+    for (; mIndShrsLevels <= level; mIndShrsLevels++) {
+      auto l = mIndShrsLevels;
+      for (std::size_t i = flat.mLinearBegin[l]; i < flat.mLinearBegin[l+1]; i++) {
+	auto w = flat.mLinearGates[i];
+	if ( flat.mType[w] == GateType::kAdd ) {
+	  mWireIndShrs[w] = mWireIndShrs[flat.mLeft[w]] + mWireIndShrs[flat.mRight[w]];
+	} else {
+	  mWireIndShrs[w] = mWireIndShrs[flat.mLeft[w]];
+	}
       }
     }
   }
 
-
-  // PREP OUTPUT BATCH
-  void Correlator::PrepOutputPartiesSendOwner(std::shared_ptr<OutputBatch> output_batch) {
+  // PREP INPUT & OUTPUT BATCHES
+  FF Correlator::PrepIOShare(const WireId* gates, const IOBatchFIPrep& prep) {
     // 1 collect [lambda_alpha]_n-1
     FF shr_lambdaA_p_R(0);
     for (std::size_t i = 0; i < mBatchSize; i++) {
-      shr_lambdaA_p_R += mSharesOfEi[i] * mMapIndShrs[output_batch->GetOutputGate(i)];
+      shr_lambdaA_p_R += mSharesOfEi[i] * mWireIndShrs[gates[i]];
     }
 
     // 2 add share of 0
-    shr_lambdaA_p_R += mMapOutputBatch[output_batch].mShrO;
+    shr_lambdaA_p_R += prep.mShrO;
+    return shr_lambdaA_p_R;
+  }
 
-    // 3 send to P1
-    mNetwork->Party(output_batch->GetOwner())->Send(shr_lambdaA_p_R);
+  void Correlator::PrepIOPartiesSendOwner(const FlatCircuit& flat) {
+    // 3 send to Owner. All the batches of an owner go in one message
+    vec<vec<FF>> buffers(mParties);
+    std::size_t n_input_batches = flat.NInputBatches();
+    for (std::size_t b = 0; b < n_input_batches; b++) {
+      buffers[flat.mInputBatchOwner[b]].emplace_back(PrepIOShare(&flat.mInputBatches[b*mBatchSize],
+								 mIOBatchFIPrep[b]));
+    }
+    for (std::size_t b = 0; b < flat.NOutputBatches(); b++) {
+      buffers[flat.mOutputBatchOwner[b]].emplace_back(PrepIOShare(&flat.mOutputBatches[b*mBatchSize],
+								  mIOBatchFIPrep[n_input_batches + b]));
+    }
+    SendToParties(mNetwork, buffers);
   }
-    
-  void Correlator::PrepOutputOwnerReceives(std::shared_ptr<OutputBatch> output_batch) {
-    if (mID == output_batch->GetOwner()) {
-      Vec recv_shares;
-      Vec recv_secret;
-      recv_shares.Reserve(mParties);
-      recv_secret.Reserve(mBatchSize);
-
-      // Owner receives
-      for (std::size_t i = 0; i < mParties; i++) {
-	FF buffer;
-	mNetwork->Party(i)->Recv(buffer);
-	recv_shares.Emplace(buffer);
-      }
-      // TODO watch out for degree
-      recv_secret = scl::details::SecretsFromSharesAndLength(recv_shares, mBatchSize);
 
-      // Assign lambdas
-      for (std::size_t i = 0; i < mBatchSize; i++) {
-	auto output_gate = output_batch->GetOutputGate(i);
-	output_gate->SetLambda(recv_secret[i]);
+  void Correlator::PrepIOOwnerReceives(FlatCircuit& flat) {
+    std::size_t n_owned(0);
+    for (auto owner : flat.mInputBatchOwner) n_owned += (owner == mID);
+    for (auto owner : flat.mOutputBatchOwner) n_owned += (owner == mID);
+    if ( n_owned == 0 ) return;
+
+    // Owner receives
+    auto recv = RecvFromParties(mNetwork, n_owned);
+    std::size_t idx(0);
+    // TODO watch out for degree
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, mParties-1);
+
+    // Assign lambdas, except to the padding wire
+    auto assign = [&](const vec<WireId>& batches, const vec<std::uint32_t>& owners) {
+      for (std::size_t b = 0; b < owners.size(); b++) {
+	if ( owners[b] != mID ) continue;
+	Vec recv_shares;
+	recv_shares.Reserve(mParties);
+	for (std::size_t i = 0; i < mParties; i++) recv_shares.Emplace(recv[i][idx]);
+	idx++;
+	auto recv_secret = plan.Reconstruct(recv_shares);
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = batches[b*mBatchSize + i];
+	  if ( w != FlatCircuit::kPaddingWire ) flat.mLambda[w] = recv_secret[i];
+	}
       }
-    }
+    };
+    assign(flat.mInputBatches, flat.mInputBatchOwner);
+    assign(flat.mOutputBatches, flat.mOutputBatchOwner);
   }
 
   // PREP MULT BATCH
-  void Correlator::PrepMultPartiesSendP1(std::shared_ptr<MultBatch> mult_batch) {
-    // 1 collect [lambda_alpha]_n-1
-    FF shr_lambdaA_p_R(0);
-    FF shr_lambdaB_p_R(0);
-    for (std::size_t i = 0; i < mBatchSize; i++) {
-      shr_lambdaA_p_R += mSharesOfEi[i] * mMapIndShrs[mult_batch->GetMultGate(i)->GetLeft()];
-      shr_lambdaB_p_R += mSharesOfEi[i] * mMapIndShrs[mult_batch->GetMultGate(i)->GetRight()];
+  // Every batch is reconstructed and reshared by its king, see
+  // KingPolicy. Each party sends each king one message with the
+  // batches of that king, and receives one back
+  void Correlator::PrepMultPartiesSendP1(const FlatCircuit& flat) {
+    auto kings = BatchesPerKing(mKingPolicy, mFirstBatch, mFirstBatch + mNMultBatches, mParties);
+    vec<vec<FF>> buffers(mParties);
+    for (std::size_t king = 0; king < mParties; king++) {
+      buffers[king].reserve(2*kings[king].size());
+      for (auto b : kings[king]) {
+	auto& prep = mMultBatchFIPrep[b - mFirstBatch];
+	// 1 collect [lambda_alpha]_n-1
+	FF shr_lambdaA_p_R(0);
+	FF shr_lambdaB_p_R(0);
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  auto w = flat.mMultGates[b*mBatchSize + i];
+	  shr_lambdaA_p_R += mSharesOfEi[i] * mWireIndShrs[flat.mLeft[w]];
+	  shr_lambdaB_p_R += mSharesOfEi[i] * mWireIndShrs[flat.mRight[w]];
+	}
+
+	// 2 get random sharing [r]_n-1 and add [lambda_alpha]_n-1 + [r]_n-1
+	shr_lambdaA_p_R += prep.mShrA + prep.mShrO1;
+	shr_lambdaB_p_R += prep.mShrB + prep.mShrO2;
+
+	buffers[king].emplace_back(shr_lambdaA_p_R);
+	buffers[king].emplace_back(shr_lambdaB_p_R);
+      }
     }
 
-    // 2 get random sharing [r]_n-1 and add [lambda_alpha]_n-1 + [r]_n-1
-    shr_lambdaA_p_R += mMapMultBatch[mult_batch].mShrA + mMapMultBatch[mult_batch].mShrO1;
-    shr_lambdaB_p_R += mMapMultBatch[mult_batch].mShrB + mMapMultBatch[mult_batch].mShrO2;
-
-    // 3 send to P1
-    mNetwork->Party(0)->Send(shr_lambdaA_p_R);
-    mNetwork->Party(0)->Send(shr_lambdaB_p_R);
+    // 3 send to the kings
+    SendToParties(mNetwork, buffers);
   }
-    
+
   void Correlator::PrepMultP1ReceivesAndSends() {
-    if (mID == 0) {
-      Vec recv_shares_A;
-      Vec recv_secret_A;
-      Vec recv_shares_B;
-      Vec recv_secret_B;
-      recv_shares_A.Reserve(mParties);
-      recv_secret_A.Reserve(mBatchSize);
-      recv_shares_B.Reserve(mParties);
-      recv_secret_B.Reserve(mBatchSize);
-
-      // P1 receives
+    std::size_t n_batches = BatchesPerKing(mKingPolicy, mFirstBatch, mFirstBatch + mNMultBatches,
+					   mParties)[mID].size();
+    if ( n_batches == 0 ) return;
+
+    // The king receives. Party i sends the sharings of lambda_A and
+    // lambda_B of every batch of the king, interleaved
+    auto recv = RecvFromParties(mNetwork, 2*n_batches);
+
+    // The king reconstructs and generates new shares, with one
+    // matrix product per range of batches. Row i of recv_shares is
+    // the message of party i, so every column is one sharing. Degree
+    // k-1 sharings of k secrets draw no randomness, so the ranges can
+    // share mPRG
+    auto& recon_plan = SharingPlan::Get(mParties, mBatchSize, mParties-1);
+    auto& share_plan = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1);
+    vec<vec<FF>> buffers(mParties, vec<FF>(2*n_batches));
+    mPool->ParallelFor(n_batches, [&](std::size_t begin, std::size_t end) {
+      scl::Mat<FF> recv_shares(mParties, 2*(end - begin));
       for (std::size_t i = 0; i < mParties; i++) {
-	FF buffer;
-	mNetwork->Party(i)->Recv(buffer);
-	recv_shares_A.Emplace(buffer);
-	mNetwork->Party(i)->Recv(buffer);
-	recv_shares_B.Emplace(buffer);
+	for (std::size_t j = 2*begin; j < 2*end; j++) recv_shares(i, j - 2*begin) = recv[i][j];
       }
-      recv_secret_A = scl::details::SecretsFromSharesAndLength(recv_shares_A, mBatchSize);
-      recv_secret_B = scl::details::SecretsFromSharesAndLength(recv_shares_B, mBatchSize);
-
-      // P1 generates new shares
-      auto poly_A = scl::details::EvPolyFromSecretsAndDegree(recv_secret_A, mBatchSize-1, mPRG);
-      auto poly_B = scl::details::EvPolyFromSecretsAndDegree(recv_secret_B, mBatchSize-1, mPRG);
-      Vec new_shares_A = scl::details::SharesFromEvPoly(poly_A, mParties);
-      Vec new_shares_B = scl::details::SharesFromEvPoly(poly_B, mParties);
-
-      // P1 sends
-      for (std::size_t i = 0; i < mParties; ++i) {
-	mNetwork->Party(i)->Send(new_shares_A[i]);
-	mNetwork->Party(i)->Send(new_shares_B[i]);
+      auto new_shares = share_plan.ShareMany(recon_plan.ReconstructMany(recv_shares), mPRG);
+      for (std::size_t i = 0; i < mParties; i++) {
+	for (std::size_t j = 2*begin; j < 2*end; j++) buffers[i][j] = new_shares(i, j - 2*begin);
       }
-    }
-  }
+    }, kMinBatchesPerThread);
 
-  void Correlator::PrepMultPartiesReceive(std::shared_ptr<MultBatch> mult_batch) {
-    // Receive
-    FF recv_share_A;
-    FF recv_share_B;
-    mNetwork->Party(0)->Recv(recv_share_A);
-    mNetwork->Party(0)->Recv(recv_share_B);
-
-    // Subtract shares of [r]_n-k
-    FF new_share_A = recv_share_A - mMapMultBatch[mult_batch].mShrA;
-    FF new_share_B = recv_share_B - mMapMultBatch[mult_batch].mShrB;
+    // The king sends
+    SendToParties(mNetwork, buffers);
+  }
 
-    // Set deltas
-    FF shr_delta(0);
-    for (std::size_t i = 0; i < mBatchSize; i++) {
-      shr_delta -= mSharesOfEi[i] * mMapIndShrs[mult_batch->GetMultGate(i)];
+  void Correlator::PrepMultPartiesReceive(FlatCircuit& flat) {
+    // Receive from every king
+    auto kings = BatchesPerKing(mKingPolicy, mFirstBatch, mFirstBatch + mNMultBatches, mParties);
+    vec<std::size_t> n_elements(mParties);
+    for (std::size_t king = 0; king < mParties; king++) n_elements[king] = 2*kings[king].size();
+    auto recv = RecvFromParties(mNetwork, n_elements);
+
+    for (std::size_t king = 0; king < mParties; king++) {
+      for (std::size_t j = 0; j < kings[king].size(); j++) {
+	auto b = kings[king][j];
+	auto& prep = mMultBatchFIPrep[b - mFirstBatch];
+	FF recv_share_A = recv[king][2*j];
+	FF recv_share_B = recv[king][2*j+1];
+
+	// Subtract shares of [r]_n-k
+	flat.mShrLambdaA[b] = recv_share_A - prep.mShrA;
+	flat.mShrLambdaB[b] = recv_share_B - prep.mShrB;
+
+	// Set deltas
+	FF shr_delta(0);
+	for (std::size_t i = 0; i < mBatchSize; i++) {
+	  shr_delta -= mSharesOfEi[i] * mWireIndShrs[flat.mMultGates[b*mBatchSize + i]];
+	}
+	shr_delta += recv_share_A * recv_share_B - recv_share_A * prep.mShrB \
+	  - recv_share_B * prep.mShrA + prep.mShrC + prep.mShrO3;
+	flat.mShrDeltaC[b] = shr_delta;
+      }
     }
-    shr_delta += recv_share_A * recv_share_B - recv_share_A * mMapMultBatch[mult_batch].mShrB \
-      - recv_share_B * mMapMultBatch[mult_batch].mShrA + mMapMultBatch[mult_batch].mShrC \
-      + mMapMultBatch[mult_batch].mShrO3;
-
-    // Set preprocessing
-    mult_batch->SetPreprocessing(new_share_A, new_share_B, shr_delta);
-
   }
 }
 
@@ -2,13 +2,13 @@
 #define CORRELATOR_H
 
 #include <iostream>
-#include <map>
 #include <assert.h>
 
 #include "tp.h"
-#include "mult_gate.h"
-#include "input_gate.h"
-#include "output_gate.h"
+#include "flat_circuit.h"
+#include "prep_store.h"
+#include "prss.h"
+#include "thread_pool.h"
 
 namespace tp {
   struct MultBatchFIPrep {
@@ -40,6 +40,9 @@ namespace tp {
     }
   };
 
+  static_assert(sizeof(MultBatchFIPrep) == 6 * sizeof(FF) && std::is_trivially_copyable_v<MultBatchFIPrep>,
+		"MultBatchFIPrep is stored as 6 raw field elements");
+
   struct IOBatchFIPrep {
     // Share of zero
     FF mShrO;
@@ -49,13 +52,35 @@ namespace tp {
     }
   };  
 
+  static_assert(sizeof(IOBatchFIPrep) == sizeof(FF) && std::is_trivially_copyable_v<IOBatchFIPrep>,
+		"IOBatchFIPrep is stored as a raw field element");
+
+  // The F.I. preprocessing of a whole circuit, as held by the
+  // correlator after the GenProd steps
+  struct FIPrep {
+    vec<FF> mIndShrs;
+    vec<MultBatchFIPrep> mMultBatchFIPrep;
+    vec<IOBatchFIPrep> mIOBatchFIPrep;
+  };
+
+  // How a type of F.I. correlation is generated: dealt by every
+  // party and extracted with the Vandermonde matrix, or computed
+  // locally from seeds agreed at setup (see prss.h)
+  enum class Generation { kDealt, kPRSS };
+
+  struct FIPrepConfig {
+    Generation unpacked_shr = Generation::kDealt;
+    Generation zero = Generation::kDealt;
+    Generation zero_for_prod = Generation::kDealt;
+  };
+
   class Correlator {
   public:
     Correlator() {};
 
     Correlator(std::size_t n_ind_shares, std::size_t n_mult_batches, std::size_t n_inout_batches, std::size_t batch_size) :
       mNIndShrs(n_ind_shares), mNMultBatches(n_mult_batches), mNInOutBatches(n_inout_batches), \
-      mCTRIndShrs(0), mCTRMultBatches(0), mCTRInOutBatches(0), mBatchSize(batch_size) {
+      mBatchSize(batch_size) {
 
       mIndShrs.reserve(mNIndShrs);
       mMultBatchFIPrep.reserve(mNMultBatches);
@@ -89,14 +114,41 @@ namespace tp {
       mParties = network->Size();
     }
 
+    // Threads for the local work of P1
+    void SetThreadPool(std::shared_ptr<ThreadPool> pool) { mPool = pool; }
+
+    // Which party reconstructs and reshares each batch in
+    // GenProd* and PrepMult*
+    void SetKingPolicy(KingPolicy policy) { mKingPolicy = policy; }
+
+    // t and k can be traded against each other, as long as the
+    // product of a degree-(k-1) and a degree-(t+k-1) sharing can
+    // still be reconstructed
     void SetThreshold(std::size_t threshold) {
-      if ( mParties != threshold + 2*(mBatchSize - 1) + 1 )
-	throw std::invalid_argument("It must hold that n = t + 2(k-1) + 1");
+      if ( mParties < threshold + 2*(mBatchSize - 1) + 1 )
+	throw std::invalid_argument("It must hold that n >= t + 2(k-1) + 1");
       if ( mParties <= 2*threshold )
 	throw std::invalid_argument("It must hold that t < n/2");
       mThreshold = threshold;
     }
 
+    std::size_t GetThreshold() const { return mThreshold; }
+
+    // Must be called after SetThreshold, and before the PRSS setup
+    void SetFIPrepConfig(FIPrepConfig config);
+    FIPrepConfig GetFIPrepConfig() const { return mFIPrepConfig; }
+
+    // Agree on the seeds needed by the correlations generated with
+    // PRSS. Done once, before the F.I. preprocessing. The seeds are
+    // sampled from the entropy of the OS
+    void PRSSSetupSend();
+    void PRSSSetupRecv();
+
+    // For testing purposes: samples the seeds of the PRSS setup from
+    // the fixed-seed PRG of the correlator instead, so that runs are
+    // reproducible. Every party can then compute every seed
+    void _FixedPRSSSeeds() { mFixedPRSSSeeds = true; }
+
     // GENERATE F.I. PREPROCESSING
 
     void GenIndShrsPartiesSend();
@@ -114,58 +166,100 @@ namespace tp {
     void GenZeroForProdPartiesSend();
     void GenZeroForProdPartiesReceive();
 
+    // All of the above in a single message per peer
+    void FIPrepSend();
+    void FIPrepRecv();
+
+    // The messages of FIPrepSend, outer index being the party
+    vec<vec<FF>> FIPrepMessages();
+
     // Execute the products
     void GenProdPartiesSendP1();
     void GenProdP1ReceivesAndSends();
     void GenProdPartiesReceive();
 
-    // Mapping gates to preprocessed data
-    void PopulateIndvShrs(std::shared_ptr<MultGate> gate) {
-      if ( !gate->IsPadding() ) mMapIndShrs[gate] = mIndShrs[mCTRIndShrs++];
-    }
-    void PopulateIndvShrs(std::shared_ptr<InputGate> gate) {
-      if ( !gate->IsPadding() ) mMapIndShrs[gate] = mIndShrs[mCTRIndShrs++];
-    }
-    void PopulateIndvShrs(std::shared_ptr<AddGate> gate) {
-      // This is done in topological order, so previous (left&right) gates are already handled
-      mMapIndShrs[gate] = mMapIndShrs[gate->GetLeft()] + mMapIndShrs[gate->GetRight()];
-    }
-    void PopulateIndvShrs(std::shared_ptr<OutputGate> gate) {
-      mMapIndShrs[gate] = mMapIndShrs[gate->GetLeft()];
-    }
-
-    void PopulateMultBatches(std::shared_ptr<MultBatch> mult_batch) {
-      mMapMultBatch[mult_batch] = mMultBatchFIPrep[mCTRMultBatches++];
-    }
+    // Mapping wires to preprocessed data. The individual sharings
+    // are assigned to the input and mult wires in wire order, and
+    // derived for the rest. Batches need no mapping: batch b of the
+    // circuit uses mMultBatchFIPrep[b], and the input (output) batches
+    // use mIOBatchFIPrep in that order, inputs first
+    void PopulateIndvShrs(const FlatCircuit& flat);
 
-    void PopulateInputBatches(std::shared_ptr<InputBatch> input_batch) {
-      mMapInputBatch[input_batch] = mIOBatchFIPrep[mCTRInOutBatches++];
-    }
-
-    void PopulateOutputBatches(std::shared_ptr<OutputBatch> output_batch) {
-      mMapOutputBatch[output_batch] = mIOBatchFIPrep[mCTRInOutBatches++];
-    }
-
-    // Generate FD Prep from FI Prep
-    
-    // PREP INPUT BATCH
-    void PrepInputPartiesSendOwner(std::shared_ptr<InputBatch> input_batch);
+    // Generate FD Prep from FI Prep. Each step handles all the
+    // batches at once, so that a party sends a single message per
+    // peer
     
-    void PrepInputOwnerReceives(std::shared_ptr<InputBatch> input_batch);
+    // PREP INPUT & OUTPUT BATCHES
+    void PrepIOPartiesSendOwner(const FlatCircuit& flat);
 
-
-    // PREP OUTPUT BATCH
-    void PrepOutputPartiesSendOwner(std::shared_ptr<OutputBatch> output_batch);
-    
-    void PrepOutputOwnerReceives(std::shared_ptr<OutputBatch> output_batch);
+    // The owner writes the lambdas of its wires to flat
+    void PrepIOOwnerReceives(FlatCircuit& flat);
 
     // PREP MULT BATCH
-    void PrepMultPartiesSendP1(std::shared_ptr<MultBatch> mult_batch);
+    void PrepMultPartiesSendP1(const FlatCircuit& flat);
     
     void PrepMultP1ReceivesAndSends();
 
-    void PrepMultPartiesReceive(std::shared_ptr<MultBatch> mult_batch);
-
+    // Writes the packed sharings of every mult batch to flat
+    void PrepMultPartiesReceive(FlatCircuit& flat);
+
+    // STREAMING
+    // The preprocessing can also be generated for one range of mult
+    // batches at a time, a chunk, so that the F.I. preprocessing of
+    // only one chunk is held at once
+
+    // Restricts the F.I. preprocessing that follows, and the
+    // PrepMult* steps, to the batches [first_batch, first_batch +
+    // n_mult_batches). The F.I. preprocessing of the previous chunk
+    // is dropped
+    void SetChunk(std::size_t first_batch, std::size_t n_mult_batches,
+		  std::size_t n_ind_shares, std::size_t n_inout_batches);
+
+    // The messages of FIPrepSend for a chunk of the given sizes, with
+    // randomness from prg. This reads nothing that SetChunk or the
+    // steps of the preprocessing change, so it can run on another
+    // thread while they do
+    vec<vec<FF>> ChunkFIPrepMessages(std::size_t n_mult_batches, std::size_t n_ind_shares,
+				     std::size_t n_inout_batches, scl::PRG prg) const;
+
+    // Assigns the individual sharings of the chunk to the inputs (for
+    // the first chunk) and then to the mult wires of its batches, in
+    // batch order, and derives those of the linear gates the next
+    // chunk may need
+    void PopulateChunkIndvShrs(const FlatCircuit& flat);
+
+
+    // PERSISTENT F.I. PREPROCESSING
+    // The output of the F.I. preprocessing over the whole circuit,
+    // that is, after the GenProd steps, can be stored to be used for
+    // the F.D. preprocessing later on, by another process. The file
+    // only depends on the number of correlations of each type, so it
+    // can be loaded into a correlator of any circuit with the same
+    // sizes, party, n, t and k
+
+    void SaveFIPrep(const std::string& path) const;
+    void LoadFIPrep(const std::string& path);
+
+    // BACKGROUND F.I. PREPROCESSING
+    // A correlator can be forked, so that the fork produces F.I.
+    // preprocessing over other channels while this one runs the F.D.
+    // preprocessing (see PrepPool)
+
+    // A copy of this correlator that runs over network, and draws its
+    // randomness from prg. The PRSS instances are forked too (see
+    // PRSS::Fork), so the correlations of the copy and of this one
+    // never coincide. It must be forked after SetThreshold,
+    // SetFIPrepConfig and the PRSS setup, by all the parties at the
+    // same point
+    Correlator Fork(std::shared_ptr<scl::Network> network, scl::PRG prg);
+
+    // Runs the F.I. preprocessing and the GenProd steps over the
+    // whole circuit, and takes the result out of the correlator
+    FIPrep GenFIPrep();
+
+    // Takes the place of the F.I. preprocessing, to be followed by
+    // PopulateIndvShrs and the F.D. preprocessing
+    void SetFIPrep(FIPrep prep);
 
     // Populate shares of e_i
     void PrecomputeEi() {
@@ -181,41 +275,86 @@ namespace tp {
 
     // Populate vandermonde matrix
     void PrecomputeVandermonde() {
-      mVandermonde.reserve(mParties);
+      // Column-major: column j holds the entries i^j for all parties i
+      mVandermonde = std::vector<FF>(mParties * NExtracted());
       for (std::size_t i = 0; i < mParties; i++) {
-	mVandermonde.emplace_back(std::vector<FF>());
-	mVandermonde[i].reserve(mThreshold + 1);
 	FF entry(1);
-	for (std::size_t j = 0; j < mThreshold + 1; ++j) {
-	  mVandermonde[i].emplace_back(entry);
+	for (std::size_t j = 0; j < NExtracted(); ++j) {
+	  mVandermonde[j * mParties + i] = entry;
 	  entry *= FF(i);
 	}
       }
     }
 
-    // Maps
-    std::map<std::shared_ptr<Gate>, FF> mMapIndShrs;
-    std::map<std::shared_ptr<MultBatch>, MultBatchFIPrep> mMapMultBatch;
-    std::map<std::shared_ptr<InputBatch>, IOBatchFIPrep> mMapInputBatch;
-    std::map<std::shared_ptr<OutputBatch>, IOBatchFIPrep> mMapOutputBatch;
+    // Individual sharing of the lambda of each wire, indexed by
+    // WireId
+    vec<FF> mWireIndShrs;
+
+    // Number of random sharings extracted from the n sharings dealt
+    // in one block. At most t of them are known to the adversary, so
+    // the remaining n-t are uniformly random
+    std::size_t NExtracted() { return mParties - mThreshold; }
 
   private:
+    // Number of blocks of n-t sharings needed to obtain n_amount sharings
+    std::size_t NBlocks(std::size_t n_amount) {
+      return (n_amount + NExtracted() - 1) / NExtracted();
+    }
+
+    // Number of elements each party sends to each peer in every
+    // step of the F.I. preprocessing. Correlations generated with
+    // PRSS need no communication
+    std::size_t NIndShrsElements() { return NBlocks(mNIndShrs); }
+    std::size_t NUnpackedShrElements() {
+      return IsDealt(mFIPrepConfig.unpacked_shr) ? mBatchSize * NBlocks(3*mNMultBatches) : 0;
+    }
+    std::size_t NZeroElements() {
+      return IsDealt(mFIPrepConfig.zero) ? NBlocks(3*mNMultBatches + mNInOutBatches) : 0;
+    }
+    std::size_t NZeroForProdElements() {
+      return IsDealt(mFIPrepConfig.zero_for_prod) ? mBatchSize * NBlocks(mNMultBatches) : 0;
+    }
+
+    bool IsDealt(Generation generation) { return generation == Generation::kDealt; }
+
+    // Append the shares for each peer to buffers (outer idx: party)
+    void AppendIndShrs(vec<vec<FF>>& buffers);
+    void AppendUnpackedShr(vec<vec<FF>>& buffers);
+    void AppendZero(vec<vec<FF>>& buffers);
+    void AppendZeroForProd(vec<vec<FF>>& buffers);
+
+    // Multiplies the shares received from each peer at offset by
+    // the Vandermonde matrix, obtaining n-t sharings
+    vec<FF> ApplyVandermonde(const vec<vec<FF>>& recv, std::size_t offset);
+
+    // Extract the sharings from the shares received from each peer,
+    // starting at offset. The offset is advanced past the consumed
+    // shares
+    void ExtractIndShrs(const vec<vec<FF>>& recv, std::size_t& offset);
+    void ExtractUnpackedShr(const vec<vec<FF>>& recv, std::size_t& offset);
+    void ExtractZero(const vec<vec<FF>>& recv, std::size_t& offset);
+    void ExtractZeroForProd(const vec<vec<FF>>& recv, std::size_t& offset);
+
+    // Share of the lambdas of the k wires at gates, plus a share of
+    // zero, sent in the F.D. preprocessing of an input/output batch
+    FF PrepIOShare(const WireId* gates, const IOBatchFIPrep& prep);
+
     // Sizes
     std::size_t mNIndShrs;
     std::size_t mNMultBatches;
     std::size_t mNInOutBatches;
 
-    // Counters
-    std::size_t mCTRIndShrs;
-    std::size_t mCTRMultBatches;
-    std::size_t mCTRInOutBatches;
+    // First mult batch of the current chunk, and number of levels of
+    // linear gates whose individual sharings are derived
+    std::size_t mFirstBatch = 0;
+    std::size_t mIndShrsLevels = 0;
 
     std::size_t mBatchSize;
 
 
     // Shares of e_i for current party
     std::vector<FF> mSharesOfEi; // len = batchsize
-    std::vector<std::vector<FF>> mVandermonde; // mParties x (mThreshold + 1)
+    std::vector<FF> mVandermonde; // mParties x (mParties - mThreshold), column-major
  
 
     // SHARINGS
@@ -242,9 +381,17 @@ namespace tp {
     std::size_t mID;
     std::size_t mParties;
 
-    std::size_t mThreshold;
+    std::size_t mThreshold = 0;
 
     scl::PRG mPRG;
+    std::shared_ptr<ThreadPool> mPool = std::make_shared<ThreadPool>(1);
+    KingPolicy mKingPolicy = KingPolicy::kParty0;
+
+    FIPrepConfig mFIPrepConfig;
+    bool mFixedPRSSSeeds = false;
+    PRSS mPRSSUnpackedShr; // subsets of size n-t: degree t
+    PRSS mPRSSZero;        // subsets of size k+1: degree n-1, k zeros
+    PRSS mPRSSZeroForProd; // subsets of size 2: degree n-1, 1 zero
   };
 
 } // namespace tp
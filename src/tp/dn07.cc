@@ -83,12 +83,10 @@ namespace tp {
 	recv_shares.Emplace(buffer);
       }
       // 2 multiply by Vandermonde
+      vec<FF> shrs(mThreshold+1);
+      scl::details::MatVecMany(shrs.data(), mVandermonde.data(), &recv_shares[0], mThreshold+1, mParties);
       for ( std::size_t shr_idx = 0; shr_idx < mThreshold+1; shr_idx++ ){
-	FF shr(0);
-	for ( std::size_t j = 0; j < mParties; j++ ){
-	  shr += mVandermonde[j][shr_idx] * recv_shares[j];
-	}
-	mRShrs.emplace_back(RandShr(shr));
+	mRShrs.emplace_back(RandShr(shrs[shr_idx]));
       }
     }
 
@@ -109,14 +107,12 @@ namespace tp {
       }
 
       // 2 multiply by Vandermonde
+      vec<FF> shrs(mThreshold+1);
+      vec<FF> shrs_d(mThreshold+1);
+      scl::details::MatVecMany(shrs.data(), mVandermonde.data(), &recv_shares[0], mThreshold+1, mParties);
+      scl::details::MatVecMany(shrs_d.data(), mVandermonde.data(), &recv_shares_d[0], mThreshold+1, mParties);
       for ( std::size_t shr_idx = 0; shr_idx < mThreshold+1; shr_idx++ ){
-	FF shr(0);
-	FF shr_d(0);
-	for ( std::size_t j = 0; j < mParties; j++ ){
-	  shr += mVandermonde[j][shr_idx] * recv_shares[j];
-	  shr_d += mVandermonde[j][shr_idx] * recv_shares_d[j];
-	}
-	mDShrs.emplace_back(DoubleShr(shr, shr_d));
+	mDShrs.emplace_back(DoubleShr(shrs[shr_idx], shrs_d[shr_idx]));
       }
     }
   }
@@ -156,11 +152,11 @@ namespace tp {
 	  // The last t parties set their shares of the mult gates
 	  mult_gate->SetDn07Share( mDShrs[ mMapMults[mult_gate] ].shr );
 
-	  // The last t parties send their shares to P1
+	  // The last t parties send their shares to the king
 	  FF shr = mult_gate->GetLeft()->GetDn07Share() * mult_gate->GetRight()->GetDn07Share() \
 	    - mDShrs[ mMapMults[mult_gate] ].dshr;
 
-	  mCircuit.mNetwork->Party(0)->Send(shr);
+	  mCircuit.mNetwork->Party(King(mult_gate))->Send(shr);
 	}
       }
     }
@@ -169,7 +165,7 @@ namespace tp {
   void DN07::FDMultP1Receives() {
     for (std::size_t layer = 0; layer < mCircuit.GetDepth(); layer++) {
       for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
-	if (mCircuit.mID == 0) {
+	if (mCircuit.mID == King(mult_gate)) {
 	  Vec shares_from_last;
 	  shares_from_last.Reserve(mThreshold);
 	  for (std::size_t i = mThreshold+1; i < mParties; ++i) {
@@ -260,18 +256,18 @@ namespace tp {
   void DN07::MultPartiesSendP1(std::size_t layer) {
     if (mCircuit.mID < mThreshold+1) {
       for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
-	// Send masked shares to P1
+	// Send masked shares to the king
 	FF shr = mult_gate->GetLeft()->GetDn07Share() * mult_gate->GetRight()->GetDn07Share() \
 	  - mDShrs[ mMapMults[mult_gate] ].dshr;
 
-	mCircuit.mNetwork->Party(0)->Send(shr);
+	mCircuit.mNetwork->Party(King(mult_gate))->Send(shr);
       }
     }
   }
 
   void DN07::MultP1Receives(std::size_t layer) {
-    if (mCircuit.mID == 0) {
-      for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
+    for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
+      if (mCircuit.mID == King(mult_gate)) {
 	Vec shares;
 	shares.Reserve(mParties);
 	for (std::size_t i = 0; i < mThreshold+1; ++i) {
@@ -290,7 +286,7 @@ namespace tp {
 
 	FF secret = scl::details::SecretFromShares(shares);
 
-	// P1 reconstructs and sends
+	// The king reconstructs and sends
 	Vec y_points;
 	y_points.Reserve(mThreshold+1);
 	y_points.Emplace(secret);
@@ -313,8 +309,8 @@ namespace tp {
     }
   }
   void DN07::MultP1SendsParties(std::size_t layer) {
-    if (mCircuit.mID == 0) {
-      for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
+    for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
+      if (mCircuit.mID == King(mult_gate)) {
 	for ( std::size_t i = 0; i < mThreshold+1; i++ ) {
 	  mCircuit.mNetwork->Party(i)->Send(mP1SharesToSend.front()[i]);
 	}
@@ -328,7 +324,7 @@ namespace tp {
       for (auto mult_gate : mCircuit.mFlatMultLayers[layer]) {
 
 	FF masked;
-	mCircuit.mNetwork->Party(0)->Recv(masked);
+	mCircuit.mNetwork->Party(King(mult_gate))->Recv(masked);
 	
 	// Compute share
 	FF share = masked + mDShrs[ mMapMults[mult_gate] ].shr;
@@ -92,14 +92,20 @@ namespace tp {
       return mMapResults[ mCircuit.mFlatOutputGates[owner_id][idx] ];
     }
 
+    // Multiplications are reconstructed by the king of their gate,
+    // following the king policy of the circuit with one gate per
+    // batch
+    std::size_t King(std::shared_ptr<MultGate> mult_gate) {
+      return tp::King(mCircuit.mKingPolicy, mMapMults[mult_gate], mParties);
+    }
+
     void PrecomputeVandermonde() {
-      mVandermonde.reserve(mParties);
+      // Column-major: column j holds the entries i^j for all parties i
+      mVandermonde = std::vector<FF>(mParties * (mThreshold + 1));
       for (std::size_t i = 0; i < mParties; i++) {
-	mVandermonde.emplace_back(std::vector<FF>());
-	mVandermonde[i].reserve(mThreshold + 1);
 	FF entry(1);
 	for (std::size_t j = 0; j < mThreshold + 1; ++j) {
-	  mVandermonde[i].emplace_back(entry);
+	  mVandermonde[j * mParties + i] = entry;
 	  entry *= FF(i);
 	}
       }
@@ -131,7 +137,7 @@ namespace tp {
     std::size_t mThreshold;
 
     scl::PRG mPRG;
-    std::vector<std::vector<FF>> mVandermonde; // mParties x (mThreshold + 1)
+    std::vector<FF> mVandermonde; // mParties x (mThreshold + 1), column-major
 
     std::queue<Vec> mP1SharesToSend; 
     std::queue<Vec> mMapP1SharesFromLast; 
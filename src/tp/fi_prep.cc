@@ -1,53 +1,80 @@
+#include <thread>
+
 #include "tp/correlator.h"
 
 namespace tp {
   // GEN F.I. PREP
-  void Correlator::GenIndShrsPartiesSend() {
+  vec<FF> Correlator::ApplyVandermonde(const vec<vec<FF>>& recv, std::size_t offset) {
+    vec<FF> recv_shares(mParties);
+    for ( std::size_t j = 0; j < mParties; j++ ) recv_shares[j] = recv[j][offset];
+
+    // Each output is the dot product of a (contiguous) column of the
+    // Vandermonde matrix with the shares, reduced only once
+    vec<FF> shrs(NExtracted());
+    scl::details::MatVecMany(shrs.data(), mVandermonde.data(), recv_shares.data(), NExtracted(), mParties);
+    return shrs;
+  }
+
+  void Correlator::SetFIPrepConfig(FIPrepConfig config) {
+    mFIPrepConfig = config;
+    if ( !IsDealt(config.unpacked_shr) ) mPRSSUnpackedShr = PRSS(mParties, mID, mParties - mThreshold);
+    if ( !IsDealt(config.zero) ) mPRSSZero = PRSS(mParties, mID, mBatchSize + 1);
+    if ( !IsDealt(config.zero_for_prod) ) mPRSSZeroForProd = PRSS(mParties, mID, 2);
+  }
+
+  void Correlator::PRSSSetupSend() {
+    // mPRG has a fixed seed, known to every party
+    auto entropy = PRSS::FromEntropy();
+    auto& prg = mFixedPRSSSeeds ? mPRG : entropy;
+    if ( !IsDealt(mFIPrepConfig.unpacked_shr) ) mPRSSUnpackedShr.SetupSend(mNetwork, prg);
+    if ( !IsDealt(mFIPrepConfig.zero) ) mPRSSZero.SetupSend(mNetwork, prg);
+    if ( !IsDealt(mFIPrepConfig.zero_for_prod) ) mPRSSZeroForProd.SetupSend(mNetwork, prg);
+  }
+
+  void Correlator::PRSSSetupRecv() {
+    if ( !IsDealt(mFIPrepConfig.unpacked_shr) ) mPRSSUnpackedShr.SetupRecv(mNetwork);
+    if ( !IsDealt(mFIPrepConfig.zero) ) mPRSSZero.SetupRecv(mNetwork);
+    if ( !IsDealt(mFIPrepConfig.zero_for_prod) ) mPRSSZeroForProd.SetupRecv(mNetwork);
+  }
+
+  void Correlator::AppendIndShrs(vec<vec<FF>>& buffers) {
     std::size_t degree = mParties - mBatchSize;
-    std::size_t n_blocks = (mNIndShrs + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(mNIndShrs);
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, degree);
     for ( std::size_t block = 0; block < n_blocks; block++ ) {
       // 1 sample secret and shares
       FF secret = FF::Random(mPRG);
-      
+
       Vec secrets(std::vector<FF>(mBatchSize, secret));
 
-      auto poly = scl::details::EvPolyFromSecretsAndDegree(secrets, degree, mPRG);
-      auto shares = scl::details::SharesFromEvPoly(poly, mParties);
+      auto shares = plan.Share(secrets, mPRG);
 
-      // 2 send shares
+      // 2 queue shares
       for ( std::size_t party = 0; party < mParties; party++ ){
-        mNetwork->Party(party)->Send(shares[party]);
+	buffers[party].emplace_back(shares[party]);
       }
     }
   }
 
-  void Correlator::GenIndShrsPartiesReceive() {
+  void Correlator::ExtractIndShrs(const vec<vec<FF>>& recv, std::size_t& offset) {
     assert(mIndShrs.size() == 0);
-    std::size_t n_blocks = (mNIndShrs + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(mNIndShrs);
     for ( std::size_t block = 0; block < n_blocks; block++ ) {
-      // 1 receive shares
-      std::vector<FF> recv_shares;
-      recv_shares.reserve(mParties);
-      for (std::size_t parties = 0; parties < mParties; parties++) {
-	FF buffer;
-        mNetwork->Party(parties)->Recv(buffer);
-	recv_shares.emplace_back(buffer);
-      }
-      // 2 multiply by Vandermonde
-      for ( std::size_t shr_idx = 0; shr_idx < mThreshold+1; shr_idx++ ){
-	FF shr(0);
-	for ( std::size_t j = 0; j < mParties; j++ ){
-	  shr += mVandermonde[j][shr_idx] * recv_shares[j];
-	}
+      // 1 multiply by Vandermonde
+      auto shrs = ApplyVandermonde(recv, offset);
+      for ( std::size_t shr_idx = 0; shr_idx < NExtracted(); shr_idx++ ){
+	FF shr = shrs[shr_idx];
 	mIndShrs.emplace_back(shr);
       }
+      offset++;
     }
   }
 
-  void Correlator::GenUnpackedShrPartiesSend() {
+  void Correlator::AppendUnpackedShr(vec<vec<FF>>& buffers) {
+    if ( !IsDealt(mFIPrepConfig.unpacked_shr) ) return;
     std::size_t degree = mThreshold;
     std::size_t n_amount = 3*mNMultBatches; // 2 for the two factors, 1 for the multiplication
-    std::size_t n_blocks = (n_amount + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(n_amount);
 
     for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
       for ( std::size_t block = 0; block < n_blocks; block++ ) {
@@ -57,18 +84,18 @@ namespace tp {
 
 	auto poly = scl::details::EvPolyFromSecretAndPointAndDegree(secret, FF(-pack_idx), degree, mPRG);
 	auto shares = scl::details::SharesFromEvPoly(poly, mParties);
-	
-	// 2 send shares
+
+	// 2 queue shares
 	for ( std::size_t party = 0; party < mParties; party++ ){
-	  mNetwork->Party(party)->Send(shares[party]);
+	  buffers[party].emplace_back(shares[party]);
 	}
       }
     }
 
   }
-  void Correlator::GenUnpackedShrPartiesReceive() {
+  void Correlator::ExtractUnpackedShr(const vec<vec<FF>>& recv, std::size_t& offset) {
     std::size_t n_amount = 3*mNMultBatches;
-    std::size_t n_blocks = (n_amount + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(n_amount);
     mUnpackedShrsA.reserve(mBatchSize);
     mUnpackedShrsB.reserve(mBatchSize);
     mUnpackedShrsMask.reserve(mBatchSize);
@@ -82,26 +109,26 @@ namespace tp {
       mUnpackedShrsMask.emplace_back(std::vector<FF>());
       mUnpackedShrsMask[pack_idx].reserve(mNMultBatches);
 
+      if ( !IsDealt(mFIPrepConfig.unpacked_shr) ) {
+	// Any random degree-t sharing is random at -pack_idx
+	auto shrs = mPRSSUnpackedShr.Next({}, n_amount);
+	mUnpackedShrsA[pack_idx].assign(shrs.begin(), shrs.begin() + mNMultBatches);
+	mUnpackedShrsB[pack_idx].assign(shrs.begin() + mNMultBatches, shrs.begin() + 2*mNMultBatches);
+	mUnpackedShrsMask[pack_idx].assign(shrs.begin() + 2*mNMultBatches, shrs.end());
+	continue;
+      }
+
       for ( std::size_t block = 0; block < n_blocks; block++ ) {
-	// 1 receive shares
-	Vec recv_shares;
-	recv_shares.Reserve(mParties);
-	for (std::size_t parties = 0; parties < mParties; parties++) {
-	  FF buffer;
-	  mNetwork->Party(parties)->Recv(buffer);
-	  recv_shares.Emplace(buffer);
-	}
-	// 2 multiply by Vandermonde
-	for ( std::size_t shr_idx = 0; shr_idx < mThreshold+1; shr_idx++ ){
-	  FF shr(0);
-	  for ( std::size_t j = 0; j < mParties; j++ ){
-	    shr += mVandermonde[j][shr_idx] * recv_shares[j];
-	  }
+	// 1 multiply by Vandermonde
+	auto shrs = ApplyVandermonde(recv, offset);
+	for ( std::size_t shr_idx = 0; shr_idx < NExtracted(); shr_idx++ ){
+	  FF shr = shrs[shr_idx];
 	  if (ctr < mNMultBatches) mUnpackedShrsA[pack_idx].emplace_back(shr);
 	  if ( (mNMultBatches <= ctr) && (ctr < 2*mNMultBatches) ) mUnpackedShrsB[pack_idx].emplace_back(shr);
 	  if ( (2*mNMultBatches <= ctr) && (ctr < 3*mNMultBatches) ) mUnpackedShrsMask[pack_idx].emplace_back(shr);
 	  ctr++;
 	}
+	offset++;
       }
     }
     // Create Mult-related data
@@ -117,60 +144,70 @@ namespace tp {
 
   // Zero shares. Used for:
   // Inputs, Outputs, 3xMult
-  void Correlator::GenZeroPartiesSend() {
+  void Correlator::AppendZero(vec<vec<FF>>& buffers) {
+    if ( !IsDealt(mFIPrepConfig.zero) ) return;
     std::size_t degree = mParties - 1;
     std::size_t n_amount = 3*mNMultBatches + mNInOutBatches;
-    std::size_t n_blocks = (n_amount + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(n_amount);
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, degree);
     for ( std::size_t block = 0; block < n_blocks; block++ ) {
       // 1 sample secret and shares
       Vec secrets(std::vector<FF>(mBatchSize, FF(0)));
 
-      auto poly = scl::details::EvPolyFromSecretsAndDegree(secrets, degree, mPRG);
-      auto shares = scl::details::SharesFromEvPoly(poly, mParties);
-	
-      // 2 send shares
+      auto shares = plan.Share(secrets, mPRG);
+
+      // 2 queue shares
       for ( std::size_t party = 0; party < mParties; party++ ){
-	mNetwork->Party(party)->Send(shares[party]);
+	buffers[party].emplace_back(shares[party]);
       }
     }
   }
 
-  void Correlator::GenZeroPartiesReceive() {
+  void Correlator::ExtractZero(const vec<vec<FF>>& recv, std::size_t& offset) {
     std::size_t n_amount = 3*mNMultBatches + mNInOutBatches;
+    if ( !IsDealt(mFIPrepConfig.zero) ) {
+      vec<FF> zeros;
+      for (std::size_t i = 0; i < mBatchSize; ++i) zeros.emplace_back(FF(-i));
+      auto shrs = mPRSSZero.Next(zeros, n_amount);
+      for ( std::size_t i = 0; i < mNMultBatches; i++ ) {
+	mMultBatchFIPrep[i].mShrO1 = shrs[i];
+	mMultBatchFIPrep[i].mShrO2 = shrs[mNMultBatches + i];
+	mMultBatchFIPrep[i].mShrO3 = shrs[2*mNMultBatches + i];
+      }
+      for ( std::size_t i = 3*mNMultBatches; i < n_amount; i++ ) {
+	IOBatchFIPrep tmp;
+	tmp.mShrO = shrs[i];
+	mIOBatchFIPrep.emplace_back(tmp);
+      }
+      return;
+    }
+
     std::size_t ctr(0);
-    std::size_t n_blocks = (n_amount + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(n_amount);
     for ( std::size_t block = 0; block < n_blocks; block++ ) {
-      // 1 receive shares
-      Vec recv_shares;
-      recv_shares.Reserve(mParties);
-      for (std::size_t parties = 0; parties < mParties; parties++) {
-	FF buffer;
-	mNetwork->Party(parties)->Recv(buffer);
-	recv_shares.Emplace(buffer);
-      }
-      // 2 multiply by Vandermonde
-      for ( std::size_t shr_idx = 0; shr_idx < mThreshold+1; shr_idx++ ){
-	FF shr(0);
-	for ( std::size_t j = 0; j < mParties; j++ ){
-	  shr += mVandermonde[j][shr_idx] * recv_shares[j];
-	}
-	if (ctr < mNMultBatches) mMultBatchFIPrep[ctr].mShrO1 = shr; 
+      // 1 multiply by Vandermonde
+      auto shrs = ApplyVandermonde(recv, offset);
+      for ( std::size_t shr_idx = 0; shr_idx < NExtracted(); shr_idx++ ){
+	FF shr = shrs[shr_idx];
+	if (ctr < mNMultBatches) mMultBatchFIPrep[ctr].mShrO1 = shr;
 	if ((mNMultBatches <= ctr) && (ctr < 2*mNMultBatches)) mMultBatchFIPrep[ctr - mNMultBatches].mShrO2 = shr;
 	if ((2*mNMultBatches <= ctr) && (ctr < 3*mNMultBatches)) mMultBatchFIPrep[ctr - 2*mNMultBatches].mShrO3 = shr;
-	else {
+	if ((3*mNMultBatches <= ctr) && (ctr < n_amount)) {
 	  IOBatchFIPrep tmp;
 	  tmp.mShrO = shr;
 	  mIOBatchFIPrep.emplace_back(tmp);
 	}
 	ctr++;
       }
+      offset++;
     }
   }
 
-  void Correlator::GenZeroForProdPartiesSend() {
+  void Correlator::AppendZeroForProd(vec<vec<FF>>& buffers) {
+    if ( !IsDealt(mFIPrepConfig.zero_for_prod) ) return;
     std::size_t degree = mParties - 1;
-    std::size_t n_amount = mNMultBatches; 
-    std::size_t n_blocks = (n_amount + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_amount = mNMultBatches;
+    std::size_t n_blocks = NBlocks(n_amount);
 
     for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
       for ( std::size_t block = 0; block < n_blocks; block++ ) {
@@ -179,121 +216,315 @@ namespace tp {
 
 	auto poly = scl::details::EvPolyFromSecretAndPointAndDegree(secret, FF(-pack_idx), degree, mPRG);
 	auto shares = scl::details::SharesFromEvPoly(poly, mParties);
-	
-	// 2 send shares
+
+	// 2 queue shares
 	for ( std::size_t party = 0; party < mParties; party++ ){
-	  mNetwork->Party(party)->Send(shares[party]);
+	  buffers[party].emplace_back(shares[party]);
 	}
       }
     }
   }
 
-  void Correlator::GenZeroForProdPartiesReceive() {
+  void Correlator::ExtractZeroForProd(const vec<vec<FF>>& recv, std::size_t& offset) {
     std::size_t n_amount = mNMultBatches;
-    std::size_t n_blocks = (n_amount + (mThreshold + 1) -1) / (mThreshold + 1);
+    std::size_t n_blocks = NBlocks(n_amount);
     mZeroProdShrs.reserve(mBatchSize);
 
     for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
       mZeroProdShrs.emplace_back(std::vector<FF>());
       mZeroProdShrs[pack_idx].reserve(mNMultBatches);
 
+      if ( !IsDealt(mFIPrepConfig.zero_for_prod) ) {
+	mZeroProdShrs[pack_idx] = mPRSSZeroForProd.Next({FF(-pack_idx)}, n_amount);
+	continue;
+      }
+
       for ( std::size_t block = 0; block < n_blocks; block++ ) {
-	// 1 receive shares
-	Vec recv_shares;
-	recv_shares.Reserve(mParties);
-	for (std::size_t parties = 0; parties < mParties; parties++) {
-	  FF buffer;
-	  mNetwork->Party(parties)->Recv(buffer);
-	  recv_shares.Emplace(buffer);
-	}
-	// 2 multiply by Vandermonde
-	for ( std::size_t shr_idx = 0; shr_idx < mThreshold+1; shr_idx++ ){
-	  FF shr(0);
-	  for ( std::size_t j = 0; j < mParties; j++ ){
-	    shr += mVandermonde[j][shr_idx] * recv_shares[j];
-	  }
+	// 1 multiply by Vandermonde
+	auto shrs = ApplyVandermonde(recv, offset);
+	for ( std::size_t shr_idx = 0; shr_idx < NExtracted(); shr_idx++ ){
+	  FF shr = shrs[shr_idx];
 	  mZeroProdShrs[pack_idx].emplace_back(shr);
 	}
+	offset++;
       }
     }
   }
 
-  void Correlator::GenProdPartiesSendP1() {
-    for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
-      for ( std::size_t batch = 0; batch < mNMultBatches; batch++ ) {
-        // 1. Gather shares
-	FF share = mUnpackedShrsA[pack_idx][batch] * mUnpackedShrsB[pack_idx][batch]\
-	  + mUnpackedShrsMask[pack_idx][batch] + mZeroProdShrs[pack_idx][batch];
+  // Each Gen*Send/Receive pair exchanges a single message per peer
+  void Correlator::GenIndShrsPartiesSend() {
+    vec<vec<FF>> buffers(mParties);
+    AppendIndShrs(buffers);
+    SendToParties(mNetwork, buffers);
+  }
+  void Correlator::GenIndShrsPartiesReceive() {
+    auto recv = RecvFromParties(mNetwork, NIndShrsElements());
+    std::size_t offset(0);
+    ExtractIndShrs(recv, offset);
+  }
 
-	// 2. send shares
-	mNetwork->Party(0)->Send(share);
+  void Correlator::GenUnpackedShrPartiesSend() {
+    vec<vec<FF>> buffers(mParties);
+    AppendUnpackedShr(buffers);
+    SendToParties(mNetwork, buffers);
+  }
+  void Correlator::GenUnpackedShrPartiesReceive() {
+    auto recv = RecvFromParties(mNetwork, NUnpackedShrElements());
+    std::size_t offset(0);
+    ExtractUnpackedShr(recv, offset);
+  }
+
+  void Correlator::GenZeroPartiesSend() {
+    vec<vec<FF>> buffers(mParties);
+    AppendZero(buffers);
+    SendToParties(mNetwork, buffers);
+  }
+  void Correlator::GenZeroPartiesReceive() {
+    auto recv = RecvFromParties(mNetwork, NZeroElements());
+    std::size_t offset(0);
+    ExtractZero(recv, offset);
+  }
+
+  void Correlator::GenZeroForProdPartiesSend() {
+    vec<vec<FF>> buffers(mParties);
+    AppendZeroForProd(buffers);
+    SendToParties(mNetwork, buffers);
+  }
+  void Correlator::GenZeroForProdPartiesReceive() {
+    auto recv = RecvFromParties(mNetwork, NZeroForProdElements());
+    std::size_t offset(0);
+    ExtractZeroForProd(recv, offset);
+  }
+
+  // The whole F.I. round in one message per peer. The extraction
+  // order must match the order in which the shares were appended
+  void Correlator::FIPrepSend() {
+    SendToParties(mNetwork, FIPrepMessages());
+  }
+
+  vec<vec<FF>> Correlator::FIPrepMessages() {
+    vec<vec<FF>> buffers(mParties);
+    std::size_t n_elements = NIndShrsElements() + NUnpackedShrElements() \
+      + NZeroElements() + NZeroForProdElements();
+    for (auto& buffer : buffers) buffer.reserve(n_elements);
+
+    AppendIndShrs(buffers);
+    AppendUnpackedShr(buffers);
+    AppendZero(buffers);
+    AppendZeroForProd(buffers);
+    return buffers;
+  }
+
+  // The shares are appended by a correlator of the chunk's sizes
+  // that only knows what Append* need
+  vec<vec<FF>> Correlator::ChunkFIPrepMessages(std::size_t n_mult_batches, std::size_t n_ind_shares,
+					       std::size_t n_inout_batches, scl::PRG prg) const {
+    Correlator chunk(n_ind_shares, n_mult_batches, n_inout_batches, mBatchSize);
+    chunk.mParties = mParties;
+    chunk.mThreshold = mThreshold;
+    chunk.mFIPrepConfig = mFIPrepConfig;
+    chunk.mPRG = prg;
+    return chunk.FIPrepMessages();
+  }
+
+  void Correlator::FIPrepRecv() {
+    std::size_t n_elements = NIndShrsElements() + NUnpackedShrElements() \
+      + NZeroElements() + NZeroForProdElements();
+    auto recv = RecvFromParties(mNetwork, n_elements);
+
+    std::size_t offset(0);
+    ExtractIndShrs(recv, offset);
+    ExtractUnpackedShr(recv, offset);
+    ExtractZero(recv, offset);
+    ExtractZeroForProd(recv, offset);
+  }
+
+  // The products are reconstructed by the king of each batch, see
+  // KingPolicy. Element pack_idx * n + j of a message to or from a
+  // king is position pack_idx of its j-th batch, n being the number
+  // of batches of that king
+  void Correlator::GenProdPartiesSendP1() {
+    auto kings = BatchesPerKing(mKingPolicy, 0, mNMultBatches, mParties);
+    vec<vec<FF>> buffers(mParties);
+    for ( std::size_t king = 0; king < mParties; king++ ) {
+      buffers[king].reserve(mBatchSize * kings[king].size());
+      for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
+	for ( auto batch : kings[king] ) {
+	  // 1. Gather shares
+	  FF share = mUnpackedShrsA[pack_idx][batch] * mUnpackedShrsB[pack_idx][batch]\
+	    + mUnpackedShrsMask[pack_idx][batch] + mZeroProdShrs[pack_idx][batch];
+	  buffers[king].emplace_back(share);
+	}
       }
     }
+
+    // 2. send shares
+    SendToParties(mNetwork, buffers);
   }
 
   void Correlator::GenProdP1ReceivesAndSends() {
-    if ( mID == 0 ) {
+    std::size_t n_batches = BatchesPerKing(mKingPolicy, 0, mNMultBatches, mParties)[mID].size();
+    if ( n_batches == 0 ) return;
+
+    // 1. Receive shares
+    auto recv = RecvFromParties(mNetwork, mBatchSize * n_batches);
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, mParties-1);
+
+    // The sharing sent back for position pack_idx is the secret at
+    // -pack_idx with zeros at 1..t, so each share is the secret
+    // times a fixed Lagrange coefficient
+    vec<Vec> coefficients;
+    coefficients.reserve(mBatchSize);
+    for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
+      Vec y_points;
+      y_points.Reserve(mThreshold+1);
+      y_points.Emplace(FF(1));
+      for (std::size_t i = 1; i < mThreshold+1; ++i) y_points.Emplace(FF(0));
+
+      Vec x_points;
+      x_points.Reserve(mThreshold+1);
+      x_points.Emplace(FF(-pack_idx));
+      for (std::size_t i = 1; i < mThreshold+1; ++i) x_points.Emplace(FF(i));
+
+      auto poly = scl::details::EvPolynomial<FF>(x_points, y_points);
+      coefficients.emplace_back(scl::details::SharesFromEvPoly(poly, mParties));
+    }
+
+    // The batches of each position are split across the threads of
+    // the king
+    vec<vec<FF>> buffers(mParties);
+    for ( std::size_t i = mThreshold; i < mParties; i++ ) buffers[i].resize(mBatchSize * n_batches);
+    mPool->ParallelFor(n_batches, [&](std::size_t begin, std::size_t end) {
       for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
-	for ( std::size_t batch = 0; batch < mNMultBatches; batch++ ) {
-	  // 1. Receive shares
+	for ( std::size_t batch = begin; batch < end; batch++ ) {
+	  std::size_t idx = pack_idx * n_batches + batch;
 	  Vec recv_shares;
 	  recv_shares.Reserve(mParties);
 	  for (std::size_t parties = 0; parties < mParties; parties++) {
-	    FF buffer;
-	    mNetwork->Party(parties)->Recv(buffer);
-	    recv_shares.Emplace(buffer);
+	    recv_shares.Emplace(recv[parties][idx]);
 	  }
 
 	  // 2. Reconstruct
-	  auto secret = SecretFromPointAndShares(FF(-pack_idx), recv_shares);
+	  auto secret = plan.ReconstructAt(pack_idx, recv_shares);
 
 	  // 3. Send back (w. optimization of zero-shares)
-	  Vec y_points;
-	  y_points.Reserve(mThreshold+1);
-	  y_points.Emplace(secret);
-	  for (std::size_t i = 1; i < mThreshold+1; ++i) y_points.Emplace(FF(0));
-
-	  Vec x_points;
-	  x_points.Reserve(mThreshold+1);
-	  x_points.Emplace(FF(-pack_idx));
-	  for (std::size_t i = 1; i < mThreshold+1; ++i) x_points.Emplace(FF(i));
-
-	  auto poly = scl::details::EvPolynomial<FF>(x_points, y_points);
-	  auto shares_to_send = scl::details::SharesFromEvPoly(poly, mParties);
 	  for ( std::size_t i = mThreshold; i < mParties; i++ ) {
-	    mNetwork->Party(i)->Send(shares_to_send[i]);
+	    buffers[i][idx] = secret * coefficients[pack_idx][i];
 	  }
 	}
       }
-    }
+    }, kMinBatchesPerThread);
+    SendToParties(mNetwork, buffers);
   }
 
   void Correlator::GenProdPartiesReceive() {
-    std::vector<std::vector<FF>> shares_prod;
-    shares_prod.reserve(mBatchSize);
-
-    for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
-      shares_prod.emplace_back(std::vector<FF>());
-      shares_prod[pack_idx].reserve(mNMultBatches);
-      for ( std::size_t batch = 0; batch < mNMultBatches; batch++ ) {
-	FF recv;
-	if (mID >= mThreshold) {
-	// 1. Receive secret
-	mNetwork->Party(0)->Recv(recv);
-	} else {
-	  recv = FF(0);
-	}
-	       
-	// 2. Compute shares
-	FF shr_prod = recv - mUnpackedShrsMask[pack_idx][batch];
-	shares_prod[pack_idx].emplace_back(shr_prod);
+    // Only the last n-t parties get a non-zero share. The share of
+    // the product is the received value minus the mask, so the mask
+    // terms are accumulated while the values are in flight
+    auto kings = BatchesPerKing(mKingPolicy, 0, mNMultBatches, mParties);
+    vec<vec<FF>> recv(mParties);
+    vec<std::future<void>> received;
+    if ( mID >= mThreshold ) {
+      for ( std::size_t king = 0; king < mParties; king++ ) {
+	recv[king].resize(mBatchSize * kings[king].size());
+	if ( !recv[king].empty() ) received.emplace_back(mNetwork->Party(king)->RecvAsync(recv[king]));
       }
     }
 
     for ( std::size_t i = 0; i < mNMultBatches; i++ ) {
       for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
-	mMultBatchFIPrep[i].mShrC += mSharesOfEi[pack_idx] * shares_prod[pack_idx][i];
+	mMultBatchFIPrep[i].mShrC -= mSharesOfEi[pack_idx] * mUnpackedShrsMask[pack_idx][i];
       }
     }
+
+    for ( auto& r : received ) r.get();
+    if ( mID < mThreshold ) return;
+    for ( std::size_t king = 0; king < mParties; king++ ) {
+      std::size_t n_batches = kings[king].size();
+      for ( std::size_t j = 0; j < n_batches; j++ ) {
+	for ( std::size_t pack_idx = 0; pack_idx < mBatchSize; pack_idx++ ) {
+	  mMultBatchFIPrep[kings[king][j]].mShrC += mSharesOfEi[pack_idx] * recv[king][pack_idx * n_batches + j];
+	}
+      }
+    }
+  }
+
+  // PERSISTENT F.I. PREPROCESSING
+  void Correlator::SaveFIPrep(const std::string& path) const {
+    if ( mIndShrs.size() < mNIndShrs || mMultBatchFIPrep.size() != mNMultBatches || \
+	 mIOBatchFIPrep.size() != mNInOutBatches )
+      throw std::invalid_argument("Run the F.I. preprocessing before saving it");
+
+    PrepHeader header;
+    header.mKind = static_cast<std::uint32_t>(PrepKind::kFunctionIndependent);
+    header.mParties = mParties;
+    header.mThreshold = mThreshold;
+    header.mBatchSize = mBatchSize;
+    header.mID = mID;
+    header.mSectionSize[kIndShrs] = mNIndShrs;
+    header.mSectionSize[kMultBatchFIPrep] = 6 * mNMultBatches;
+    header.mSectionSize[kIOBatchFIPrep] = mNInOutBatches;
+
+    PrepWriter writer(path, header);
+    writer.Write(mIndShrs.data(), mNIndShrs);
+    writer.Write(reinterpret_cast<const FF*>(mMultBatchFIPrep.data()), 6 * mNMultBatches);
+    writer.Write(reinterpret_cast<const FF*>(mIOBatchFIPrep.data()), mNInOutBatches);
+    writer.Close();
+  }
+
+  void Correlator::LoadFIPrep(const std::string& path) {
+    PrepFile file(path, PrepKind::kFunctionIndependent);
+    file.Check(mParties, mID, mBatchSize);
+    if ( file.Header().mThreshold != mThreshold )
+      throw std::invalid_argument(path + " was written for t = " + std::to_string(file.Header().mThreshold));
+    if ( file.SectionSize(kIndShrs) != mNIndShrs || file.SectionSize(kMultBatchFIPrep) != 6 * mNMultBatches || \
+	 file.SectionSize(kIOBatchFIPrep) != mNInOutBatches )
+      throw std::invalid_argument(path + " holds the F.I. preprocessing of a circuit of other sizes");
+
+    auto mult = reinterpret_cast<const MultBatchFIPrep*>(file.Section(kMultBatchFIPrep));
+    auto io = reinterpret_cast<const IOBatchFIPrep*>(file.Section(kIOBatchFIPrep));
+    mIndShrs.assign(file.Section(kIndShrs), file.Section(kIndShrs) + mNIndShrs);
+    mMultBatchFIPrep.assign(mult, mult + mNMultBatches);
+    mIOBatchFIPrep.assign(io, io + mNInOutBatches);
+  }
+
+  // BACKGROUND F.I. PREPROCESSING
+  Correlator Correlator::Fork(std::shared_ptr<scl::Network> network, scl::PRG prg) {
+    Correlator fork(*this);
+    fork.SetNetwork(network, mID);
+    fork.mPRG = prg;
+    if ( !IsDealt(mFIPrepConfig.unpacked_shr) ) fork.mPRSSUnpackedShr = mPRSSUnpackedShr.Fork();
+    if ( !IsDealt(mFIPrepConfig.zero) ) fork.mPRSSZero = mPRSSZero.Fork();
+    if ( !IsDealt(mFIPrepConfig.zero_for_prod) ) fork.mPRSSZeroForProd = mPRSSZeroForProd.Fork();
+    return fork;
+  }
+
+  FIPrep Correlator::GenFIPrep() {
+    // Drops what is left from the last run
+    SetChunk(0, mNMultBatches, mNIndShrs, mNInOutBatches);
+    std::thread send(&Correlator::FIPrepSend, this);
+    FIPrepRecv();
+    send.join();
+    GenProdPartiesSendP1();
+    GenProdP1ReceivesAndSends();
+    GenProdPartiesReceive();
+
+    FIPrep prep;
+    prep.mIndShrs = std::move(mIndShrs);
+    prep.mMultBatchFIPrep = std::move(mMultBatchFIPrep);
+    prep.mIOBatchFIPrep = std::move(mIOBatchFIPrep);
+    mIndShrs.clear();
+    mMultBatchFIPrep.clear();
+    mIOBatchFIPrep.clear();
+    return prep;
+  }
+
+  void Correlator::SetFIPrep(FIPrep prep) {
+    if ( prep.mIndShrs.size() < mNIndShrs || prep.mMultBatchFIPrep.size() != mNMultBatches || \
+	 prep.mIOBatchFIPrep.size() != mNInOutBatches )
+      throw std::invalid_argument("The F.I. preprocessing is for a circuit of other sizes");
+    mIndShrs = std::move(prep.mIndShrs);
+    mMultBatchFIPrep = std::move(prep.mMultBatchFIPrep);
+    mIOBatchFIPrep = std::move(prep.mIOBatchFIPrep);
   }
 }
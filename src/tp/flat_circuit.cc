@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "tp/flat_circuit.h"
+
+namespace tp {
+  namespace {
+    // As in InputLayer and OutputLayer, every client has at least one
+    // batch, even if it owns no gates
+    void FormBatches(const vec<WireId>& gates, const vec<std::uint32_t>& begin, std::size_t batch_size,
+		     vec<WireId>& batches, vec<std::uint32_t>& owners) {
+      batches.clear();
+      owners.clear();
+      for (std::size_t c = 0; c + 1 < begin.size(); ++c) {
+	std::size_t n_gates = begin[c+1] - begin[c];
+	std::size_t n_batches = std::max<std::size_t>(1, (n_gates + batch_size - 1) / batch_size);
+	batches.insert(batches.end(), gates.begin() + begin[c], gates.begin() + begin[c+1]);
+	batches.resize(batches.size() + n_batches*batch_size - n_gates, FlatCircuit::kPaddingWire);
+	owners.insert(owners.end(), n_batches, c);
+      }
+    }
+  } // namespace
+
+  void FlatCircuit::AssignLayers() {
+    // 1. Multiplicative depth of every wire
+    vec<std::uint32_t> depth(NWires(), 0);
+    std::uint32_t n_layers(0);
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      switch ( mType[w] ) {
+      case GateType::kMult:
+	depth[w] = std::max(depth[mLeft[w]], depth[mRight[w]]) + 1;
+	n_layers = std::max(n_layers, depth[w]);
+	break;
+      case GateType::kAdd:
+	depth[w] = std::max(depth[mLeft[w]], depth[mRight[w]]);
+	break;
+      case GateType::kOutput:
+	depth[w] = depth[mLeft[w]];
+	break;
+      default:
+	break;
+      }
+    }
+
+    // 2. Latest layer of every mult. need[w] is the first layer that
+    // consumes w, and consumers have larger wire ids
+    vec<std::uint32_t> need(NWires(), n_layers);
+    vec<std::uint32_t> latest(NWires(), 0);
+    for (std::size_t w = NWires() - 1; w > 0; --w) {
+      switch ( mType[w] ) {
+      case GateType::kMult:
+	latest[w] = need[w] - 1;
+	need[mLeft[w]] = std::min(need[mLeft[w]], latest[w]);
+	need[mRight[w]] = std::min(need[mRight[w]], latest[w]);
+	break;
+      case GateType::kAdd:
+	need[mLeft[w]] = std::min(need[mLeft[w]], need[w]);
+	need[mRight[w]] = std::min(need[mRight[w]], need[w]);
+	break;
+      case GateType::kOutput:
+	need[mLeft[w]] = std::min(need[mLeft[w]], need[w]);
+	break;
+      default:
+	break;
+      }
+    }
+
+    // 3. List scheduling, layer by layer. A mult becomes ready once
+    // the mults it depends on are assigned to earlier layers. A wire
+    // is known once its value is available, and pending[w] is the
+    // number of inputs of w that are not known yet
+    vec<std::uint32_t> consumers_begin(NWires() + 1, 0);
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      if ( mType[w] == GateType::kAdd || mType[w] == GateType::kMult ) {
+	consumers_begin[mLeft[w] + 1]++;
+	consumers_begin[mRight[w] + 1]++;
+      }
+    }
+    for (std::size_t w = 1; w <= NWires(); ++w) consumers_begin[w] += consumers_begin[w-1];
+    vec<WireId> consumers(consumers_begin.back());
+    vec<std::uint32_t> next(consumers_begin.begin(), consumers_begin.end() - 1);
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      if ( mType[w] == GateType::kAdd || mType[w] == GateType::kMult ) {
+	consumers[next[mLeft[w]]++] = w;
+	consumers[next[mRight[w]]++] = w;
+      }
+    }
+
+    vec<std::uint8_t> pending(NWires(), 2);
+    vec<WireId> known;
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      if ( mType[w] == GateType::kInput ) known.emplace_back(w);
+    }
+
+    // Ready mults, most urgent first
+    using Entry = std::pair<std::uint32_t, WireId>;
+    std::priority_queue<Entry, vec<Entry>, std::greater<Entry>> ready;
+    auto propagate = [&]() {
+      while ( !known.empty() ) {
+	auto u = known.back();
+	known.pop_back();
+	for (std::size_t i = consumers_begin[u]; i < consumers_begin[u+1]; ++i) {
+	  auto c = consumers[i];
+	  if ( --pending[c] > 0 ) continue;
+	  if ( mType[c] == GateType::kAdd ) known.emplace_back(c);
+	  else ready.emplace(latest[c], c);
+	}
+      }
+    };
+    propagate();
+
+    mMultGates.clear();
+    mLayerBegin.assign(1, 0);
+    for (std::uint32_t l = 0; l < n_layers; ++l) {
+      // The mults that cannot be postponed, rounded up to full batches
+      // with the ones that can
+      vec<WireId> layer;
+      while ( !ready.empty() && ready.top().first == l ) {
+	layer.emplace_back(ready.top().second);
+	ready.pop();
+      }
+      while ( !ready.empty() && layer.size() % mBatchSize != 0 ) {
+	layer.emplace_back(ready.top().second);
+	ready.pop();
+      }
+      std::sort(layer.begin(), layer.end());
+
+      known.insert(known.end(), layer.begin(), layer.end());
+      mMultGates.insert(mMultGates.end(), layer.begin(), layer.end());
+      mMultGates.resize(mMultGates.size() + (mBatchSize - layer.size() % mBatchSize) % mBatchSize, kPaddingWire);
+      mLayerBegin.emplace_back(mMultGates.size() / mBatchSize);
+      propagate();
+    }
+  }
+
+  void FlatCircuit::Finalize() {
+    // Mult gates of layer l have level l+1. 0 marks the gates that are
+    // not a mult, or not assigned to a layer
+    vec<std::uint32_t> level(NWires(), 0);
+    for (std::size_t l = 0; l < NLayers(); ++l) {
+      for (std::size_t i = mLayerBegin[l]*mBatchSize; i < mLayerBegin[l+1]*mBatchSize; ++i) {
+	if ( mMultGates[i] != kPaddingWire ) level[mMultGates[i]] = l + 1;
+      }
+    }
+
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      switch ( mType[w] ) {
+      case GateType::kMult:
+	if ( level[w] == 0 )
+	  throw std::invalid_argument("Multiplication gate is not assigned to a layer");
+	if ( level[mLeft[w]] >= level[w] || level[mRight[w]] >= level[w] )
+	  throw std::invalid_argument("Multiplication gate depends on a gate of its own or a later layer");
+	break;
+      case GateType::kAdd:
+	level[w] = std::max(level[mLeft[w]], level[mRight[w]]);
+	break;
+      case GateType::kOutput:
+	level[w] = level[mLeft[w]];
+	break;
+      default:
+	break;
+      }
+    }
+
+    // Counting sort of the linear gates by level, which keeps them in
+    // topological order within a level
+    mLinearBegin.assign(NLayers() + 2, 0);
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      if ( mType[w] == GateType::kAdd || mType[w] == GateType::kOutput ) mLinearBegin[level[w] + 1]++;
+    }
+    for (std::size_t l = 1; l < mLinearBegin.size(); ++l) mLinearBegin[l] += mLinearBegin[l-1];
+    mLinearGates.resize(mLinearBegin.back());
+    vec<std::uint32_t> next(mLinearBegin.begin(), mLinearBegin.end() - 1);
+    for (std::size_t w = 1; w < NWires(); ++w) {
+      if ( mType[w] == GateType::kAdd || mType[w] == GateType::kOutput ) mLinearGates[next[level[w]]++] = w;
+    }
+
+    FormBatches(mInputGates, mInputBegin, mBatchSize, mInputBatches, mInputBatchOwner);
+    FormBatches(mOutputGates, mOutputBegin, mBatchSize, mOutputBatches, mOutputBatchOwner);
+
+    mMu.assign(NWires(), FF(0));
+    mLearned.assign(NWires(), 0);
+    mLambda.assign(NWires(), FF(0));
+    mValue.assign(NWires(), FF(0));
+
+    mShrLambdaA.assign(NMultBatches(), FF(0));
+    mShrLambdaB.assign(NMultBatches(), FF(0));
+    mShrDeltaC.assign(NMultBatches(), FF(0));
+    mShrMuA.assign(NMultBatches(), FF(0));
+    mShrMuB.assign(NMultBatches(), FF(0));
+
+    mEvaluatedLevels = 0;
+  }
+
+  std::uint64_t FlatCircuit::Hash() const {
+    // FNV-1a over the bytes of each array, and of its size
+    std::uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash](const void* data, std::size_t n_bytes) {
+      auto bytes = static_cast<const unsigned char*>(data);
+      for (std::size_t i = 0; i < n_bytes; ++i) {
+	hash ^= bytes[i];
+	hash *= 0x100000001b3;
+      }
+    };
+    auto mix_vec = [&mix](const auto& v) {
+      std::uint64_t size = v.size();
+      mix(&size, sizeof(size));
+      mix(v.data(), v.size() * sizeof(v[0]));
+    };
+    std::uint64_t batch_size = mBatchSize;
+    mix(&batch_size, sizeof(batch_size));
+    mix_vec(mType);
+    mix_vec(mLeft);
+    mix_vec(mRight);
+    mix_vec(mMultGates);
+    mix_vec(mLayerBegin);
+    mix_vec(mInputBatches);
+    mix_vec(mInputBatchOwner);
+    mix_vec(mOutputBatches);
+    mix_vec(mOutputBatchOwner);
+    return hash;
+  }
+
+} // namespace tp
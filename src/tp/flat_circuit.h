@@ -0,0 +1,111 @@
+#ifndef FLAT_CIRCUIT_H
+#define FLAT_CIRCUIT_H
+
+#include <limits>
+
+#include "tp.h"
+
+namespace tp {
+  enum class GateType : std::uint8_t { kPadding, kInput, kAdd, kMult, kOutput };
+
+  // Struct-of-arrays representation of a circuit, which the protocol
+  // phases of Circuit run over. Circuit lowers every gate into it as
+  // the gate is created, so gates are stored in topological order,
+  // and wire w is the output of gate w.
+  //
+  // Batches and layers are index ranges: mult batch b consists of the
+  // gates mMultGates[b*k .. (b+1)*k), and mult layer l consists of
+  // the batches [mLayerBegin[l], mLayerBegin[l+1]).
+  struct FlatCircuit {
+    // Fills the empty slots of the batches. It is its own left and
+    // right input, and its mu and lambda are always 0
+    static constexpr WireId kPaddingWire = 0;
+
+    FlatCircuit() { AddGate(GateType::kPadding, kPaddingWire, kPaddingWire); }
+
+    WireId AddGate(GateType type, WireId left, WireId right) {
+      if ( mType.size() == std::numeric_limits<WireId>::max() )
+	throw std::invalid_argument("Too many gates for 32-bit wire ids");
+      mType.emplace_back(type);
+      mLeft.emplace_back(left);
+      mRight.emplace_back(right);
+      return mType.size() - 1;
+    }
+
+    // Sets mMultGates and mLayerBegin from the topology. Every mult
+    // gets a layer between its multiplicative depth minus one (the
+    // earliest possible) and the latest layer that does not delay its
+    // consumers, so the number of layers is the multiplicative depth
+    // of the circuit. Within those bounds, the empty slots of the
+    // last batch of a layer are filled with mults that can be
+    // postponed no further than needed, which reduces padding
+    void AssignLayers();
+
+    // To be called once mMultGates, mLayerBegin, mInputGates and
+    // mOutputGates are set. Sorts the linear gates by level, forms the
+    // input and output batches and allocates the values
+    void Finalize();
+
+    // Hash of the topology and of the batches, which the preprocessing
+    // stored on disk is checked against
+    std::uint64_t Hash() const;
+
+    std::size_t NWires() const { return mType.size(); }
+    std::size_t NLayers() const { return mLayerBegin.size() - 1; }
+    std::size_t NMultBatches() const { return mLayerBegin.back(); }
+    std::size_t NInputBatches() const { return mInputBatchOwner.size(); }
+    std::size_t NOutputBatches() const { return mOutputBatchOwner.size(); }
+
+    // Topology
+    vec<GateType> mType;
+    vec<WireId> mLeft;
+    vec<WireId> mRight;
+
+    // Mult gates, by batch, and the first batch of each layer
+    std::size_t mBatchSize = 1;
+    vec<WireId> mMultGates;
+    vec<std::uint32_t> mLayerBegin{0};
+
+    // Input and output gates of client c are in
+    // [mInputBegin[c], mInputBegin[c+1]) (resp. output)
+    vec<WireId> mInputGates;
+    vec<std::uint32_t> mInputBegin{0};
+    vec<WireId> mOutputGates;
+    vec<std::uint32_t> mOutputBegin{0};
+
+    // Input batch b consists of mInputBatches[b*k .. (b+1)*k) and
+    // belongs to mInputBatchOwner[b] (resp. output). These are the
+    // gates of each client in chunks of k, the last one padded
+    vec<WireId> mInputBatches;
+    vec<std::uint32_t> mInputBatchOwner;
+    vec<WireId> mOutputBatches;
+    vec<std::uint32_t> mOutputBatchOwner;
+
+    // Linear gates (additions and outputs) grouped by level, that is,
+    // by the number of mult layers they depend on: the gates of level
+    // l are in [mLinearBegin[l], mLinearBegin[l+1]). Within a level
+    // they are in topological order
+    vec<WireId> mLinearGates;
+    vec<std::uint32_t> mLinearBegin;
+
+    // Per wire values
+    vec<FF> mMu;                  // mu = value - lambda, learned by P1
+    vec<std::uint8_t> mLearned;   // whether P1 learned mu
+    vec<FF> mLambda;              // lambda, known by the owner of the input/output
+    vec<FF> mValue;               // inputs and outputs, known by their owner
+
+    // Per mult batch: packed sharings of the preprocessing, and of the
+    // mu of the inputs received from P1
+    vec<FF> mShrLambdaA;
+    vec<FF> mShrLambdaB;
+    vec<FF> mShrDeltaC;
+    vec<FF> mShrMuA;
+    vec<FF> mShrMuB;
+
+    // Number of levels of linear gates P1 has evaluated
+    std::size_t mEvaluatedLevels = 0;
+  };
+
+} // namespace tp
+
+#endif  // FLAT_CIRCUIT_H
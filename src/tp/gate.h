@@ -54,6 +54,10 @@ namespace tp {
 
     bool IsPadding() { return mIsPadding; }
 
+    // Output wire of this gate in the flat circuit, for gates created
+    // by a Circuit
+    WireId GetWire() { return mWire; }
+
   protected:
     // Bool that indicates whether P1 learned Mu already
     bool mLearned = false;
@@ -86,8 +90,10 @@ namespace tp {
 
     bool mIsPadding = false;
 
+    WireId mWire = 0;
 
     friend class MultBatch;
+    friend class Circuit;
   };  
 
   class AddGate : public Gate {
@@ -82,8 +82,17 @@ namespace tp {
       if ( mID == mOwnerID ) mValue = input;
     }
 
+    // Input masked by lambda, which the owner sends to P1
+    FF GetMaskedValue() { return mValue - mLambda; }
+
     void OwnerSendsP1() {
-      if (mID == mOwnerID) mNetwork->Party(0)->Send(mValue - mLambda);
+      if (mID == mOwnerID) mNetwork->Party(0)->Send(GetMaskedValue());
+    }
+
+    // P1 sets the mu received from the owner
+    void SetMu(FF mu) {
+      mMu = mu;
+      mLearned = true;
     }
 
     void P1Receives() {
@@ -162,8 +171,7 @@ namespace tp {
 	lambda.Emplace(mInputGatesPtrs[i]->GetDummyLambda());
       }
       // Using deg = BatchSize-1 ensures there's no randomness involved
-      auto poly = scl::details::EvPolyFromSecretsAndDegree(lambda, mBatchSize-1, mPRG);
-      Vec shares = scl::details::SharesFromEvPoly(poly, mParties);
+      Vec shares = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1).Share(lambda, mPRG);
 
       mPackedShrLambda = shares[mID];
     }
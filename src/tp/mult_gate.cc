@@ -1,26 +1,60 @@
 #include "tp/mult_gate.h"
 
 namespace tp {
-  void MultBatch::P1Sends() {
-    if ( mID == 0 ) {
+  void MultBatch::P1ComputeShares(Vec& shares_A, Vec& shares_B) {
+    // 1. P1 assembles mu_A and mu_B
+
+    Vec mu_alpha;
+    Vec mu_beta;
+    mu_alpha.Reserve(mBatchSize);
+    mu_beta.Reserve(mBatchSize);
+    // Here is where the permutation happens!
+    for (auto gate : mMultGatesPtrs) {
+      mu_alpha.Emplace(gate->GetLeft()->GetMu());
+      mu_beta.Emplace(gate->GetRight()->GetMu());
+    }
 
-      // 1. P1 assembles mu_A and mu_B
+    // 2. P1 generates shares of mu_A and mu_B
 
-      Vec mu_alpha;
-      Vec mu_beta;
-      // Here is where the permutation happens!
-      for (auto gate : mMultGatesPtrs) {
-	mu_alpha.Emplace(gate->GetLeft()->GetMu());
-	mu_beta.Emplace(gate->GetRight()->GetMu());
-      }
-      
-      // 2. P1 generates shares of mu_A and mu_B
-      
-      auto poly_A = scl::details::EvPolyFromSecretsAndDegree(mu_alpha, mBatchSize-1, mPRG);
-      Vec shares_A = scl::details::SharesFromEvPoly(poly_A, mParties);
+    auto& plan = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1);
+    shares_A = plan.Share(mu_alpha, mPRG);
+    shares_B = plan.Share(mu_beta, mPRG);
+  }
+
+  FF MultBatch::ComputeShrMuC() {
+    return mPackedShrMuB * mPackedShrLambdaA + mPackedShrMuA * mPackedShrLambdaB + \
+      mPackedShrMuA * mPackedShrMuB + mPackedShrDeltaC;
+  }
+
+  void MultBatch::P1SetMuFromShares(const Vec& shares) {
+    Vec mu_gamma = SharingPlan::Get(mParties, mBatchSize, mParties-1).Reconstruct(shares);
+
+    // P1 updates the mu for the gates in the current batch
+    for (std::size_t i = 0; i < mBatchSize; i++) {
+      mMultGatesPtrs[i]->mMu = mu_gamma[i];
+      mMultGatesPtrs[i]->mLearned = true;
+    }
+  }
+
+  void MultBatch::P1CollectMus(scl::Mat<FF>& mus, std::size_t col_A, std::size_t col_B) {
+    for (std::size_t i = 0; i < mBatchSize; i++) {
+      mus(i, col_A) = mMultGatesPtrs[i]->GetLeft()->GetMu();
+      mus(i, col_B) = mMultGatesPtrs[i]->GetRight()->GetMu();
+    }
+  }
 
-      auto poly_B = scl::details::EvPolyFromSecretsAndDegree(mu_beta, mBatchSize-1, mPRG);
-      Vec shares_B = scl::details::SharesFromEvPoly(poly_B, mParties);
+  void MultBatch::P1SetMu(const scl::Mat<FF>& mus, std::size_t col) {
+    for (std::size_t i = 0; i < mBatchSize; i++) {
+      mMultGatesPtrs[i]->mMu = mus(i, col);
+      mMultGatesPtrs[i]->mLearned = true;
+    }
+  }
+
+  void MultBatch::P1Sends() {
+    if ( mID == 0 ) {
+      Vec shares_A;
+      Vec shares_B;
+      P1ComputeShares(shares_A, shares_B);
 
       // 3. P1 sends the shares
 
@@ -38,38 +72,75 @@ namespace tp {
       mNetwork->Party(0)->Recv(shr_mu_A);
       mNetwork->Party(0)->Recv(shr_mu_B);
 
-      mPackedShrMuA = shr_mu_A;
-      mPackedShrMuB = shr_mu_B;
+      SetPackedShrsMu(shr_mu_A, shr_mu_B);
     }
 
   void MultBatch::PartiesSend() {
-      // Compute share
-      FF shr_mu_C;
-      shr_mu_C = mPackedShrMuB * mPackedShrLambdaA + mPackedShrMuA * mPackedShrLambdaB + \
-	mPackedShrMuA * mPackedShrMuB + mPackedShrDeltaC;
-
-      // Send to P1
-      mNetwork->Party(0)->Send(shr_mu_C); 
+      // Compute share and send to P1
+      mNetwork->Party(0)->Send(ComputeShrMuC());
     }
 
   void MultBatch::P1Receives() {
       if (mID == 0) {
-	Vec mu_gamma;
 	Vec shares;
 	for (std::size_t i = 0; i < mParties; ++i) {
 	  FF shr_mu_C;
 	  mNetwork->Party(i)->Recv(shr_mu_C);
 	  shares.Emplace(shr_mu_C);
 	}
-	mu_gamma = scl::details::SecretsFromSharesAndLength(shares, mBatchSize);
+	P1SetMuFromShares(shares);
+      }
+    }
 
-	// P1 updates the mu for the gates in the current batch
-	for (std::size_t i = 0; i < mBatchSize; i++) {
-	  mMultGatesPtrs[i]->mMu = mu_gamma[i];
-	  mMultGatesPtrs[i]->mLearned = true;
-	}
+  scl::Mat<FF> MultLayer::P1ComputeShares() {
+    // Column 2j (2j+1) holds mu_A (mu_B) of batch j
+    scl::Mat<FF> mus(mBatchSize, 2*mBatches.size());
+    for (std::size_t j = 0; j < mBatches.size(); ++j) {
+      mBatches[j]->P1CollectMus(mus, 2*j, 2*j+1);
+    }
+    return SharingPlan::Get(mParties, mBatchSize, mBatchSize-1).ShareMany(mus, mPRG);
+  }
+
+  void MultLayer::P1SetMuFromShares(const vec<vec<FF>>& shares) {
+    scl::Mat<FF> shares_mat(mParties, mBatches.size());
+    for (std::size_t i = 0; i < mParties; ++i) {
+      for (std::size_t j = 0; j < mBatches.size(); ++j) shares_mat(i, j) = shares[i][j];
+    }
+    auto mus = SharingPlan::Get(mParties, mBatchSize, mParties-1).ReconstructMany(shares_mat);
+    for (std::size_t j = 0; j < mBatches.size(); ++j) mBatches[j]->P1SetMu(mus, j);
+  }
+
+  void MultLayer::P1Sends() {
+    if ( mID == 0 ) {
+      auto shares = P1ComputeShares();
+      vec<vec<FF>> buffers(mParties);
+      for (std::size_t i = 0; i < mParties; ++i) {
+	buffers[i].reserve(shares.Cols());
+	for (std::size_t j = 0; j < shares.Cols(); ++j) buffers[i].emplace_back(shares(i, j));
       }
+      SendToParties(mNetwork, buffers);
     }
-    
+  }
+
+  void MultLayer::PartiesReceive() {
+    vec<FF> buffer(2*mBatches.size());
+    mNetwork->Party(0)->Recv(buffer);
+    for (std::size_t j = 0; j < mBatches.size(); ++j) {
+      mBatches[j]->SetPackedShrsMu(buffer[2*j], buffer[2*j+1]);
+    }
+  }
+
+  void MultLayer::PartiesSend() {
+    vec<FF> buffer;
+    buffer.reserve(mBatches.size());
+    for (auto& batch : mBatches) buffer.emplace_back(batch->ComputeShrMuC());
+    mNetwork->Party(0)->Send(buffer);
+  }
+
+  void MultLayer::P1Receives() {
+    if ( mID == 0 ) {
+      P1SetMuFromShares(RecvFromParties(mNetwork, mBatches.size()));
+    }
+  }
+
 } // namespace tp
-  
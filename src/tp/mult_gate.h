@@ -181,6 +181,32 @@ namespace tp {
       P1Receives();
     }
 
+    // Local parts of the steps above. These do not communicate, so
+    // that MultLayer can gather the messages of all its batches into
+    // a single buffer per party
+
+    // P1 computes the packed shares of the mu of the inputs
+    void P1ComputeShares(Vec& shares_A, Vec& shares_B);
+
+    // Stores the packed shares of the mu's received from P1
+    void SetPackedShrsMu(FF shr_mu_A, FF shr_mu_B) {
+      mPackedShrMuA = shr_mu_A;
+      mPackedShrMuB = shr_mu_B;
+    }
+
+    // Computes the share of mu_gamma that is sent back to P1
+    FF ComputeShrMuC();
+
+    // P1 reconstructs the mu of the outputs from the received shares
+    void P1SetMuFromShares(const Vec& shares);
+
+    // Column-wise versions of the above, used by MultLayer to share
+    // and reconstruct all its batches with one matrix product. P1
+    // writes the mu of the inputs to columns col_A and col_B of mus,
+    // and sets the mu of the outputs from column col of mus
+    void P1CollectMus(scl::Mat<FF>& mus, std::size_t col_A, std::size_t col_B);
+    void P1SetMu(const scl::Mat<FF>& mus, std::size_t col);
+
     void SetPreprocessing(FF shr_lambda_A, FF shr_lambda_B, FF shr_delta_C) {
       mPackedShrLambdaA = shr_lambda_A;
       mPackedShrLambdaB = shr_lambda_B;
@@ -277,11 +303,22 @@ namespace tp {
       for (auto batch : mBatches) batch->SetNetwork(network, id);
     }
 
-    // For testing purposes, to avoid blocking
-    void P1Sends() { for (auto batch : mBatches) batch->P1Sends(); }
-    void PartiesReceive() { for (auto batch : mBatches) batch->PartiesReceive(); }
-    void PartiesSend() { for (auto batch : mBatches) batch->PartiesSend(); }
-    void P1Receives() { for (auto batch : mBatches) batch->P1Receives(); }
+    // P1 computes the packed shares of the mu of the inputs of all
+    // the batches at once. Row i is the message for party i, holding
+    // the shares of mu_A and mu_B of each batch, interleaved
+    scl::Mat<FF> P1ComputeShares();
+
+    // P1 reconstructs the mu of the outputs of all the batches at
+    // once. shares[i] holds the share of party i for each batch
+    void P1SetMuFromShares(const vec<vec<FF>>& shares);
+
+    // Same steps as in MultBatch, but each party sends a single
+    // message per peer carrying the data of all the batches in the
+    // layer
+    void P1Sends();
+    void PartiesReceive();
+    void PartiesSend();
+    void P1Receives();
     
     // Metrics
     std::size_t GetSize() { return mBatches.size(); }
@@ -294,6 +331,7 @@ namespace tp {
     std::shared_ptr<scl::Network> mNetwork;
     std::size_t mID;
     std::size_t mParties;
+    scl::PRG mPRG;
 
     friend class Circuit;
   };
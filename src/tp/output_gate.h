@@ -99,10 +99,13 @@ namespace tp {
       if ( mID == mOwnerID ) {
 	FF mu;
 	mNetwork->Party(0)->Recv(mu);
-	mValue = mLambda + mu;
+	SetValueFromMu(mu);
       }
     }
 
+    // The owner unmasks mu to obtain the final value
+    void SetValueFromMu(FF mu) { mValue = mLambda + mu; }
+
     FF GetValue () { return mValue; }
 
   private:
@@ -117,6 +120,8 @@ namespace tp {
     // Protocol-specific
     FF mLambda; // Lambda, learned by owner
     FF mValue;  // The value the owner will obtain as a result
+
+    friend class Circuit;
   };
 
   // Used for padding batched outputs
@@ -173,8 +178,7 @@ namespace tp {
 	lambda.Emplace(mOutputGatesPtrs[i]->GetDummyLambda());
       }
       // Using deg = BatchSize-1 ensures there's no randomness involved
-      auto poly = scl::details::EvPolyFromSecretsAndDegree(lambda, mBatchSize-1, mPRG);
-      Vec shares = scl::details::SharesFromEvPoly(poly, mParties);
+      Vec shares = SharingPlan::Get(mParties, mBatchSize, mBatchSize-1).Share(lambda, mPRG);
 
       mPackedShrLambda = shares[mID];	
     }
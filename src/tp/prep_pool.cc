@@ -0,0 +1,76 @@
+#include "tp/prep_pool.h"
+
+namespace tp {
+  PrepPool::PrepPool(Correlator& correlator, std::shared_ptr<scl::Network> network, std::size_t id,
+		     std::size_t capacity, scl::PRG prg) :
+    mProducer(correlator.Fork(network, prg)), mNetwork(network), mID(id), mCapacity(capacity) {
+    if ( mCapacity == 0 )
+      throw std::invalid_argument("The pool must have room for at least one preprocessing");
+    mThread = std::thread(&PrepPool::Produce, this);
+  }
+
+  void PrepPool::Produce() {
+    try {
+      while ( true ) {
+	bool go;
+	{
+	  std::unique_lock<std::mutex> lock(mMutex);
+	  mHasRoom.wait(lock, [this]() { return mStop || mPool.size() < mCapacity; });
+	  go = !mStop;
+	}
+
+	// Party 0 decides for everyone
+	if ( mID == 0 ) {
+	  for (std::size_t i = 1; i < mNetwork->Size(); i++) mNetwork->Party(i)->Send(go);
+	} else {
+	  mNetwork->Party(0)->Recv(go);
+	}
+	if ( !go ) break;
+
+	auto prep = mProducer.GenFIPrep();
+	{
+	  std::lock_guard<std::mutex> lock(mMutex);
+	  mPool.emplace_back(std::move(prep));
+	}
+	mHasPrep.notify_one();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mError = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mDone = true;
+    }
+    mHasPrep.notify_all();
+  }
+
+  FIPrep PrepPool::Take() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mHasPrep.wait(lock, [this]() { return !mPool.empty() || mDone; });
+    if ( mPool.empty() ) {
+      if ( mError ) std::rethrow_exception(mError);
+      throw std::invalid_argument("The pool is empty and stopped");
+    }
+    auto prep = std::move(mPool.front());
+    mPool.pop_front();
+    lock.unlock();
+    mHasRoom.notify_one();
+    return prep;
+  }
+
+  std::size_t PrepPool::Size() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPool.size();
+  }
+
+  void PrepPool::Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mHasRoom.notify_all();
+    if ( mThread.joinable() ) mThread.join();
+  }
+
+} // namespace tp
@@ -0,0 +1,68 @@
+#ifndef PREP_POOL_H
+#define PREP_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "correlator.h"
+
+namespace tp {
+  // A thread that keeps running the F.I. preprocessing of a circuit,
+  // over channels of its own, and stores the results in a pool of
+  // bounded size. This way repeated evaluations of the same circuit
+  // only wait for the F.D. preprocessing and the online phase, and
+  // the time in between evaluations is used to refill the pool.
+  //
+  // The pools of all the parties run the same protocol, so they must
+  // produce the same number of runs, and be taken from in the same
+  // order. Party 0 decides, before every run, whether to carry on,
+  // and tells the others over the channels of the pool
+  class PrepPool {
+  public:
+    // Starts producing with a fork of correlator (see
+    // Correlator::Fork) over network, which connects the same parties
+    // as the network of the correlator, but through other channels
+    PrepPool(Correlator& correlator, std::shared_ptr<scl::Network> network, std::size_t id,
+	     std::size_t capacity, scl::PRG prg);
+    ~PrepPool() { Stop(); }
+
+    PrepPool(const PrepPool&) = delete;
+    PrepPool& operator=(const PrepPool&) = delete;
+
+    // Takes the oldest F.I. preprocessing out of the pool, waiting
+    // for one if the pool is empty. Rethrows the exception that
+    // stopped the producer, if any
+    FIPrep Take();
+
+    // Number of F.I. preprocessings in the pool
+    std::size_t Size();
+
+    // Stops producing and returns once the producer is done. For
+    // party 0 this is right after the current run, and for the rest
+    // once party 0 stops too. What is in the pool can still be taken
+    void Stop();
+
+  private:
+    void Produce();
+
+    Correlator mProducer;
+    std::shared_ptr<scl::Network> mNetwork;
+    std::size_t mID;
+    std::size_t mCapacity;
+
+    std::deque<FIPrep> mPool;
+    std::mutex mMutex;
+    std::condition_variable mHasRoom;
+    std::condition_variable mHasPrep;
+    bool mStop = false;
+    bool mDone = false;
+    std::exception_ptr mError;
+    std::thread mThread;
+  };
+
+} // namespace tp
+
+#endif  // PREP_POOL_H
@@ -0,0 +1,104 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tp/prep_store.h"
+
+namespace tp {
+  namespace {
+    constexpr char kMagic[8] = {'T', 'P', 'P', 'R', 'E', 'P', '\0', '\0'};
+
+    // Sections start right after the header, and must be aligned
+    static_assert(sizeof(PrepHeader) % alignof(FF) == 0);
+  } // namespace
+
+  PrepWriter::PrepWriter(const std::string& path, const PrepHeader& header) :
+    mPath(path), mFile(path, std::ios::binary | std::ios::trunc), mHeader(header) {
+    if ( !mFile )
+      throw std::runtime_error("Cannot open " + path + " for writing");
+    std::memcpy(mHeader.mMagic, kMagic, sizeof(kMagic));
+
+    // Left without its magic until Close
+    PrepHeader incomplete = mHeader;
+    std::memset(incomplete.mMagic, 0, sizeof(incomplete.mMagic));
+    mFile.write(reinterpret_cast<const char*>(&incomplete), sizeof(incomplete));
+  }
+
+  void PrepWriter::Write(const FF* data, std::size_t n) {
+    if ( mWritten + n > mHeader.NElements() )
+      throw std::invalid_argument("Writing more elements than the header of " + mPath + " declares");
+    mFile.write(reinterpret_cast<const char*>(data), n * sizeof(FF));
+    mWritten += n;
+  }
+
+  void PrepWriter::Close() {
+    if ( mWritten != mHeader.NElements() )
+      throw std::invalid_argument("Closing " + mPath + " before writing all of its sections");
+    mFile.seekp(0);
+    mFile.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+    mFile.close();
+    if ( !mFile )
+      throw std::runtime_error("Error writing " + mPath);
+  }
+
+  PrepFile::PrepFile(const std::string& path, PrepKind kind) : mPath(path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 )
+      throw std::runtime_error("Cannot open " + path);
+    struct stat st;
+    if ( fstat(fd, &st) < 0 ) {
+      close(fd);
+      throw std::runtime_error("Cannot stat " + path);
+    }
+    mSize = st.st_size;
+    if ( mSize < sizeof(PrepHeader) ) {
+      close(fd);
+      throw std::invalid_argument(path + " is not a preprocessing file");
+    }
+    mData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( mData == MAP_FAILED ) {
+      mData = nullptr;
+      throw std::runtime_error("Cannot map " + path);
+    }
+
+    // From here on the destructor does not run if we throw
+    mHeader = static_cast<const PrepHeader*>(mData);
+    std::string error;
+    if ( std::memcmp(mHeader->mMagic, kMagic, sizeof(kMagic)) != 0 )
+      error = " is not a complete preprocessing file";
+    else if ( mHeader->mVersion != kPrepVersion )
+      error = " has version " + std::to_string(mHeader->mVersion) + ", expected " + std::to_string(kPrepVersion);
+    else if ( mHeader->mByteOrder != PrepHeader().mByteOrder )
+      error = " was written on a machine of another endianness";
+    else if ( mHeader->mKind != static_cast<std::uint32_t>(kind) )
+      error = " holds another kind of preprocessing";
+    else if ( mSize != sizeof(PrepHeader) + mHeader->NElements() * sizeof(FF) )
+      error = " does not match the sizes in its header";
+    if ( !error.empty() ) {
+      munmap(mData, mSize);
+      throw std::invalid_argument(path + error);
+    }
+
+    auto section = reinterpret_cast<const FF*>(static_cast<const char*>(mData) + sizeof(PrepHeader));
+    for (std::size_t s = 0; s < kMaxPrepSections; s++) {
+      mSections[s] = section;
+      section += mHeader->mSectionSize[s];
+    }
+  }
+
+  PrepFile::~PrepFile() {
+    if ( mData ) munmap(mData, mSize);
+  }
+
+  void PrepFile::Check(std::size_t parties, std::size_t id, std::size_t batch_size) const {
+    if ( mHeader->mParties != parties || mHeader->mID != id || mHeader->mBatchSize != batch_size )
+      throw std::invalid_argument(mPath + " was written for party " + std::to_string(mHeader->mID) + " of " + \
+				  std::to_string(mHeader->mParties) + " with k = " + std::to_string(mHeader->mBatchSize));
+  }
+
+} // namespace tp
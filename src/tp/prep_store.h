@@ -0,0 +1,122 @@
+#ifndef PREP_STORE_H
+#define PREP_STORE_H
+
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+#include "tp.h"
+
+namespace tp {
+  // The preprocessing of a party can be written to disk, so that the
+  // offline and online phases run in different processes. A file is
+  // a PrepHeader followed by its sections, in order, each a flat
+  // array of field elements in their in-memory representation. This
+  // way a file is read by mapping it, without parsing
+  static_assert(sizeof(FF) == sizeof(std::uint64_t) && std::is_trivially_copyable_v<FF>,
+		"The preprocessing is stored as raw field elements");
+
+  // Bumped whenever the layout of the files changes
+  constexpr std::uint32_t kPrepVersion = 1;
+
+  // F.I. files hold the output of the F.I. preprocessing, that is,
+  // what the Correlator holds after the GenProd steps. F.D. files
+  // hold what the online phase needs
+  enum class PrepKind : std::uint32_t { kFunctionIndependent = 1, kFunctionDependent = 2 };
+
+  // Sections of a F.I. file
+  enum FIPrepSection : std::size_t {
+    kIndShrs,           // individual sharings
+    kMultBatchFIPrep,   // MultBatchFIPrep of each mult batch, 6 elements each
+    kIOBatchFIPrep,     // IOBatchFIPrep of each input/output batch
+  };
+
+  // Sections of a F.D. file
+  enum FDPrepSection : std::size_t {
+    kShrLambdaA,        // packed sharings of each mult batch
+    kShrLambdaB,
+    kShrDeltaC,
+    kOwnedLambdas,      // lambdas of the k wires of each input/output
+			// batch the party owns, inputs first
+  };
+
+  constexpr std::size_t kMaxPrepSections = 4;
+
+  struct PrepHeader {
+    char mMagic[8];
+    std::uint32_t mVersion = kPrepVersion;
+    std::uint32_t mKind;
+    // Checks that the file was written on a machine of the same
+    // endianness
+    std::uint64_t mByteOrder = 0x0102030405060708;
+
+    std::uint64_t mParties;
+    std::uint64_t mThreshold;
+    std::uint64_t mBatchSize;
+    std::uint64_t mID;
+    // FlatCircuit::Hash of the circuit, for F.D. files. F.I. files do
+    // not depend on the circuit beyond the section sizes, and have 0
+    std::uint64_t mCircuitHash = 0;
+
+    // Number of elements of each section
+    std::uint64_t mSectionSize[kMaxPrepSections] = {};
+
+    std::size_t NElements() const {
+      std::size_t sum(0);
+      for (auto size : mSectionSize) sum += size;
+      return sum;
+    }
+  };
+
+  // Writes a file in one pass: the sections are written in order,
+  // possibly in pieces, and their sizes must be known beforehand. The
+  // header is only completed by Close, so a file that was not fully
+  // written cannot be opened
+  class PrepWriter {
+  public:
+    PrepWriter(const std::string& path, const PrepHeader& header);
+
+    void Write(const FF* data, std::size_t n);
+    void Write(const vec<FF>& data) { Write(data.data(), data.size()); }
+
+    // Checks that all the sections were written and flushes the file
+    void Close();
+
+  private:
+    std::string mPath;
+    std::ofstream mFile;
+    PrepHeader mHeader;
+    std::size_t mWritten = 0;
+  };
+
+  // A file mapped read-only. The sections point into the mapping, so
+  // they are valid as long as the PrepFile is
+  class PrepFile {
+  public:
+    // Maps the file at path, and checks that it is complete, of this
+    // version and of the given kind
+    PrepFile(const std::string& path, PrepKind kind);
+    ~PrepFile();
+
+    PrepFile(const PrepFile&) = delete;
+    PrepFile& operator=(const PrepFile&) = delete;
+
+    const PrepHeader& Header() const { return *mHeader; }
+
+    // Checks the header against the setting the file is loaded into
+    void Check(std::size_t parties, std::size_t id, std::size_t batch_size) const;
+
+    const FF* Section(std::size_t section) const { return mSections[section]; }
+    std::size_t SectionSize(std::size_t section) const { return mHeader->mSectionSize[section]; }
+
+  private:
+    std::string mPath;
+    void* mData = nullptr;
+    std::size_t mSize = 0;
+    const PrepHeader* mHeader;
+    const FF* mSections[kMaxPrepSections];
+  };
+
+} // namespace tp
+
+#endif  // PREP_STORE_H
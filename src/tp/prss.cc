@@ -0,0 +1,127 @@
+#include <random>
+
+#include "tp/prss.h"
+
+namespace tp {
+  PRSS::PRSS(std::size_t parties, std::size_t id, std::size_t subset_size) :
+    mParties(parties), mID(id), mSubsetSize(subset_size) {
+    if ( subset_size == 0 || subset_size > parties )
+      throw std::invalid_argument("subset size must be in [1, n]");
+    if ( id >= parties )
+      throw std::invalid_argument("ID cannot be larger than number of parties");
+
+    // Enumerate the subsets in lexicographic order, keeping the ones
+    // that contain mID
+    vec<std::size_t> subset(subset_size);
+    for (std::size_t i = 0; i < subset_size; ++i) subset[i] = i;
+    while ( true ) {
+      for (auto j : subset) {
+	if ( j == mID ) {
+	  mSubsets.emplace_back(subset);
+	  break;
+	}
+      }
+      // Advance to the next subset
+      std::size_t i = subset_size;
+      while ( i > 0 && subset[i-1] == parties - subset_size + (i-1) ) i--;
+      if ( i == 0 ) break;
+      subset[i-1]++;
+      for (std::size_t j = i; j < subset_size; ++j) subset[j] = subset[j-1] + 1;
+    }
+
+    // Shares are the evaluations at x_j = j+1
+    mCoefficients.reserve(mSubsets.size());
+    for (auto& s : mSubsets) {
+      FF coefficient(1);
+      std::size_t next(0);
+      for (std::size_t j = 0; j < mParties; ++j) {
+	if ( next < s.size() && s[next] == j ) {
+	  next++;
+	  continue;
+	}
+	coefficient *= FF(mID) - FF(j);
+      }
+      mCoefficients.emplace_back(coefficient);
+    }
+
+    mPRGs.resize(mSubsets.size());
+  }
+
+  scl::PRG PRSS::FromEntropy() {
+    std::random_device device;
+    unsigned char seed[scl::PRG::SeedSize()];
+    for (std::size_t i = 0; i < sizeof(seed); ++i) seed[i] = device();
+    return scl::PRG(seed);
+  }
+
+  void PRSS::SetupSend(std::shared_ptr<scl::Network> network, scl::PRG& prg) {
+    vec<vec<unsigned char>> buffers(mParties);
+    for (std::size_t idx = 0; idx < mSubsets.size(); ++idx) {
+      if ( mSubsets[idx][0] != mID ) continue;
+      unsigned char seed[scl::PRG::SeedSize()];
+      prg.Next(seed, scl::PRG::SeedSize());
+      mPRGs[idx] = scl::PRG(seed);
+      for (auto j : mSubsets[idx]) {
+	if ( j != mID ) buffers[j].insert(buffers[j].end(), seed, seed + scl::PRG::SeedSize());
+      }
+    }
+    for (std::size_t j = 0; j < mParties; ++j) {
+      if ( !buffers[j].empty() ) network->Party(j)->Send(buffers[j]);
+    }
+  }
+
+  void PRSS::SetupRecv(std::shared_ptr<scl::Network> network) {
+    // Party j sends the seeds of the subsets it leads, in the same
+    // order as they appear in mSubsets
+    vec<std::size_t> n_seeds(mParties, 0);
+    for (auto& s : mSubsets) {
+      if ( s[0] != mID ) n_seeds[s[0]]++;
+    }
+
+    vec<vec<unsigned char>> recv(mParties);
+    for (std::size_t j = 0; j < mParties; ++j) {
+      if ( n_seeds[j] == 0 ) continue;
+      recv[j].resize(n_seeds[j] * scl::PRG::SeedSize());
+      network->Party(j)->Recv(recv[j]);
+    }
+
+    vec<std::size_t> offsets(mParties, 0);
+    for (std::size_t idx = 0; idx < mSubsets.size(); ++idx) {
+      auto leader = mSubsets[idx][0];
+      if ( leader == mID ) continue;
+      mPRGs[idx] = scl::PRG(recv[leader].data() + offsets[leader]);
+      offsets[leader] += scl::PRG::SeedSize();
+    }
+  }
+
+  PRSS PRSS::Fork() {
+    PRSS fork(*this);
+    for (std::size_t idx = 0; idx < mPRGs.size(); ++idx) {
+      unsigned char seed[scl::PRG::SeedSize()];
+      mPRGs[idx].Next(seed, scl::PRG::SeedSize());
+      fork.mPRGs[idx] = scl::PRG(seed);
+    }
+    return fork;
+  }
+
+  vec<FF> PRSS::Next(const vec<FF>& zeros, std::size_t n_sharings) {
+    vec<FF> shares(n_sharings);
+    if ( n_sharings == 0 ) return shares;
+
+    FF vanishing(1);
+    for (auto& z : zeros) vanishing *= FF(mID + 1) - z;
+
+    vec<unsigned char> bytes(n_sharings * FF::ByteSize());
+    vec<FF> randoms(n_sharings);
+    for (std::size_t idx = 0; idx < mSubsets.size(); ++idx) {
+      mPRGs[idx].Next(bytes.data(), bytes.size());
+      for (std::size_t c = 0; c < n_sharings; ++c) {
+	randoms[c] = FF::Read(bytes.data() + c * FF::ByteSize());
+      }
+      scl::details::MultiplyAccumulateMany(shares.data(), vanishing * mCoefficients[idx],
+					   randoms.data(), n_sharings);
+    }
+    return shares;
+  }
+
+} // namespace tp
@@ -0,0 +1,72 @@
+#ifndef PRSS_H
+#define PRSS_H
+
+#include "tp.h"
+
+namespace tp {
+  // Pseudorandom secret sharing in the style of Cramer, Damgard and
+  // Ishai. Every subset S of mSubsetSize parties shares a PRG seed,
+  // agreed once at setup. The c-th sharing is then
+  //
+  //   f(X) = sum_S r_S(c) * prod_{z in zeros} (X - z) * prod_{j not in S} (X - x_j)
+  //
+  // with r_S(c) the c-th output of the PRG of S, so every party
+  // computes its share f(x_i) locally from the seeds of the subsets
+  // it belongs to. The sharings have degree n - |S| + |zeros| and
+  // vanish at the given zero points. In particular:
+  //  - |S| = n - t and no zeros gives random degree-t sharings (PRSS)
+  //  - |S| = |zeros| + 1 gives degree-(n-1) sharings of zero (PRZS)
+  // As long as there are at least |S| honest parties, the subsets
+  // made only of honest parties make the sharings look fresh.
+  //
+  // The cost is one PRG output per subset containing the party, that
+  // is, binom(n-1, |S|-1) per sharing, so this only pays off for
+  // small and medium n
+  class PRSS {
+  public:
+    PRSS() {}
+
+    PRSS(std::size_t parties, std::size_t id, std::size_t subset_size);
+
+    // A PRG seeded from the entropy of the OS. The seeds of the
+    // subsets must be secret to the parties outside of them, so they
+    // cannot come from a PRG with a fixed or shared seed
+    static scl::PRG FromEntropy();
+
+    // Every seed is sampled by the first member of its subset and
+    // sent to the rest of the subset, in a single message per peer
+    void SetupSend(std::shared_ptr<scl::Network> network, scl::PRG& prg);
+    void SetupRecv(std::shared_ptr<scl::Network> network);
+
+    // Shares of the next n_sharings sharings, which vanish at zeros
+    vec<FF> Next(const vec<FF>& zeros, std::size_t n_sharings);
+
+    // A PRSS of the same subsets, with the PRG of each subset seeded
+    // from the next output of the PRG of that subset here. If all the
+    // parties fork at the same point, the forks agree with each other,
+    // and their sharings are independent of those that follow here
+    PRSS Fork();
+
+    std::size_t Degree(std::size_t n_zeros) const { return mParties - mSubsetSize + n_zeros; }
+
+    std::size_t NSubsets() const { return mSubsets.size(); }
+
+  private:
+    std::size_t mParties;
+    std::size_t mID;
+    std::size_t mSubsetSize;
+
+    // The subsets containing mID, sorted, in lexicographic order.
+    // Both ends of the setup traverse them in this order
+    vec<vec<std::size_t>> mSubsets;
+
+    // prod_{j not in S} (x_id - x_j), per subset
+    vec<FF> mCoefficients;
+
+    // PRG of each subset
+    vec<scl::PRG> mPRGs;
+  };
+
+} // namespace tp
+
+#endif  // PRSS_H
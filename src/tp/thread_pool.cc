@@ -0,0 +1,30 @@
+#include "tp/thread_pool.h"
+
+namespace tp {
+  ThreadPool::ThreadPool(std::size_t n_threads) {
+    for (std::size_t i = 1; i < n_threads; i++) mWorkers.emplace_back([this]() { Work(); });
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mHasTask.notify_all();
+    for (auto& worker : mWorkers) worker.join();
+  }
+
+  void ThreadPool::Work() {
+    while ( true ) {
+      std::function<void()> task;
+      {
+	std::unique_lock<std::mutex> lock(mMutex);
+	mHasTask.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+	if ( mTasks.empty() ) return;
+	task = std::move(mTasks.front());
+	mTasks.pop_front();
+      }
+      task();
+    }
+  }
+} // namespace tp
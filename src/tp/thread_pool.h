@@ -0,0 +1,95 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tp {
+  // Fewest batches worth handing to another thread. Below this, the
+  // hand-off costs more than the work
+  constexpr std::size_t kMinBatchesPerThread = 32;
+
+  // A fixed set of worker threads for the local computation of P1,
+  // such as reconstructing and resharing all the batches of a
+  // layer. The calling thread takes part in every ParallelFor, so a
+  // pool of size 1 has no workers and runs everything inline. The
+  // pool never touches the network: the caller receives, hands the
+  // data to ParallelFor, and sends once it returns
+  class ThreadPool {
+  public:
+    ThreadPool(std::size_t n_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads working on a ParallelFor, counting the caller
+    std::size_t Size() const { return mWorkers.size() + 1; }
+
+    // Calls f(begin, end) on disjoint ranges that cover [0, n), in
+    // parallel, and returns once all of them are done. Ranges hold at
+    // least min_range items, so that small loops stay on the caller.
+    // The first exception thrown by f is rethrown
+    template <typename F>
+    void ParallelFor(std::size_t n, F f, std::size_t min_range = 1);
+
+  private:
+    void Work();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mHasTask;
+    bool mStop = false;
+  };
+
+  template <typename F>
+  void ThreadPool::ParallelFor(std::size_t n, F f, std::size_t min_range) {
+    std::size_t n_ranges = std::min(Size(), n / std::max<std::size_t>(min_range, 1));
+    if ( n_ranges <= 1 ) {
+      if ( n > 0 ) f(0, n);
+      return;
+    }
+
+    // Range r is [r*n/n_ranges, (r+1)*n/n_ranges)
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t pending = n_ranges - 1;
+    std::exception_ptr error;
+    auto run = [&](std::size_t r) {
+      try {
+	f(r * n / n_ranges, (r + 1) * n / n_ranges);
+      } catch (...) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if ( !error ) error = std::current_exception();
+      }
+    };
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (std::size_t r = 1; r < n_ranges; r++) {
+	mTasks.emplace_back([&, r]() {
+	  run(r);
+	  std::lock_guard<std::mutex> lock(mutex);
+	  if ( --pending == 0 ) done.notify_one();
+	});
+      }
+    }
+    mHasTask.notify_all();
+
+    run(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return pending == 0; });
+    if ( error ) std::rethrow_exception(error);
+  }
+
+} // namespace tp
+
+#endif  // THREAD_POOL_H
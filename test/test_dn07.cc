@@ -1,10 +1,81 @@
 #include <catch2/catch.hpp>
+#include <functional>
 #include <iostream>
 
 #include "tp/dn07.h"
 
 #define PARTY for(std::size_t i = 0; i < n_parties; i++)
 
+namespace {
+  // Runs DN07, with the real preprocessing, on a generic circuit in
+  // which party 0 has two inputs and two outputs. setup runs on the
+  // circuit of every party before it is handed to DN07
+  void RunGeneric(std::size_t threshold, const std::function<void(tp::Circuit&)>& setup = {}) {
+    std::size_t batch_size = (threshold + 2)/2;
+    std::size_t n_parties = threshold + 2*(batch_size - 1) + 1;
+
+    tp::CircuitConfig config;
+    config.n_parties = n_parties;
+    config.inp_gates = std::vector<std::size_t>(n_parties, 0);
+    config.inp_gates[0] = 2;
+    config.out_gates = std::vector<std::size_t>(n_parties, 0);
+    config.out_gates[0] = 2;
+    config.width = 100;
+    config.depth = 3;
+    config.batch_size = batch_size;
+
+    auto networks = scl::Network::CreateFullInMemory(n_parties);
+
+    std::vector<tp::DN07> dn07es;
+    dn07es.reserve(n_parties);
+
+    PARTY {
+      auto c = tp::Circuit::FromConfig(config);
+      c.SetNetwork(std::make_shared<scl::Network>(networks[i]), i);
+      if ( setup ) setup(c);
+
+      tp::DN07 dn07(n_parties, threshold);
+      dn07.SetCircuit(c);
+   
+      dn07es.emplace_back(dn07);
+    }
+
+    // Prep
+    PARTY { dn07es[i].PrepPartiesSend(); }
+    PARTY { dn07es[i].PrepPartiesReceive(); }
+
+    // FD PREP
+    PARTY { dn07es[i].FDMapPrepToGates(); }
+    PARTY { dn07es[i].FDMultPartiesSendP1(); }
+    PARTY { dn07es[i].FDMultP1Receives(); }
+
+    // Set inputs
+    std::vector<tp::FF> inputs{tp::FF(0432432), tp::FF(54982)};
+    dn07es[0].GetCircuit().SetClearInputsFlat(inputs);
+    auto result = dn07es[0].GetCircuit().GetClearOutputsFlat();
+    dn07es[0].GetCircuit().SetInputs(inputs);
+
+    // Input protocol
+
+    PARTY { dn07es[i].InputPartiesSendOwners(); }
+    PARTY { dn07es[i].InputOwnersReceiveAndSendParties(); }
+    PARTY { dn07es[i].InputPartiesReceive(); }
+
+    // Multiplications
+    for (std::size_t layer = 0; layer < config.depth; layer++) {
+      PARTY { dn07es[i].MultPartiesSendP1(layer); }
+      PARTY { dn07es[i].MultP1ReceivesAndSendsParties(layer); }
+      PARTY { dn07es[i].MultPartiesReceive(layer); }
+    }
+    // Output protocol
+    PARTY { dn07es[i].OutputPartiesSendOwners(); }
+    PARTY { dn07es[i].OutputOwnersReceive(); }
+
+    // Check output
+    REQUIRE(dn07es[0].GetOutput(0,0) == result[0]);
+  }
+} // namespace
+
 TEST_CASE("DN07: Dummy FD") {
   SECTION("Hand-made Circuit")     {
     std::size_t threshold = 4; // has to be even
@@ -259,73 +330,11 @@ TEST_CASE("DN07: Real Prep") {
   }
 
   SECTION("Generic Circuit")     {
-    std::size_t threshold = 6; // has to be even
-    std::size_t batch_size = (threshold + 2)/2;
-    std::size_t n_parties = threshold + 2*(batch_size - 1) + 1;
-
-    tp::CircuitConfig config;
-    config.n_parties = n_parties;
-    config.inp_gates = std::vector<std::size_t>(n_parties, 0);
-    config.inp_gates[0] = 2;
-    config.out_gates = std::vector<std::size_t>(n_parties, 0);
-    config.out_gates[0] = 2;
-    config.width = 100;
-    config.depth = 3;
-    config.batch_size = batch_size;
-
-    auto networks = scl::Network::CreateFullInMemory(n_parties);
-
-    tp::FF prep(-5342891);
-
-    std::vector<tp::DN07> dn07es;
-    dn07es.reserve(n_parties);
-
-    PARTY {
-      auto c = tp::Circuit::FromConfig(config);
-      c.SetNetwork(std::make_shared<scl::Network>(networks[i]), i);
-
-      c.SetNetwork(std::make_shared<scl::Network>(networks[i]), i);
-
-      tp::DN07 dn07(n_parties, threshold);
-      dn07.SetCircuit(c);
-   
-      dn07es.emplace_back(dn07);
-    }
-
-    // Prep
-    PARTY { dn07es[i].PrepPartiesSend(); }
-    PARTY { dn07es[i].PrepPartiesReceive(); }
-
-    // FD PREP
-    PARTY { dn07es[i].FDMapPrepToGates(); }
-    PARTY { dn07es[i].FDMultPartiesSendP1(); }
-    PARTY { dn07es[i].FDMultP1Receives(); }
-
-    // Set inputs
-    std::vector<tp::FF> inputs{tp::FF(0432432), tp::FF(54982)};
-    dn07es[0].GetCircuit().SetClearInputsFlat(inputs);
-    auto result = dn07es[0].GetCircuit().GetClearOutputsFlat();
-    dn07es[0].GetCircuit().SetInputs(inputs);
-
-    // Input protocol
-
-    PARTY { dn07es[i].InputPartiesSendOwners(); }
-    PARTY { dn07es[i].InputOwnersReceiveAndSendParties(); }
-    PARTY { dn07es[i].InputPartiesReceive(); }
-
-    // Multiplications (there is only one layer)
-    
-    for (std::size_t layer = 0; layer < config.depth; layer++) {
-      PARTY { dn07es[i].MultPartiesSendP1(layer); }
-      PARTY { dn07es[i].MultP1ReceivesAndSendsParties(layer); }
-      PARTY { dn07es[i].MultPartiesReceive(layer); }
-    }
-    // Output protocol
-    PARTY { dn07es[i].OutputPartiesSendOwners(); }
-    PARTY { dn07es[i].OutputOwnersReceive(); }
+    RunGeneric(6); // has to be even
+  }
 
-    // Check output
-    REQUIRE(dn07es[0].GetOutput(0,0) == result[0]);
+  SECTION("Rotating kings")     {
+    RunGeneric(6, [](tp::Circuit& c) { c.SetKingPolicy(tp::KingPolicy::kRotating); });
   }
 }
 
@@ -1,10 +1,110 @@
 #include <catch2/catch.hpp>
 #include <iostream>
+#include <filesystem>
+#include <functional>
+#include <thread>
 
 #include "tp/circuits.h"
 
 #define PARTY for(std::size_t i = 0; i < n_parties; i++)
 
+namespace {
+  using Circuits = std::vector<tp::Circuit>;
+
+  // Party 0 has two inputs and two outputs
+  tp::CircuitConfig GenericConfig(std::size_t n_parties, std::size_t batch_size,
+				  std::size_t width, std::size_t depth) {
+    tp::CircuitConfig config;
+    config.n_parties = n_parties;
+    config.inp_gates = std::vector<std::size_t>(n_parties, 0);
+    config.inp_gates[0] = 2;
+    config.out_gates = std::vector<std::size_t>(n_parties, 0);
+    config.out_gates[0] = 2;
+    config.width = width;
+    config.depth = depth;
+    config.batch_size = batch_size;
+    return config;
+  }
+
+  // A circuit of config per party, over in-memory networks, with a
+  // correlator of the given threshold. setup runs on every circuit
+  // right after
+  Circuits Setup(const tp::CircuitConfig& config, std::size_t threshold,
+		 const std::function<void(tp::Circuit&)>& setup = {}) {
+    std::size_t n_parties = config.n_parties;
+    auto networks = scl::Network::CreateFullInMemory(n_parties);
+
+    Circuits circuits;
+    circuits.reserve(n_parties);
+    PARTY {
+      auto c = tp::Circuit::FromConfig(config);
+      c.SetNetwork(std::make_shared<scl::Network>(networks[i]), i);
+      c.GenCorrelator();
+      c.SetThreshold(threshold);
+      if ( setup ) setup(c);
+      circuits.emplace_back(c);
+    }
+    return circuits;
+  }
+
+  // The F.I. preprocessing followed by the F.D. preprocessing
+  void Prep(Circuits& circuits) {
+    std::size_t n_parties = circuits.size();
+    PARTY { circuits[i].FIPrepSend(); }
+    PARTY { circuits[i].FIPrepRecv(); }
+    PARTY { circuits[i].GenProdPartiesSendP1(); }
+    PARTY { circuits[i].GenProdP1ReceivesAndSends(); }
+    PARTY { circuits[i].GenProdPartiesReceive(); }
+
+    PARTY { circuits[i].MapCorrToCircuit(); }
+
+    PARTY { circuits[i].PrepMultPartiesSendP1(); }
+    PARTY { circuits[i].PrepMultP1ReceivesAndSends(); }
+    PARTY { circuits[i].PrepMultPartiesReceive(); }
+    PARTY { circuits[i].PrepIOPartiesSendOwner(); }
+    PARTY { circuits[i].PrepIOOwnerReceives(); }
+  }
+
+  // The online phase on the inputs of party 0, checking the outputs
+  // of every party against the clear evaluation
+  void Online(Circuits& circuits, const tp::CircuitConfig& config, const std::vector<tp::FF>& inputs) {
+    std::size_t n_parties = circuits.size();
+
+    // The gates cache their clear values, so these are computed on a
+    // fresh circuit
+    auto clear = tp::Circuit::FromConfig(config);
+    clear.SetClearInputsFlat(inputs);
+    auto result = clear.GetClearOutputs();
+    circuits[0].SetInputs(inputs);
+
+    PARTY { circuits[i].InputOwnerSendsP1(); }
+    PARTY { circuits[i].InputP1Receives(); }
+
+    for (std::size_t layer = 0; layer < config.depth; layer++) {
+      PARTY { circuits[i].MultP1Sends(layer); }
+      PARTY { circuits[i].MultPartiesReceive(layer); }
+      PARTY { circuits[i].MultPartiesSend(layer); }
+      PARTY { circuits[i].MultP1Receives(layer); }
+    }
+
+    PARTY { circuits[i].OutputP1SendsMu(); }
+    PARTY { circuits[i].OutputOwnerReceivesMu(); }
+
+    PARTY { REQUIRE(circuits[i].GetOutputs() == result[i]); }
+  }
+
+  // The whole protocol: Setup, then prep in place of the
+  // preprocessing, then Online
+  Circuits RunProtocol(const tp::CircuitConfig& config, std::size_t threshold,
+		       const std::function<void(tp::Circuit&)>& setup = {},
+		       const std::function<void(Circuits&)>& prep = Prep) {
+    auto circuits = Setup(config, threshold, setup);
+    prep(circuits);
+    Online(circuits, config, {tp::FF(0432432), tp::FF(54982)});
+    return circuits;
+  }
+} // namespace
+
 TEST_CASE("Dummy FD") {
   SECTION("Correct result")    {
     tp::CircuitConfig config;
@@ -515,4 +615,180 @@ TEST_CASE("FD from Real FI") {
     // Check output
     REQUIRE(circuits[0].GetOutputs() == result);
   }  
+
+  SECTION("Threshold and packing factor") {
+    // n = 9 admits t = 4, k = 3, but a smaller t allows a larger k
+    std::size_t n_parties = 9;
+    std::vector<std::pair<std::size_t, std::size_t>> params{{4, 3}, {2, 4}, {2, 2}, {1, 4}};
+
+    for (auto [threshold, batch_size] : params) {
+      auto circuits = RunProtocol(GenericConfig(n_parties, batch_size, 30, 2), threshold);
+      REQUIRE(circuits[0].GetCorrelator().NExtracted() == n_parties - threshold);
+    }
+  }
+
+  SECTION("F.I. correlations from PRSS") {
+    using G = tp::Generation;
+    std::vector<tp::FIPrepConfig> params{{G::kPRSS, G::kPRSS, G::kPRSS},
+					 {G::kDealt, G::kPRSS, G::kDealt},
+					 {G::kPRSS, G::kDealt, G::kPRSS}};
+
+    for (auto fi_config : params) {
+      RunProtocol(GenericConfig(9, 3, 30, 2), 4,
+		  [&](tp::Circuit& c) { c.SetFIPrepConfig(fi_config); },
+		  [](Circuits& circuits) {
+		    std::size_t n_parties = circuits.size();
+		    PARTY { circuits[i].PRSSSetupSend(); }
+		    PARTY { circuits[i].PRSSSetupRecv(); }
+		    Prep(circuits);
+		  });
+    }
+  }
+
+  SECTION("Threads on P1") {
+    // 100 batches per layer, so that P1 splits them across its threads
+    RunProtocol(GenericConfig(9, 3, 300, 2), 4, [](tp::Circuit& c) { c.SetThreads(4); });
+  }
+
+  SECTION("Rotating kings") {
+    // Outputs to two owners, so that both learn them without P1
+    auto config = GenericConfig(9, 3, 40, 3);
+    config.out_gates[5] = 1;
+    RunProtocol(config, 4, [](tp::Circuit& c) { c.SetKingPolicy(tp::KingPolicy::kRotating); });
+  }
+
+  SECTION("Pipelined preprocessing") {
+    // Chunks of one batch, of a few batches that do not divide the
+    // layers, and of more than the whole circuit
+    std::size_t n_parties = 9;
+    auto config = GenericConfig(n_parties, 3, 40, 3);
+
+    for (std::size_t chunk : {1, 5, 1000}) {
+      auto circuits = RunProtocol(config, 4, {}, [chunk](Circuits& circuits) {
+	std::vector<std::thread> parties;
+	for (auto& c : circuits) parties.emplace_back([&c, chunk]() { c.PipelinedPrep(chunk); });
+	for (auto& p : parties) p.join();
+      });
+
+      // The correlator is left for the whole circuit, so it can
+      // preprocess the circuit again
+      auto pool_networks = scl::Network::CreateFullInMemory(n_parties);
+      PARTY { circuits[i].StartPrepPool(std::make_shared<scl::Network>(pool_networks[i]), 1); }
+      std::vector<std::thread> parties;
+      PARTY { parties.emplace_back([&, i]() { circuits[i].PrepFromPool(); }); }
+      for (auto& p : parties) p.join();
+      Online(circuits, config, {tp::FF(1), tp::FF(2)});
+      PARTY { circuits[i].StopPrepPool(); }
+    }
+  }
+
+  SECTION("Stored preprocessing") {
+    // The F.I. preprocessing and the F.D. preprocessing run on
+    // separate sets of circuits, as if in separate processes, and go
+    // through files to the circuits of the online phase
+    std::size_t n_parties = 9;
+    auto config = GenericConfig(n_parties, 3, 40, 3);
+
+    auto dir = std::filesystem::temp_directory_path();
+    auto fi_path = [&](std::size_t i) { return (dir / ("tp_fi_prep_" + std::to_string(i))).string(); };
+    auto fd_path = [&](std::size_t i) { return (dir / ("tp_fd_prep_" + std::to_string(i))).string(); };
+
+    auto circuits = RunProtocol(config, 4, {}, [&](Circuits& circuits) {
+      {
+	auto fi = Setup(config, 4);
+	PARTY { fi[i].FIPrepSend(); }
+	PARTY { fi[i].FIPrepRecv(); }
+	PARTY { fi[i].GenProdPartiesSendP1(); }
+	PARTY { fi[i].GenProdP1ReceivesAndSends(); }
+	PARTY { fi[i].GenProdPartiesReceive(); }
+	PARTY { fi[i].SaveFIPrep(fi_path(i)); }
+      }
+      {
+	auto fd = Setup(config, 4);
+	PARTY { fd[i].LoadFIPrep(fi_path(i)); }
+	PARTY { fd[i].MapCorrToCircuit(); }
+	PARTY { fd[i].PrepMultPartiesSendP1(); }
+	PARTY { fd[i].PrepMultP1ReceivesAndSends(); }
+	PARTY { fd[i].PrepMultPartiesReceive(); }
+	PARTY { fd[i].PrepIOPartiesSendOwner(); }
+	PARTY { fd[i].PrepIOOwnerReceives(); }
+	PARTY { fd[i].SavePrep(fd_path(i)); }
+      }
+      PARTY { circuits[i].LoadPrep(fd_path(i)); }
+    });
+
+    // Files of another party, kind or circuit are refused
+    REQUIRE_THROWS_AS(circuits[0].LoadPrep(fd_path(1)), std::invalid_argument);
+    REQUIRE_THROWS_AS(circuits[0].LoadPrep(fi_path(0)), std::invalid_argument);
+    auto other = config;
+    other.depth = 4;
+    REQUIRE_THROWS_MATCHES(Setup(other, 4)[0].LoadPrep(fd_path(0)), std::invalid_argument,
+			   Catch::Matchers::Message(fd_path(0) + " holds the preprocessing of another circuit"));
+
+    // And so are files that were not completely written
+    {
+      tp::PrepHeader header;
+      header.mKind = static_cast<std::uint32_t>(tp::PrepKind::kFunctionDependent);
+      header.mSectionSize[tp::kShrLambdaA] = 2;
+      tp::PrepWriter writer(fd_path(0), header);
+      writer.Write(std::vector<tp::FF>{tp::FF(1)});
+      REQUIRE_THROWS_AS(writer.Close(), std::invalid_argument);
+    }
+    REQUIRE_THROWS_MATCHES(circuits[0].LoadPrep(fd_path(0)), std::invalid_argument,
+			   Catch::Matchers::Message(fd_path(0) + " is not a complete preprocessing file"));
+
+    PARTY {
+      std::filesystem::remove(fi_path(i));
+      std::filesystem::remove(fd_path(i));
+    }
+  }
+
+  SECTION("Background preprocessing") {
+    // Repeated evaluations of a circuit, with the F.I. preprocessing
+    // of each produced in the background over other channels. With
+    // PRSS, the pool works on forks of the PRSS instances
+    std::size_t n_parties = 9;
+    auto config = GenericConfig(n_parties, 3, 40, 3);
+    using G = tp::Generation;
+    std::vector<tp::FIPrepConfig> params{{}, {G::kPRSS, G::kPRSS, G::kPRSS}};
+
+    for (auto fi_config : params) {
+      auto circuits = Setup(config, 4, [&](tp::Circuit& c) { c.SetFIPrepConfig(fi_config); });
+      PARTY { circuits[i].PRSSSetupSend(); }
+      PARTY { circuits[i].PRSSSetupRecv(); }
+
+      auto pool_networks = scl::Network::CreateFullInMemory(n_parties);
+      PARTY { circuits[i].StartPrepPool(std::make_shared<scl::Network>(pool_networks[i]), 2); }
+
+      for (std::size_t eval = 0; eval < 3; eval++) {
+	std::vector<std::thread> parties;
+	PARTY { parties.emplace_back([&, i]() { circuits[i].PrepFromPool(); }); }
+	for (auto& p : parties) p.join();
+	Online(circuits, config, {tp::FF(0432432 + eval), tp::FF(54982 + eval)});
+      }
+
+      // Party 0 stops first, and the rest follow it
+      PARTY { circuits[i].StopPrepPool(); }
+      PARTY { REQUIRE(circuits[i].PrepPoolSize() == circuits[0].PrepPoolSize()); }
+    }
+  }
+
+  SECTION("Invalid threshold") {
+    tp::CircuitConfig config;
+    config.n_parties = 5;
+    config.inp_gates = {2,0,0,0,0};
+    config.out_gates = {2,0,0,0,0};
+    config.width = 10;
+    config.depth = 1;
+    config.batch_size = 2;
+
+    auto networks = scl::Network::CreateFullInMemory(config.n_parties);
+    auto c = tp::Circuit::FromConfig(config);
+    c.SetNetwork(std::make_shared<scl::Network>(networks[0]), 0);
+    c.GenCorrelator();
+
+    REQUIRE_THROWS_MATCHES(c.SetThreshold(3), std::invalid_argument,
+			   Catch::Matchers::Message("It must hold that n >= t + 2(k-1) + 1"));
+    REQUIRE_NOTHROW(c.SetThreshold(2));
+  }
 }
@@ -0,0 +1,127 @@
+#include <catch2/catch.hpp>
+#include <iostream>
+
+#include "tp/circuits.h"
+
+TEST_CASE("Flat circuit") {
+  SECTION("Lowering") {
+    // x' = (x+y)*x, y' = (x+y)*y, z = x'*y' + x
+    std::size_t batch_size(2);
+    auto c = tp::Circuit(2, batch_size);
+
+    auto x = c.Input(0);
+    auto y = c.Input(1);
+    c.CloseInputs();
+
+    auto xPy = c.Add(x, y);
+    auto x_ = c.Mult(xPy, x);
+    auto y_ = c.Mult(xPy, y);
+    c.NewLayer();
+    auto xy = c.Mult(x_, y_);
+    c.LastLayer();
+    auto z = c.Add(xy, x);
+    auto out = c.Output(0, z);
+    c.CloseOutputs();
+
+    auto& flat = c.GetFlatCircuit();
+    // Padding gate plus 8 gates
+    REQUIRE(flat.NWires() == 9);
+    REQUIRE(flat.NLayers() == 2);
+    REQUIRE(flat.NMultBatches() == 2);
+
+    // The second layer is padded
+    REQUIRE(flat.mMultGates == tp::vec<tp::WireId>{x_->GetWire(), y_->GetWire(),
+						    xy->GetWire(), tp::FlatCircuit::kPaddingWire});
+    REQUIRE(flat.mLeft[xy->GetWire()] == x_->GetWire());
+    REQUIRE(flat.mRight[xy->GetWire()] == y_->GetWire());
+    REQUIRE(flat.mInputBegin == tp::vec<std::uint32_t>{0, 1, 2});
+    REQUIRE(flat.mOutputBegin == tp::vec<std::uint32_t>{0, 1, 1});
+
+    // Every client has at least one input and output batch
+    REQUIRE(flat.mInputBatches == tp::vec<tp::WireId>{x->GetWire(), 0, y->GetWire(), 0});
+    REQUIRE(flat.mInputBatchOwner == tp::vec<std::uint32_t>{0, 1});
+    REQUIRE(flat.mOutputBatches == tp::vec<tp::WireId>{out->GetWire(), 0, 0, 0});
+    REQUIRE(flat.mOutputBatchOwner == tp::vec<std::uint32_t>{0, 1});
+
+    // x+y has level 0, z has level 2, and so does the output
+    REQUIRE(flat.mLinearBegin == tp::vec<std::uint32_t>{0, 1, 1, 3});
+    REQUIRE(flat.mLinearGates[0] == xPy->GetWire());
+    REQUIRE(flat.mLinearGates[1] == z->GetWire());
+  }
+
+  SECTION("Automatic layers") {
+    // No layers are opened: m1 = x*y and m2 = m1*x are on the
+    // critical path, while m3 = x*x and m4 = y*y can go to either
+    // layer. m3 fills the first batch of layer 0, and m4 the one of
+    // layer 1
+    std::size_t batch_size(2);
+    std::size_t n_parties(4*batch_size - 3);
+    std::size_t n_clients(2);
+
+    auto networks = scl::Network::CreateFullInMemory(n_parties);
+    std::vector<tp::Circuit> circuits;
+    for (std::size_t i = 0; i < n_parties; i++) {
+      auto c = tp::Circuit(n_clients, batch_size);
+      auto x = c.Input(0);
+      auto y = c.Input(1);
+      c.CloseInputs();
+      auto m1 = c.Mult(x, y);
+      auto m3 = c.Mult(x, x);
+      auto m4 = c.Mult(y, y);
+      auto m2 = c.Mult(m1, x);
+      c.Output(0, c.Add(m2, m4));
+      c.Output(1, m3);
+      c.CloseOutputs();
+
+      REQUIRE(c.GetDepth() == 2);
+      REQUIRE(c.GetNMultBatches() == 2);
+      REQUIRE(c.GetMultGate(0, 0) == m1);
+      REQUIRE(c.GetMultGate(0, 1) == m3);
+      REQUIRE(c.GetMultGate(1, 0) == m4);
+      REQUIRE(c.GetMultGate(1, 1) == m2);
+
+      c.SetNetwork(std::make_shared<scl::Network>(networks[i]), i);
+      c._DummyPrep(tp::FF(5));
+      circuits.emplace_back(c);
+    }
+
+    tp::FF X(3);
+    tp::FF Y(-7);
+    circuits[0].SetInputs({X});
+    circuits[1].SetInputs({Y});
+    for (auto& c : circuits) c.InputOwnerSendsP1();
+    for (auto& c : circuits) c.InputP1Receives();
+    for (std::size_t layer = 0; layer < 2; layer++) {
+      for (auto& c : circuits) c.MultP1Sends(layer);
+      for (auto& c : circuits) c.MultPartiesReceive(layer);
+      for (auto& c : circuits) c.MultPartiesSend(layer);
+      for (auto& c : circuits) c.MultP1Receives(layer);
+    }
+    for (auto& c : circuits) c.OutputP1SendsMu();
+    for (auto& c : circuits) c.OutputOwnerReceivesMu();
+
+    REQUIRE(circuits[0].GetOutputs() == std::vector<tp::FF>{X*Y*X + Y*Y});
+    REQUIRE(circuits[1].GetOutputs() == std::vector<tp::FF>{X*X});
+  }
+
+  SECTION("Invalid layers") {
+    tp::FlatCircuit flat;
+    auto x = flat.AddGate(tp::GateType::kInput, 0, 0);
+    auto y = flat.AddGate(tp::GateType::kMult, x, x);
+    auto z = flat.AddGate(tp::GateType::kMult, y, x);
+    flat.mBatchSize = 2;
+    flat.mMultGates = {y, z};
+    flat.mLayerBegin = {0, 1};
+
+    REQUIRE_THROWS_MATCHES(flat.Finalize(), std::invalid_argument,
+			   Catch::Matchers::Message("Multiplication gate depends on a gate of its own or a later layer"));
+
+    flat.mMultGates = {y, 0};
+    REQUIRE_THROWS_MATCHES(flat.Finalize(), std::invalid_argument,
+			   Catch::Matchers::Message("Multiplication gate is not assigned to a layer"));
+
+    flat.mMultGates = {y, 0, z, 0};
+    flat.mLayerBegin = {0, 1, 2};
+    REQUIRE_NOTHROW(flat.Finalize());
+  }
+}
@@ -0,0 +1,107 @@
+#include <catch2/catch.hpp>
+#include <iostream>
+
+#include "tp/prss.h"
+
+#define PARTY for(std::size_t i = 0; i < n_parties; i++)
+
+// Checks that the shares (of party i at x = i+1) lie on a polynomial
+// of the given degree which vanishes at zeros, and that this
+// polynomial is not identically zero
+void CheckSharing(const tp::vec<tp::FF>& shares, std::size_t degree, const tp::vec<tp::FF>& zeros) {
+  tp::Vec x_points;
+  tp::Vec y_points;
+  for (std::size_t i = 0; i < degree + 1; ++i) {
+    x_points.Emplace(tp::FF(i + 1));
+    y_points.Emplace(shares[i]);
+  }
+  tp::Poly poly(x_points, y_points);
+  for (std::size_t i = degree + 1; i < shares.size(); ++i) {
+    REQUIRE(poly.Evaluate(tp::FF(i + 1)) == shares[i]);
+  }
+  for (auto& z : zeros) REQUIRE(poly.Evaluate(z) == tp::FF(0));
+
+  bool not_zero = false;
+  for (auto& shr : shares) not_zero |= shr != tp::FF(0);
+  REQUIRE(not_zero);
+}
+
+TEST_CASE("PRSS") {
+  std::size_t n_parties = 7;
+  std::size_t n_sharings = 20;
+
+  SECTION("Subsets") {
+    tp::PRSS prss(n_parties, 3, 3);
+    // binom(6, 2) subsets of size 3 contain party 3
+    REQUIRE(prss.NSubsets() == 15);
+    REQUIRE(prss.Degree(0) == 4);
+    REQUIRE(prss.Degree(2) == 6);
+
+    REQUIRE_THROWS_MATCHES(tp::PRSS(n_parties, 0, 0), std::invalid_argument,
+			   Catch::Matchers::Message("subset size must be in [1, n]"));
+    REQUIRE_THROWS_MATCHES(tp::PRSS(n_parties, 0, 8), std::invalid_argument,
+			   Catch::Matchers::Message("subset size must be in [1, n]"));
+  }
+
+  SECTION("Seeds from entropy") {
+    // Unlike scl::PRG(), which always has the same seed
+    auto prg_a = tp::PRSS::FromEntropy();
+    auto prg_b = tp::PRSS::FromEntropy();
+    REQUIRE(tp::FF::Random(prg_a) != tp::FF::Random(prg_b));
+  }
+
+  // Random sharings: subsets of size n-t. Zero sharings: subsets of
+  // size |zeros| + 1
+  std::size_t threshold = 3;
+  std::vector<std::pair<std::size_t, tp::vec<tp::FF>>> params{
+    {n_parties - threshold, {}},
+    {2, {tp::FF(-2)}},
+    {4, {tp::FF(0), tp::FF(-1), tp::FF(-2)}},
+  };
+
+  for (auto& [subset_size, zeros] : params) {
+    auto networks = scl::Network::CreateFullInMemory(n_parties);
+    std::vector<tp::PRSS> prss;
+    PARTY { prss.emplace_back(n_parties, i, subset_size); }
+
+    PARTY {
+      scl::PRG prg;
+      // Different seeds for every party
+      for (std::size_t j = 0; j < i; ++j) (void)tp::FF::Random(prg);
+      prss[i].SetupSend(std::make_shared<scl::Network>(networks[i]), prg);
+    }
+    PARTY { prss[i].SetupRecv(std::make_shared<scl::Network>(networks[i])); }
+
+    std::vector<tp::vec<tp::FF>> shares;
+    PARTY { shares.emplace_back(prss[i].Next(zeros, n_sharings)); }
+    // The next call gives different sharings
+    std::vector<tp::vec<tp::FF>> next_shares;
+    PARTY { next_shares.emplace_back(prss[i].Next(zeros, 1)); }
+
+    std::size_t degree = prss[0].Degree(zeros.size());
+    for (std::size_t c = 0; c < n_sharings; ++c) {
+      tp::vec<tp::FF> sharing;
+      PARTY { sharing.emplace_back(shares[i][c]); }
+      CheckSharing(sharing, degree, zeros);
+    }
+
+    tp::vec<tp::FF> sharing;
+    PARTY { sharing.emplace_back(next_shares[i][0]); }
+    CheckSharing(sharing, degree, zeros);
+    REQUIRE(sharing[0] != shares[0][0]);
+
+    // A fork gives sharings of its own, which the original does not
+    // repeat
+    std::vector<tp::PRSS> forks;
+    PARTY { forks.emplace_back(prss[i].Fork()); }
+    tp::vec<tp::FF> forked;
+    tp::vec<tp::FF> original;
+    PARTY {
+      forked.emplace_back(forks[i].Next(zeros, 1)[0]);
+      original.emplace_back(prss[i].Next(zeros, 1)[0]);
+    }
+    CheckSharing(forked, degree, zeros);
+    CheckSharing(original, degree, zeros);
+    REQUIRE(forked[0] != original[0]);
+  }
+}
@@ -0,0 +1,48 @@
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "tp/thread_pool.h"
+
+TEST_CASE("ThreadPool") {
+  SECTION("Ranges cover the input") {
+    tp::ThreadPool pool(4);
+    REQUIRE(pool.Size() == 4);
+
+    std::vector<int> hits(1000, 0);
+    std::atomic<int> calls(0);
+    pool.ParallelFor(hits.size(), [&](std::size_t begin, std::size_t end) {
+      calls++;
+      for (std::size_t i = begin; i < end; i++) hits[i]++;
+    });
+    REQUIRE(calls == 4);
+    REQUIRE(hits == std::vector<int>(1000, 1));
+  }
+
+  SECTION("Small loops stay on the caller") {
+    tp::ThreadPool pool(4);
+    std::atomic<int> calls(0);
+    pool.ParallelFor(10, [&](std::size_t begin, std::size_t end) {
+      calls++;
+      REQUIRE(begin == 0);
+      REQUIRE(end == 10);
+    }, 8);
+    REQUIRE(calls == 1);
+
+    pool.ParallelFor(0, [&](std::size_t, std::size_t) { calls++; });
+    REQUIRE(calls == 1);
+  }
+
+  SECTION("Errors are rethrown") {
+    tp::ThreadPool pool(3);
+    REQUIRE_THROWS_AS(pool.ParallelFor(30, [](std::size_t begin, std::size_t) {
+      if ( begin > 0 ) throw std::runtime_error("fail");
+    }), std::runtime_error);
+
+    // The pool is still usable
+    std::atomic<std::size_t> sum(0);
+    pool.ParallelFor(30, [&](std::size_t begin, std::size_t end) { sum += end - begin; });
+    REQUIRE(sum == 30);
+  }
+}